@@ -7,6 +7,7 @@
 
 #include <cppcoro/config.hpp>
 #include <cppcoro/fmap.hpp>
+#include <cppcoro/frame_allocator.hpp>
 
 #include <exception>
 #include <atomic>
@@ -30,7 +31,7 @@ namespace cppcoro
 		class async_generator_yield_operation;
 		class async_generator_advance_operation;
 
-		class async_generator_promise_base
+		class async_generator_promise_base : public frame_allocating_promise<frame_kind::async_generator>
 		{
 		public:
 
@@ -435,7 +436,7 @@ namespace cppcoro
 		class async_generator_yield_operation;
 		class async_generator_advance_operation;
 
-		class async_generator_promise_base
+		class async_generator_promise_base : public frame_allocating_promise<frame_kind::async_generator>
 		{
 		public:
 
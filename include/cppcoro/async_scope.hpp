@@ -5,6 +5,7 @@
 #ifndef CPPCORO_ASYNC_SCOPE_HPP_INCLUDED
 #define CPPCORO_ASYNC_SCOPE_HPP_INCLUDED
 
+#include <cppcoro/frame_allocator.hpp>
 #include <cppcoro/on_scope_exit.hpp>
 
 #include <atomic>
@@ -83,7 +84,7 @@ namespace cppcoro
 
 		struct oneway_task
 		{
-			struct promise_type
+			struct promise_type : detail::frame_allocating_promise<frame_kind::other>
 			{
 				cppcoro::suspend_never initial_suspend() { return {}; }
 				cppcoro::suspend_never final_suspend() noexcept { return {}; }
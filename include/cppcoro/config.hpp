@@ -109,6 +109,25 @@
 # define CPPCORO_OS_FREEBSD 0
 #endif
 
+/// \def CPPCORO_USE_IO_URING
+/// Defined to 1 if the Linux io_service dispatches I/O through io_uring
+/// rather than epoll. Selected at build time with the CMake option of the
+/// same name.
+#if !CPPCORO_OS_LINUX
+# undef CPPCORO_USE_IO_URING
+# define CPPCORO_USE_IO_URING 0
+#elif !defined(CPPCORO_USE_IO_URING)
+# define CPPCORO_USE_IO_URING 0
+#endif
+
+/// \def CPPCORO_FRAME_STATS
+/// Defined to 1 if coroutine frame allocations and frame sizes are counted
+/// for each coroutine type (see frame_stats.hpp). Selected at build time
+/// with the CMake option of the same name.
+#ifndef CPPCORO_FRAME_STATS
+# define CPPCORO_FRAME_STATS 0
+#endif
+
 /////////////////////////////////////////////////////////////////////////////
 // CPU Detection
 
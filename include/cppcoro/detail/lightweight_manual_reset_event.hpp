@@ -38,6 +38,8 @@ namespace cppcoro
 		private:
 
 #if CPPCORO_OS_LINUX
+			// 0 if not set, 1 if set, or 2 if not set and a thread may be
+			// blocked in wait().
 			std::atomic<int> m_value;
 #elif CPPCORO_OS_WINNT >= 0x0602
 			// Windows 8 or newer we can use WaitOnAddress()
@@ -48,6 +48,61 @@ namespace cppcoro
 				fd_t m_fd;
 			};
 
+#if !CPPCORO_USE_IO_URING
+			/// A handle's persistent registration with the io_service's epoll
+			/// instance. See message_queue::register_handle().
+			struct fd_registration;
+
+			/// An entry in the io_service's timer wheel.
+			/// See message_queue::schedule_timer().
+			struct timer_node
+			{
+				static constexpr std::uint8_t not_queued = 0xFF;
+
+				timer_node() noexcept
+					: m_next(nullptr)
+					, m_prev(nullptr)
+					, m_cb(nullptr)
+					, m_when(0)
+					, m_level(not_queued)
+					, m_slot(0)
+				{}
+
+				timer_node* m_next;
+				timer_node* m_prev;
+				// The operation to dispatch when the timer expires.
+				void* m_cb;
+				// Tick at which the timer expires.
+				std::uint64_t m_when;
+				// Position in the wheel, or not_queued.
+				std::uint8_t m_level;
+				std::uint8_t m_slot;
+			};
+#endif
+
+#if CPPCORO_USE_IO_URING
+			/// An operation to be submitted directly to the io_uring submission
+			/// queue. The fields map onto the equivalent io_uring_sqe fields.
+			struct io_uring_request
+			{
+				std::uint8_t opcode;
+				fd_t fd;
+				const void* addr;
+				std::uint32_t len;
+				// File offset, or addr2 for accept/connect.
+				std::uint64_t off;
+				// msg_flags, accept_flags or timeout_flags depending on opcode.
+				std::uint32_t flags;
+			};
+
+			/// Layout-compatible with struct __kernel_timespec.
+			struct io_uring_timespec
+			{
+				std::int64_t tv_sec;
+				long long tv_nsec;
+			};
+#endif
+
 			struct io_state
 			{
 				explicit io_state(io_service* ioService) noexcept
@@ -55,17 +110,37 @@ namespace cppcoro
 					, m_fd(-1)
 					, m_res(0)
 					, m_completeFunc([]{ return 0; })
+#if !CPPCORO_USE_IO_URING
+					, m_registration(nullptr)
+					, m_next(nullptr)
+#endif
 				{}
 
 				std::size_t get_result();
 				void on_operation_completed_base();
 				void cancel() noexcept;
 
+#if CPPCORO_USE_IO_URING
+				/// Submit the operation to the io_service's ring.
+				///
+				/// \return
+				/// true if the operation will complete asynchronously, false if
+				/// it could not be queued, in which case m_res holds the error.
+				bool try_submit(const io_uring_request& request) noexcept;
+#endif
+
 				io_service* m_ioService;
 				fd_t m_fd;
 				std::int32_t m_res;
 				std::function<int()> m_completeFunc;
-
+#if !CPPCORO_USE_IO_URING
+				// Set if the operation is waiting on a persistent registration
+				// rather than a one-shot watch of m_fd.
+				fd_registration* m_registration;
+				// Links the operation into the message_queue's list of
+				// completions queued with post_completion().
+				io_state* m_next;
+#endif
 			};
 
 			safe_fd create_event_fd();
@@ -8,11 +8,29 @@
 #include <cppcoro/config.hpp>
 #include <cppcoro/detail/platform.hpp>
 #include <cstdint>
+#if CPPCORO_OS_LINUX
+# include <atomic>
+#endif
+#if CPPCORO_OS_LINUX
+# include <memory>
+#endif
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+# include <chrono>
+# include <mutex>
+# include <vector>
+#endif
 
 namespace cppcoro
 {
 	namespace detail
 	{
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+		namespace linux
+		{
+			class blocking_io_pool;
+		}
+#endif
+
 		enum class watch_type
 		{
 			readable,
@@ -33,10 +51,32 @@ namespace cppcoro
 			void* data;
 		};
 
+		/// Counts of the batches of readiness events harvested by an event
+		/// loop. See io_service::batch_stats().
+		struct event_batch_stats
+		{
+			/// The number of polls that returned at least one event.
+			std::uint64_t batch_count = 0;
+
+			/// The total number of events returned by those polls. The mean
+			/// number of events per batch is event_count / batch_count.
+			std::uint64_t event_count = 0;
+
+			/// The most events returned by a single poll.
+			std::uint64_t largest_batch = 0;
+		};
+
 		class message_queue
 		{
 		public:
+#if !CPPCORO_OS_LINUX || CPPCORO_USE_IO_URING
 			explicit message_queue(std::uint32_t concurrencyHint);
+#else
+			/// \param eventBatchSize
+			/// The maximum number of readiness events harvested by each call
+			/// to epoll_wait(). Must be at least 1.
+			message_queue(std::uint32_t concurrencyHint, std::uint32_t eventBatchSize);
+#endif
 			~message_queue();
 			message_queue(message_queue&& other) = delete;
 			message_queue& operator=(message_queue&& other) = delete;
@@ -51,10 +91,168 @@ namespace cppcoro
 #if CPPCORO_OS_DARWIN
 			void watch_event(struct kevent* event, void* cb);
 #endif
+#if CPPCORO_OS_LINUX
+			/// Wake up a thread blocked in dequeue_message(), which then
+			/// receives a WAKEUP_TYPE message.
+			///
+			/// Calls made before a previous notification has been received
+			/// are coalesced into that notification.
+			void notify() noexcept;
+#endif
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+			/// Whether dequeue_message() has harvested messages, or there are
+			/// completions queued with post_completion(), that have not been
+			/// dequeued yet. They are only dispatched by threads that call
+			/// dequeue_message(), so the caller should notify() any thread
+			/// that is blocked waiting for events.
+			bool has_ready_messages() noexcept;
+
+			/// Counts of the batches of events harvested by dequeue_message().
+			event_batch_stats batch_stats() const noexcept;
+
+			/// Queue the operation \p cb to be dispatched as a CALLBACK_TYPE
+			/// message, and wake a thread blocked in dequeue_message().
+			///
+			/// The operation is queued in-process rather than written to the
+			/// pipe, so unlike enqueue_message() this cannot fail. Use it for
+			/// completions that must not be lost.
+			void post_completion(void* cb) noexcept;
+#endif
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+			/// Register a non-blocking handle for edge-triggered read and write
+			/// readiness notifications, once, for as long as it remains open.
+			///
+			/// Operations then wait on the registration with the overload of
+			/// watch_handle() below without any further epoll_ctl() calls, and
+			/// one read and one write may be outstanding at the same time.
+			///
+			/// \return
+			/// The registration, or nullptr if the handle could not be
+			/// registered, in which case operations should fall back to
+			/// watching the handle directly.
+			linux::fd_registration* register_handle(file_handle_t handle) noexcept;
+
+			/// Remove a registration created by register_handle().
+			/// Must be called before the handle is closed.
+			void deregister_handle(linux::fd_registration* registration) noexcept;
+
+			/// Wait for a registered handle to become ready, then run the
+			/// operation's m_completeFunc, retrying if it would block, and
+			/// dispatch the operation with the result stored in m_res.
+			///
+			/// \param cb
+			/// The operation, which must be an async_operation_base.
+			///
+			/// \param events
+			/// The direction to wait on. readablewritable waits for writable.
+			void watch_handle(linux::fd_registration& registration, void* cb, watch_type events);
+
+			/// Cancel an operation waiting on a registration. If it is not
+			/// currently waiting then it is left to complete normally.
+			void unwatch_handle(linux::fd_registration& registration, void* cb) noexcept;
+
+			/// Dispatch the operation \p cb once \p dueTime has passed.
+			///
+			/// Timers share a single timer wheel and timer fd, so queueing
+			/// one is O(1) and usually makes no syscalls.
+			///
+			/// \param node
+			/// Storage for the timer, which must stay valid until the
+			/// operation has been dispatched.
+			void schedule_timer(
+				linux::timer_node& node,
+				void* cb,
+				std::chrono::high_resolution_clock::time_point dueTime);
+
+			/// Cancel a timer queued with schedule_timer(). If it has not
+			/// expired yet its operation is dispatched with -ECANCELED in m_res,
+			/// otherwise it is left to complete normally.
+			void cancel_timer(linux::timer_node& node) noexcept;
+
+			/// Run the operation's m_completeFunc on a blocking I/O thread, for
+			/// work that epoll cannot wait for such as regular file I/O, and
+			/// then dispatch it with the result stored in m_res.
+			///
+			/// \return
+			/// false if the operation could not be queued.
+			bool submit_blocking(void* cb) noexcept;
+
+			/// Cancel an operation queued with submit_blocking(). If it has not
+			/// started yet it is dispatched with -ECANCELED in m_res, otherwise
+			/// it is left to complete normally.
+			void cancel_blocking(void* cb) noexcept;
+#endif
+#if CPPCORO_USE_IO_URING
+			/// Queue an operation directly on the ring. Its completion is
+			/// dispatched as a CALLBACK_TYPE message for \p cb with the
+			/// result stored in the operation's m_res.
+			///
+			/// The operation is normally submitted to the kernel together with
+			/// the others queued before the event loop next polls.
+			///
+			/// \return
+			/// false if the submission queue is full and the kernel would not
+			/// take any of its entries.
+			bool submit_io(const linux::io_uring_request& request, void* cb) noexcept;
+
+			/// Request cancellation of an operation previously queued with
+			/// submit_io() or watch_handle(). The operation still completes
+			/// exactly once, with -ECANCELED if the cancellation won.
+			void cancel_io(void* cb) noexcept;
+#endif
 
 		private:
-#if CPPCORO_OS_LINUX || CPPCORO_OS_DARWIN
+#if CPPCORO_USE_IO_URING
+			struct ring_state;
+
+			bool try_pop_completion(message& msg);
+
+			std::unique_ptr<ring_state> m_ring;
+#elif CPPCORO_OS_LINUX || CPPCORO_OS_DARWIN
 			int m_pipefd[2];
+#endif
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+			bool try_pop_ready(message& msg);
+
+			// Maximum number of events harvested per epoll_wait().
+			const std::uint32_t m_eventBatchSize;
+
+			std::atomic<std::uint64_t> m_batchCount;
+			std::atomic<std::uint64_t> m_batchEventCount;
+			std::atomic<std::uint64_t> m_largestBatch;
+
+			// Messages harvested by a previous epoll_wait() that have not
+			// been dispatched yet.
+			std::mutex m_readyMutex;
+			std::vector<message> m_ready;
+			std::size_t m_readyIndex;
+
+			// Operations queued by post_completion(), pushed lock-free,
+			// most recent first.
+			std::atomic<linux::io_state*> m_postedIncoming;
+			// Operations taken from m_postedIncoming in the order they were
+			// posted. Guarded by m_readyMutex.
+			linux::io_state* m_postedHead;
+
+			safe_file_handle_t m_eventfd;
+
+			// Registrations are recycled rather than freed so that an event
+			// harvested just before deregister_handle() never refers to freed
+			// memory. At worst it makes a later operation retry its syscall.
+			std::mutex m_registrationMutex;
+			std::vector<std::unique_ptr<linux::fd_registration>> m_registrations;
+			linux::fd_registration* m_freeRegistrations;
+
+			struct timer_state;
+
+			linux::timer_node* expire_timers();
+
+			std::unique_ptr<timer_state> m_timers;
+
+			std::unique_ptr<linux::blocking_io_pool> m_blockingPool;
+#endif
+#if CPPCORO_OS_LINUX
+			std::atomic<bool> m_notifyPending;
 #endif
 			safe_file_handle_t m_pollfd;
 		};
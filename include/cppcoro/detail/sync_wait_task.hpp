@@ -7,10 +7,12 @@
 
 #include <cppcoro/config.hpp>
 #include <cppcoro/awaitable_traits.hpp>
+#include <cppcoro/frame_allocator.hpp>
 #include <cppcoro/detail/lightweight_manual_reset_event.hpp>
 
 #include <cppcoro/coroutine.hpp>
 #include <cassert>
+#include <cstddef>
 #include <exception>
 #include <utility>
 
@@ -21,8 +23,52 @@ namespace cppcoro
 		template<typename RESULT>
 		class sync_wait_task;
 
+		/// Storage on sync_wait()'s stack for the frame of its sync_wait_task,
+		/// so that waiting doesn't allocate. Frames too large for it are
+		/// allocated with the global operator new.
+		class sync_wait_frame_buffer final : public frame_allocator
+		{
+		public:
+
+			static constexpr std::size_t capacity = 256;
+
+			sync_wait_frame_buffer() noexcept = default;
+
+			sync_wait_frame_buffer(const sync_wait_frame_buffer&) = delete;
+			sync_wait_frame_buffer& operator=(const sync_wait_frame_buffer&) = delete;
+
+			void* allocate(std::size_t size) override
+			{
+				if (size <= capacity && !m_inUse)
+				{
+					m_inUse = true;
+					return m_storage;
+				}
+
+				return ::operator new(size);
+			}
+
+			void deallocate(void* pointer, std::size_t size) noexcept override
+			{
+				if (pointer == m_storage)
+				{
+					m_inUse = false;
+				}
+				else
+				{
+					::operator delete(pointer, size);
+				}
+			}
+
+		private:
+
+			alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) unsigned char m_storage[capacity];
+			bool m_inUse = false;
+
+		};
+
 		template<typename RESULT>
-		class sync_wait_task_promise final
+		class sync_wait_task_promise final : public next_frame_allocator_promise
 		{
 			using coroutine_handle_t = cppcoro::coroutine_handle<sync_wait_task_promise<RESULT>>;
 
@@ -138,7 +184,7 @@ namespace cppcoro
 		};
 
 		template<>
-		class sync_wait_task_promise<void>
+		class sync_wait_task_promise<void> : public next_frame_allocator_promise
 		{
 			using coroutine_handle_t = cppcoro::coroutine_handle<sync_wait_task_promise<void>>;
 
@@ -293,6 +339,38 @@ namespace cppcoro
 		{
 			co_await std::forward<AWAITABLE>(awaitable);
 		}
+
+		/// Awaits an awaiter whose await_ready() has already returned false.
+		template<typename AWAITER>
+		class sync_wait_suspending_awaiter
+		{
+		public:
+
+			explicit sync_wait_suspending_awaiter(AWAITER& awaiter) noexcept
+				: m_awaiter(awaiter)
+			{}
+
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			template<typename PROMISE>
+			decltype(auto) await_suspend(cppcoro::coroutine_handle<PROMISE> coroutine)
+			{
+				return m_awaiter.await_suspend(coroutine);
+			}
+
+			decltype(auto) await_resume()
+			{
+				return m_awaiter.await_resume();
+			}
+
+		private:
+
+			AWAITER& m_awaiter;
+
+		};
 #endif
 	}
 }
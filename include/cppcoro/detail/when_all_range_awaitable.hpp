@@ -0,0 +1,394 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPCORO_DETAIL_WHEN_ALL_RANGE_AWAITABLE_HPP_INCLUDED
+#define CPPCORO_DETAIL_WHEN_ALL_RANGE_AWAITABLE_HPP_INCLUDED
+
+#include <cppcoro/frame_allocator.hpp>
+#include <cppcoro/when_all_buffer.hpp>
+#include <cppcoro/detail/when_all_counter.hpp>
+#include <cppcoro/detail/when_all_task.hpp>
+
+#include <cppcoro/coroutine.hpp>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if __has_include(<span>)
+# include <span>
+#endif
+
+namespace cppcoro
+{
+	namespace detail
+	{
+		// Lays out the state of a when_all over a range in a when_all_buffer:
+		// an array of tasks, followed by the tasks' coroutine frames, which
+		// are all the same size as they come from the same coroutine.
+		class when_all_frame_arena final : public frame_allocator
+		{
+		public:
+
+			when_all_frame_arena(
+				when_all_buffer& buffer,
+				std::size_t frameCount,
+				std::size_t headerSize) noexcept
+				: m_buffer(buffer)
+				, m_frameCount(frameCount)
+				, m_headerSize(round_up(headerSize))
+				, m_frameSize(0)
+				, m_allocatedCount(0)
+				, m_base(nullptr)
+			{
+				assert(!m_buffer.m_inUse);
+				m_buffer.m_inUse = true;
+			}
+
+			~when_all_frame_arena()
+			{
+				m_buffer.m_inUse = false;
+			}
+
+			when_all_frame_arena(const when_all_frame_arena&) = delete;
+			when_all_frame_arena& operator=(const when_all_frame_arena&) = delete;
+
+			/// The storage in front of the frames.
+			void* header()
+			{
+				if (m_base == nullptr)
+				{
+					m_base = static_cast<unsigned char*>(m_buffer.reserve(m_headerSize));
+				}
+
+				return m_base;
+			}
+
+			void* allocate(std::size_t size) override
+			{
+				if (m_base == nullptr)
+				{
+					// The first frame tells us how big they all are.
+					m_frameSize = round_up(size);
+					m_base = static_cast<unsigned char*>(
+						m_buffer.reserve(m_headerSize + m_frameCount * m_frameSize));
+				}
+
+				if (size <= m_frameSize && m_allocatedCount < m_frameCount)
+				{
+					return m_base + m_headerSize + m_frameSize * m_allocatedCount++;
+				}
+
+				return ::operator new(size);
+			}
+
+			void deallocate(void* pointer, std::size_t size) noexcept override
+			{
+				const auto address = reinterpret_cast<std::uintptr_t>(pointer);
+				const auto frames = reinterpret_cast<std::uintptr_t>(m_base + m_headerSize);
+				if (m_base == nullptr || address < frames || address >= frames + m_frameCount * m_frameSize)
+				{
+					::operator delete(pointer, size);
+				}
+			}
+
+		private:
+
+			static constexpr std::size_t round_up(std::size_t size) noexcept
+			{
+				constexpr std::size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+				return (size + alignment - 1) & ~(alignment - 1);
+			}
+
+			when_all_buffer& m_buffer;
+			const std::size_t m_frameCount;
+			const std::size_t m_headerSize;
+			std::size_t m_frameSize;
+			std::size_t m_allocatedCount;
+			unsigned char* m_base;
+
+		};
+
+		// Creates a when_all_task for each of a range of awaitables, in a
+		// when_all_frame_arena, and starts them when awaited.
+		template<typename RESULT>
+		class when_all_range_state
+		{
+		public:
+
+			using task_t = when_all_task<RESULT>;
+
+			template<typename AWAITABLE>
+			when_all_range_state(AWAITABLE* awaitables, std::size_t count, when_all_buffer* buffer)
+				: m_ownBuffer()
+				, m_arena(buffer != nullptr ? *buffer : m_ownBuffer, count, count * sizeof(task_t))
+				, m_counter(count)
+				, m_tasks(nullptr)
+				, m_taskCount(0)
+			{
+				try
+				{
+					for (std::size_t i = 0; i < count; ++i)
+					{
+						task_t task = [&]
+						{
+							next_frame_allocator_scope scope{ m_arena };
+							return make_when_all_task_in_place(awaitables[i]);
+						}();
+						if (m_tasks == nullptr)
+						{
+							m_tasks = static_cast<task_t*>(m_arena.header());
+						}
+
+						::new (static_cast<void*>(m_tasks + i)) task_t(std::move(task));
+						++m_taskCount;
+					}
+				}
+				catch (...)
+				{
+					destroy_tasks();
+					throw;
+				}
+			}
+
+			~when_all_range_state()
+			{
+				destroy_tasks();
+			}
+
+			when_all_range_state(const when_all_range_state&) = delete;
+			when_all_range_state& operator=(const when_all_range_state&) = delete;
+
+		protected:
+
+			bool is_ready() const noexcept
+			{
+				return m_counter.is_ready();
+			}
+
+			bool try_await(cppcoro::coroutine_handle<> awaitingCoroutine) noexcept
+			{
+				for (std::size_t i = 0; i < m_taskCount; ++i)
+				{
+					m_tasks[i].start(m_counter);
+				}
+
+				return m_counter.try_await(awaitingCoroutine);
+			}
+
+			task_t* tasks() noexcept
+			{
+				return m_tasks;
+			}
+
+			std::size_t task_count() const noexcept
+			{
+				return m_taskCount;
+			}
+
+		private:
+
+			void destroy_tasks() noexcept
+			{
+				for (; m_taskCount > 0; --m_taskCount)
+				{
+					m_tasks[m_taskCount - 1].~task_t();
+				}
+			}
+
+			// Declared before m_arena, which may use it.
+			when_all_buffer m_ownBuffer;
+			when_all_frame_arena m_arena;
+			when_all_counter m_counter;
+			task_t* m_tasks;
+			std::size_t m_taskCount;
+
+		};
+
+#if __cpp_lib_span
+		template<typename RESULT>
+		class when_all_ready_range_awaitable : public when_all_range_state<RESULT>
+		{
+			using state_t = when_all_range_state<RESULT>;
+
+		public:
+
+			using state_t::state_t;
+
+			auto operator co_await() & noexcept
+			{
+				class awaiter
+				{
+				public:
+
+					awaiter(when_all_ready_range_awaitable& awaitable) noexcept
+						: m_awaitable(awaitable)
+					{}
+
+					bool await_ready() const noexcept
+					{
+						return m_awaitable.is_ready();
+					}
+
+					bool await_suspend(cppcoro::coroutine_handle<> awaitingCoroutine) noexcept
+					{
+						return m_awaitable.try_await(awaitingCoroutine);
+					}
+
+					std::span<typename state_t::task_t> await_resume() const noexcept
+					{
+						return { m_awaitable.tasks(), m_awaitable.task_count() };
+					}
+
+				private:
+
+					when_all_ready_range_awaitable& m_awaitable;
+
+				};
+
+				return awaiter{ *this };
+			}
+
+		};
+
+		template<typename RESULT>
+		class when_all_range_awaitable : public when_all_range_state<RESULT>
+		{
+			using state_t = when_all_range_state<RESULT>;
+
+		public:
+
+			using result_t = std::conditional_t<
+				std::is_lvalue_reference_v<RESULT>,
+				std::reference_wrapper<std::remove_reference_t<RESULT>>,
+				std::remove_reference_t<RESULT>>;
+
+			using state_t::state_t;
+
+			auto operator co_await() && noexcept
+			{
+				class awaiter
+				{
+				public:
+
+					awaiter(when_all_range_awaitable& awaitable) noexcept
+						: m_awaitable(awaitable)
+					{}
+
+					bool await_ready() const noexcept
+					{
+						return m_awaitable.is_ready();
+					}
+
+					bool await_suspend(cppcoro::coroutine_handle<> awaitingCoroutine) noexcept
+					{
+						return m_awaitable.try_await(awaitingCoroutine);
+					}
+
+					auto await_resume()
+					{
+						auto* tasks = m_awaitable.tasks();
+						const std::size_t count = m_awaitable.task_count();
+						if constexpr (std::is_void_v<RESULT>)
+						{
+							for (std::size_t i = 0; i < count; ++i)
+							{
+								tasks[i].result();
+							}
+						}
+						else
+						{
+							std::vector<result_t> results;
+							results.reserve(count);
+							for (std::size_t i = 0; i < count; ++i)
+							{
+								results.emplace_back(std::move(tasks[i]).result());
+							}
+							return results;
+						}
+					}
+
+				private:
+
+					when_all_range_awaitable& m_awaitable;
+
+				};
+
+				return awaiter{ *this };
+			}
+
+		};
+
+		// As when_all_range_awaitable, but assigns the results to a range
+		// supplied by the caller, rather than returning a vector of them.
+		template<typename RESULT, typename OUTPUT>
+		class when_all_range_into_awaitable : public when_all_range_state<RESULT>
+		{
+			using state_t = when_all_range_state<RESULT>;
+
+		public:
+
+			template<typename AWAITABLE>
+			when_all_range_into_awaitable(
+				AWAITABLE* awaitables,
+				std::size_t count,
+				OUTPUT* results,
+				when_all_buffer* buffer)
+				: state_t(awaitables, count, buffer)
+				, m_results(results)
+			{}
+
+			auto operator co_await() && noexcept
+			{
+				class awaiter
+				{
+				public:
+
+					awaiter(when_all_range_into_awaitable& awaitable) noexcept
+						: m_awaitable(awaitable)
+					{}
+
+					bool await_ready() const noexcept
+					{
+						return m_awaitable.is_ready();
+					}
+
+					bool await_suspend(cppcoro::coroutine_handle<> awaitingCoroutine) noexcept
+					{
+						return m_awaitable.try_await(awaitingCoroutine);
+					}
+
+					void await_resume()
+					{
+						auto* tasks = m_awaitable.tasks();
+						const std::size_t count = m_awaitable.task_count();
+						for (std::size_t i = 0; i < count; ++i)
+						{
+							m_awaitable.m_results[i] = std::move(tasks[i]).result();
+						}
+					}
+
+				private:
+
+					when_all_range_into_awaitable& m_awaitable;
+
+				};
+
+				return awaiter{ *this };
+			}
+
+		private:
+
+			OUTPUT* m_results;
+
+		};
+#endif
+	}
+}
+
+#endif
@@ -6,6 +6,7 @@
 #define CPPCORO_DETAIL_WHEN_ALL_TASK_HPP_INCLUDED
 
 #include <cppcoro/awaitable_traits.hpp>
+#include <cppcoro/frame_allocator.hpp>
 
 #include <cppcoro/detail/when_all_counter.hpp>
 #include <cppcoro/detail/void_value.hpp>
@@ -13,6 +14,7 @@
 #include <cppcoro/coroutine.hpp>
 #include <cassert>
 #include <exception>
+#include <memory>
 #include <utility>
 
 namespace cppcoro
@@ -22,11 +24,15 @@ namespace cppcoro
 		template<typename TASK_CONTAINER>
 		class when_all_ready_awaitable;
 
+		template<typename RESULT>
+		class when_all_range_state;
+
 		template<typename RESULT>
 		class when_all_task;
 
 		template<typename RESULT>
 		class when_all_task_promise final
+			: public next_frame_allocator_promise
 		{
 		public:
 
@@ -154,6 +160,7 @@ namespace cppcoro
 
 		template<>
 		class when_all_task_promise<void> final
+			: public next_frame_allocator_promise
 		{
 		public:
 
@@ -288,6 +295,9 @@ namespace cppcoro
 			template<typename TASK_CONTAINER>
 			friend class when_all_ready_awaitable;
 
+			template<typename RESULT_TYPE>
+			friend class when_all_range_state;
+
 			void start(when_all_counter& counter) noexcept
 			{
 				m_coroutine.promise().start(counter);
@@ -352,6 +362,32 @@ namespace cppcoro
 		{
 			co_await awaitable.get();
 		}
+
+		// Awaits an awaitable owned by the caller as an rvalue. Created in a
+		// next_frame_allocator_scope of the caller's when_all_frame_arena.
+		template<
+			typename AWAITABLE,
+			typename RESULT = typename cppcoro::awaitable_traits<AWAITABLE&&>::await_result_t,
+			std::enable_if_t<!std::is_void_v<RESULT>, int> = 0>
+		when_all_task<RESULT> make_when_all_task_in_place(AWAITABLE& awaitable)
+		{
+#if CPPCORO_COMPILER_MSVC && CPPCORO_COMPILER_MSVC < 19'20'00000
+			// HACK: See the comment in make_when_all_task(AWAITABLE) above.
+			auto& promise = co_await when_all_task_promise<RESULT>::get_promise;
+			co_await promise.yield_value(co_await static_cast<AWAITABLE&&>(awaitable));
+#else
+			co_yield co_await static_cast<AWAITABLE&&>(awaitable);
+#endif
+		}
+
+		template<
+			typename AWAITABLE,
+			typename RESULT = typename cppcoro::awaitable_traits<AWAITABLE&&>::await_result_t,
+			std::enable_if_t<std::is_void_v<RESULT>, int> = 0>
+		when_all_task<void> make_when_all_task_in_place(AWAITABLE& awaitable)
+		{
+			co_await static_cast<AWAITABLE&&>(awaitable);
+		}
 	}
 }
 
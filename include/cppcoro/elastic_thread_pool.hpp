@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPCORO_ELASTIC_THREAD_POOL_HPP_INCLUDED
+#define CPPCORO_ELASTIC_THREAD_POOL_HPP_INCLUDED
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cppcoro/coroutine.hpp>
+
+namespace cppcoro
+{
+	/// A thread pool that starts extra threads while its workers are blocked,
+	/// so that blocking calls made from pool threads don't reduce the number
+	/// of threads running work.
+	///
+	/// Code about to block (on a DNS lookup, a lock, a synchronous library
+	/// call, ...) marks the region with a blocking_section. While threads are
+	/// blocked the pool starts threads to replace them, up to a maximum, and
+	/// threads beyond the pool's normal size exit once they have been idle
+	/// for the idle timeout.
+	class elastic_thread_pool
+	{
+	public:
+
+		/// Initialise to a number of threads equal to the number of cores
+		/// on the current machine, growing to at most four times that.
+		elastic_thread_pool();
+
+		/// Construct a thread pool with the specified number of threads.
+		///
+		/// \param threadCount
+		/// The number of threads that run work while none are blocked.
+		///
+		/// \param maxThreadCount
+		/// The most threads the pool will have, including blocked threads.
+		/// Values less than \p threadCount are treated as \p threadCount.
+		///
+		/// \param idleTimeout
+		/// How long a thread beyond the first \p threadCount waits for work
+		/// before exiting.
+		elastic_thread_pool(
+			std::uint32_t threadCount,
+			std::uint32_t maxThreadCount,
+			std::chrono::milliseconds idleTimeout = std::chrono::seconds(10));
+
+		/// Waits for the pool's threads to exit.
+		///
+		/// Any work still queued is not run.
+		~elastic_thread_pool();
+
+		class schedule_operation
+		{
+		public:
+
+			schedule_operation(elastic_thread_pool* tp) noexcept : m_threadPool(tp) {}
+
+			bool await_ready() noexcept { return false; }
+			void await_suspend(cppcoro::coroutine_handle<> awaitingCoroutine) noexcept;
+			void await_resume() noexcept {}
+
+		private:
+
+			friend class elastic_thread_pool;
+
+			elastic_thread_pool* m_threadPool;
+			cppcoro::coroutine_handle<> m_awaitingCoroutine;
+			schedule_operation* m_next;
+
+		};
+
+		/// Marks the current thread as blocked for the lifetime of the
+		/// object, letting the pool start another thread to run work in its
+		/// place.
+		///
+		/// Sections may be nested; the thread counts as blocked once, until
+		/// the outermost section ends. Has no effect if the current thread
+		/// is not one of the pool's threads.
+		class blocking_section
+		{
+		public:
+
+			explicit blocking_section(elastic_thread_pool& tp) noexcept;
+			~blocking_section();
+
+			blocking_section(const blocking_section&) = delete;
+			blocking_section& operator=(const blocking_section&) = delete;
+
+		private:
+
+			// Null if the section was entered from outside the pool.
+			elastic_thread_pool* m_threadPool;
+
+		};
+
+		/// The number of threads that run work while none are blocked.
+		std::uint32_t min_thread_count() const noexcept { return m_minThreadCount; }
+
+		std::uint32_t max_thread_count() const noexcept { return m_maxThreadCount; }
+
+		/// The number of threads the pool currently has, including blocked
+		/// threads.
+		std::uint32_t thread_count() const noexcept;
+
+		/// Return an operation that resumes the awaiting coroutine on one of
+		/// the pool's threads.
+		[[nodiscard]]
+		schedule_operation schedule() noexcept { return schedule_operation{ this }; }
+
+	private:
+
+		friend class schedule_operation;
+		friend class blocking_section;
+
+		using thread_list = std::list<std::thread>;
+
+		void run_worker_thread(thread_list::iterator self) noexcept;
+
+		void schedule_impl(schedule_operation* operation) noexcept;
+
+		// Start a thread. Must be called with m_mutex held.
+		void start_thread_locked();
+
+		void enter_blocking_section() noexcept;
+		void leave_blocking_section() noexcept;
+
+		static thread_local elastic_thread_pool* s_currentThreadPool;
+
+		// The number of blocking_sections the current thread is inside. Only
+		// the outermost one counts the thread as blocked.
+		static thread_local std::uint32_t s_blockingSectionDepth;
+
+		const std::uint32_t m_minThreadCount;
+		const std::uint32_t m_maxThreadCount;
+		const std::chrono::milliseconds m_idleTimeout;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_workAvailable;
+
+		// FIFO queue of operations waiting to run.
+		schedule_operation* m_head;
+		schedule_operation* m_tail;
+
+		// The running threads, and threads that have exited because they
+		// were idle but have not been joined yet.
+		thread_list m_threads;
+		std::vector<std::thread> m_retiredThreads;
+
+		// The number of threads inside a blocking_section. Never more than
+		// m_threads.size(), as a blocked thread can't retire.
+		std::uint32_t m_blockedThreadCount;
+		std::uint32_t m_idleThreadCount;
+
+		bool m_stopRequested;
+
+	};
+}
+
+#endif
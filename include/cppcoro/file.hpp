@@ -30,6 +30,9 @@ namespace cppcoro
 		/// Get the size of the file in bytes.
 		std::uint64_t size() const;
 
+		/// Get the underlying file handle associated with this file.
+		detail::file_handle_t native_handle() const noexcept { return m_fileHandle.handle(); }
+
 	protected:
 
  		static file open(
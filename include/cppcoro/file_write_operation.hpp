@@ -91,6 +91,9 @@ namespace cppcoro
  		friend class cppcoro::detail::async_operation_cancellable<file_write_operation_cancellable>;
 
  		bool try_start() noexcept { return m_impl.try_start(*this); }
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+		void cancel() noexcept { m_impl.cancel(*this); }
+#endif
 
  		file_write_operation_impl m_impl;
 
@@ -0,0 +1,325 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPCORO_FRAME_ALLOCATOR_HPP_INCLUDED
+#define CPPCORO_FRAME_ALLOCATOR_HPP_INCLUDED
+
+#include <cppcoro/config.hpp>
+#include <cppcoro/frame_stats.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cppcoro
+{
+	/// Allocates memory for coroutine frames.
+	///
+	/// Coroutine types that support frame allocators (task<T>,
+	/// shared_task<T> and async_generator<T>) allocate their frames from the allocator passed as
+	/// `std::allocator_arg, allocator` leading arguments of the coroutine, or
+	/// otherwise from the calling thread's default frame allocator (see
+	/// frame_allocator_scope). Each frame records its allocator, so that it
+	/// is returned to the same allocator whichever thread frees it.
+	class frame_allocator
+	{
+	public:
+
+		/// Allocate \p size bytes aligned to __STDCPP_DEFAULT_NEW_ALIGNMENT__.
+		///
+		/// \throws std::bad_alloc
+		/// If the memory could not be allocated.
+		virtual void* allocate(std::size_t size) = 0;
+
+		/// Free memory returned by allocate(size). May be called from any
+		/// thread.
+		virtual void deallocate(void* pointer, std::size_t size) noexcept = 0;
+
+	protected:
+
+		~frame_allocator() = default;
+
+	};
+
+	namespace detail
+	{
+		inline thread_local frame_allocator* s_defaultFrameAllocator = nullptr;
+		inline thread_local frame_allocator* s_nextFrameAllocator = nullptr;
+	}
+
+	/// The calling thread's default frame allocator, or nullptr if frames
+	/// are allocated with the global operator new.
+	inline frame_allocator* default_frame_allocator() noexcept
+	{
+		return detail::s_defaultFrameAllocator;
+	}
+
+	/// Set the calling thread's default frame allocator.
+	///
+	/// \param allocator
+	/// The allocator to use, or nullptr to use the global operator new. It
+	/// must outlive every frame allocated from it.
+	///
+	/// \return
+	/// The previous default frame allocator.
+	inline frame_allocator* set_default_frame_allocator(frame_allocator* allocator) noexcept
+	{
+		return std::exchange(detail::s_defaultFrameAllocator, allocator);
+	}
+
+	/// Makes an allocator the calling thread's default frame allocator for
+	/// the lifetime of the object.
+	class frame_allocator_scope
+	{
+	public:
+
+		explicit frame_allocator_scope(frame_allocator& allocator) noexcept
+			: m_previous(set_default_frame_allocator(&allocator))
+		{}
+
+		~frame_allocator_scope()
+		{
+			set_default_frame_allocator(m_previous);
+		}
+
+		frame_allocator_scope(const frame_allocator_scope&) = delete;
+		frame_allocator_scope& operator=(const frame_allocator_scope&) = delete;
+
+	private:
+
+		frame_allocator* m_previous;
+
+	};
+
+	namespace detail
+	{
+		// Placed in front of each coroutine frame to record how to free it.
+		struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) frame_header
+		{
+			// Frees the block holding the header and frame, or nullptr if
+			// the block came from the global operator new.
+			void (*m_deallocate)(void* context, void* block, std::size_t blockSize) noexcept;
+			void* m_context;
+		};
+
+		inline void deallocate_with_frame_allocator(
+			void* context, void* block, std::size_t blockSize) noexcept
+		{
+			static_cast<frame_allocator*>(context)->deallocate(block, blockSize);
+		}
+
+		inline void* allocate_frame_from(frame_allocator* allocator, std::size_t size)
+		{
+			const std::size_t blockSize = sizeof(frame_header) + size;
+			void* block;
+			if (allocator == nullptr)
+			{
+				block = ::operator new(blockSize);
+				::new (block) frame_header{ nullptr, nullptr };
+			}
+			else
+			{
+				block = allocator->allocate(blockSize);
+				::new (block) frame_header{ &deallocate_with_frame_allocator, allocator };
+			}
+
+			return static_cast<frame_header*>(block) + 1;
+		}
+
+		/// Allocate a coroutine frame of \p size bytes from the calling
+		/// thread's default frame allocator.
+		inline void* allocate_frame(std::size_t size)
+		{
+			return allocate_frame_from(default_frame_allocator(), size);
+		}
+
+		// A std-style allocator copied to the end of a frame's block.
+		template<typename ALLOCATOR>
+		struct allocator_frame_storage
+		{
+			// The unit of allocation, so that blocks have the alignment of
+			// frames.
+			struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) unit
+			{
+				unsigned char m_bytes[__STDCPP_DEFAULT_NEW_ALIGNMENT__];
+			};
+
+			using unit_allocator =
+				typename std::allocator_traits<ALLOCATOR>::template rebind_alloc<unit>;
+			using unit_traits = std::allocator_traits<unit_allocator>;
+
+			static constexpr std::size_t allocator_offset(std::size_t blockSize) noexcept
+			{
+				return (blockSize + alignof(unit_allocator) - 1) & ~(alignof(unit_allocator) - 1);
+			}
+
+			static constexpr std::size_t unit_count(std::size_t blockSize) noexcept
+			{
+				return (allocator_offset(blockSize) + sizeof(unit_allocator) + sizeof(unit) - 1) /
+					sizeof(unit);
+			}
+
+			static void deallocate(void* context, void* block, std::size_t blockSize) noexcept
+			{
+				auto* storedAllocator = static_cast<unit_allocator*>(context);
+				unit_allocator allocator{ std::move(*storedAllocator) };
+				storedAllocator->~unit_allocator();
+				unit_traits::deallocate(allocator, static_cast<unit*>(block), unit_count(blockSize));
+			}
+		};
+
+		/// Allocate a coroutine frame of \p size bytes from \p allocator.
+		///
+		/// \p allocator is either a frame_allocator, which must outlive the
+		/// frame, or a std-style allocator, which is copied into the frame's
+		/// block.
+		template<typename ALLOCATOR>
+		void* allocate_frame(std::size_t size, ALLOCATOR& allocator)
+		{
+			if constexpr (std::is_base_of_v<frame_allocator, ALLOCATOR>)
+			{
+				return allocate_frame_from(&allocator, size);
+			}
+			else
+			{
+				using storage = allocator_frame_storage<std::remove_cv_t<ALLOCATOR>>;
+				using unit_allocator = typename storage::unit_allocator;
+
+				const std::size_t blockSize = sizeof(frame_header) + size;
+				unit_allocator unitAllocator{ allocator };
+				void* block = storage::unit_traits::allocate(
+					unitAllocator, storage::unit_count(blockSize));
+
+				void* context = ::new (static_cast<unsigned char*>(block) + storage::allocator_offset(blockSize))
+					unit_allocator{ std::move(unitAllocator) };
+				::new (block) frame_header{ &storage::deallocate, context };
+				return static_cast<frame_header*>(block) + 1;
+			}
+		}
+
+		/// Free a coroutine frame of \p size bytes allocated by
+		/// allocate_frame().
+		inline void deallocate_frame(void* frame, std::size_t size) noexcept
+		{
+			auto* header = static_cast<frame_header*>(frame) - 1;
+			const std::size_t blockSize = sizeof(frame_header) + size;
+			if (header->m_deallocate == nullptr)
+			{
+				::operator delete(header, blockSize);
+			}
+			else
+			{
+				header->m_deallocate(header->m_context, header, blockSize);
+			}
+		}
+
+		/// Set the allocator that the next frame of a next_frame_allocator_promise
+		/// coroutine created by the calling thread is allocated from.
+		///
+		/// \return
+		/// The previous allocator, or nullptr if there was none.
+		inline frame_allocator* exchange_next_frame_allocator(frame_allocator* allocator) noexcept
+		{
+			return std::exchange(s_nextFrameAllocator, allocator);
+		}
+
+		/// Makes an allocator the one that the frame of the next
+		/// next_frame_allocator_promise coroutine created by the calling thread
+		/// is allocated from, for the lifetime of the object. For the library's
+		/// own coroutines that are given storage by their caller, so that they
+		/// need no placement operator new.
+		class next_frame_allocator_scope
+		{
+		public:
+
+			explicit next_frame_allocator_scope(frame_allocator& allocator) noexcept
+				: m_previous(exchange_next_frame_allocator(&allocator))
+			{}
+
+			~next_frame_allocator_scope()
+			{
+				exchange_next_frame_allocator(m_previous);
+			}
+
+			next_frame_allocator_scope(const next_frame_allocator_scope&) = delete;
+			next_frame_allocator_scope& operator=(const next_frame_allocator_scope&) = delete;
+
+		private:
+
+			frame_allocator* m_previous;
+
+		};
+
+		/// Gives a promise type an operator new and operator delete that
+		/// allocate its coroutine frames from the allocator of the enclosing
+		/// next_frame_allocator_scope, or otherwise with the global operator
+		/// new.
+		class next_frame_allocator_promise
+		{
+		public:
+
+			static void* operator new(std::size_t size)
+			{
+				return allocate_frame_from(exchange_next_frame_allocator(nullptr), size);
+			}
+
+			static void operator delete(void* frame, std::size_t size) noexcept
+			{
+				deallocate_frame(frame, size);
+			}
+		};
+
+		/// Gives a promise type an operator new and operator delete that
+		/// allocate its coroutine frames with allocate_frame(), counting them
+		/// as frames of \p KIND when CPPCORO_FRAME_STATS is enabled.
+		template<frame_kind KIND>
+		class frame_allocating_promise
+		{
+		public:
+
+			/// Allocate the coroutine frame from the calling thread's default
+			/// frame allocator.
+			static void* operator new(std::size_t size)
+			{
+				void* frame = allocate_frame(size);
+#if CPPCORO_FRAME_STATS
+				record_frame_allocation(KIND, size);
+#endif
+				return frame;
+			}
+
+			/// Allocate the coroutine frame from the allocator passed as the
+			/// coroutine's leading `std::allocator_arg, allocator` arguments.
+			///
+			/// Always inlined on GCC because its -Wmismatched-new-delete
+			/// otherwise reports the frame's operator delete as not matching
+			/// this operator new, as it is a template.
+			template<typename ALLOCATOR, typename... ARGS>
+#if CPPCORO_COMPILER_GCC
+			__attribute__((always_inline))
+#endif
+			static void* operator new(
+				std::size_t size, std::allocator_arg_t, ALLOCATOR& allocator, ARGS&...)
+			{
+				void* frame = allocate_frame(size, allocator);
+#if CPPCORO_FRAME_STATS
+				record_frame_allocation(KIND, size);
+#endif
+				return frame;
+			}
+
+			static void operator delete(void* frame, std::size_t size) noexcept
+			{
+#if CPPCORO_FRAME_STATS
+				record_frame_deallocation(KIND);
+#endif
+				deallocate_frame(frame, size);
+			}
+		};
+	}
+}
+
+#endif
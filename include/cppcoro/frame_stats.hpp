@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPCORO_FRAME_STATS_HPP_INCLUDED
+#define CPPCORO_FRAME_STATS_HPP_INCLUDED
+
+#include <cppcoro/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace cppcoro
+{
+	/// True if the library was built with the CPPCORO_FRAME_STATS option, so
+	/// that coroutine frame allocations are counted.
+	constexpr bool frame_stats_enabled = CPPCORO_FRAME_STATS != 0;
+
+	/// The coroutine types whose frames are counted separately.
+	enum class frame_kind : std::uint8_t
+	{
+		task,
+		shared_task,
+		generator,
+		recursive_generator,
+		async_generator,
+
+		/// Coroutines used inside the library, such as the ones async_scope
+		/// runs spawned work in.
+		other
+	};
+
+	constexpr std::size_t frame_kind_count = 6;
+
+	/// Counters for the frames of one coroutine type.
+	struct frame_kind_stats
+	{
+		/// The number of histogram buckets. The first bucket counts frames
+		/// of up to 64 bytes and each later one frames of up to twice the
+		/// size of the one before, except the last, which counts frames
+		/// larger than 4096 bytes.
+		static constexpr std::size_t bucket_count = 8;
+
+		/// The largest frame size counted by bucket \p index, or SIZE_MAX
+		/// for the last bucket.
+		static constexpr std::size_t bucket_limit(std::size_t index) noexcept
+		{
+			return index + 1 < bucket_count ? std::size_t(64) << index : ~std::size_t(0);
+		}
+
+		/// The histogram bucket that counts frames of \p size bytes.
+		static constexpr std::size_t bucket_index(std::size_t size) noexcept
+		{
+			std::size_t index = 0;
+			while (size > bucket_limit(index))
+			{
+				++index;
+			}
+			return index;
+		}
+
+		std::uint64_t allocations = 0;
+		std::uint64_t deallocations = 0;
+
+		/// The total size of all frames allocated.
+		std::uint64_t allocated_bytes = 0;
+
+		/// The size of the largest frame allocated.
+		std::uint64_t largest_frame_size = 0;
+
+		/// The number of frames allocated in each size bucket.
+		std::uint64_t size_histogram[bucket_count] = {};
+
+		/// The number of frames that are currently allocated.
+		std::uint64_t live() const noexcept
+		{
+			return allocations > deallocations ? allocations - deallocations : 0;
+		}
+	};
+
+	/// A copy of the frame counters of every coroutine type.
+	struct frame_stats_snapshot
+	{
+		frame_kind_stats kinds[frame_kind_count];
+
+		const frame_kind_stats& operator[](frame_kind kind) const noexcept
+		{
+			return kinds[static_cast<std::size_t>(kind)];
+		}
+	};
+
+	/// Take a snapshot of the coroutine frame counters of every thread.
+	///
+	/// The counters are updated independently of each other, so a snapshot
+	/// taken while other threads create or destroy coroutines may be off by
+	/// the frames in flight. All counters are zero unless the library was
+	/// built with the CPPCORO_FRAME_STATS option.
+	frame_stats_snapshot snapshot_frame_stats() noexcept;
+
+	namespace detail
+	{
+		void record_frame_allocation(frame_kind kind, std::size_t size) noexcept;
+		void record_frame_deallocation(frame_kind kind) noexcept;
+
+		/// Gives a promise type an operator new and operator delete that count
+		/// its frames when CPPCORO_FRAME_STATS is enabled, and that are
+		/// otherwise left to the compiler's defaults.
+		template<frame_kind KIND>
+		class frame_counting_promise
+		{
+#if CPPCORO_FRAME_STATS
+		public:
+
+			static void* operator new(std::size_t size)
+			{
+				void* frame = ::operator new(size);
+				record_frame_allocation(KIND, size);
+				return frame;
+			}
+
+			static void operator delete(void* frame, std::size_t size) noexcept
+			{
+				record_frame_deallocation(KIND);
+				::operator delete(frame, size);
+			}
+#endif
+		};
+	}
+}
+
+#endif
@@ -6,6 +6,7 @@
 #define CPPCORO_GENERATOR_HPP_INCLUDED
 
 #include <cppcoro/coroutine.hpp>
+#include <cppcoro/frame_stats.hpp>
 #include <type_traits>
 #include <utility>
 #include <exception>
@@ -20,7 +21,7 @@ namespace cppcoro
 	namespace detail
 	{
 		template<typename T>
-		class generator_promise
+		class generator_promise : public frame_counting_promise<frame_kind::generator>
 		{
 		public:
 
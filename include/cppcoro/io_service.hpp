@@ -45,6 +45,39 @@ namespace cppcoro
 		/// above this number.
 		io_service(std::uint32_t concurrencyHint);
 
+		/// Initialise the io_service with a concurrency hint and a limit on
+		/// inline completions.
+		///
+		/// \param concurrencyHint
+		/// As for the constructor above.
+		///
+		/// \param maxInlineCompletions
+		/// The maximum number of consecutive I/O operations a thread may
+		/// complete synchronously, without waiting for the event loop,
+		/// before the next one must wait for the event loop. Zero makes
+		/// every operation wait for the event loop. The other constructors
+		/// use a default of 16. Only used on Linux.
+		io_service(std::uint32_t concurrencyHint, std::uint32_t maxInlineCompletions);
+
+		/// Initialise the io_service with a concurrency hint, a limit on
+		/// inline completions and an event batch size.
+		///
+		/// \param concurrencyHint
+		/// As for the constructor above.
+		///
+		/// \param maxInlineCompletions
+		/// As for the constructor above.
+		///
+		/// \param eventBatchSize
+		/// The maximum number of readiness events a thread harvests from the
+		/// operating system each time it polls for events. Zero is treated as
+		/// one. The other constructors use a default of 128. Only used by the
+		/// epoll backend on Linux.
+		io_service(
+			std::uint32_t concurrencyHint,
+			std::uint32_t maxInlineCompletions,
+			std::uint32_t eventBatchSize);
+
 		~io_service();
 
 		io_service(io_service&& other) = delete;
@@ -80,17 +113,21 @@ namespace cppcoro
 			const std::chrono::duration<REP, PERIOD>& delay,
 			cancellation_token cancellationToken = {}) noexcept;
 
+		using event_batch_stats = detail::event_batch_stats;
+
 		/// Process events until the io_service is stopped.
 		///
 		/// \return
-		/// The number of events processed during this call.
+		/// The number of events processed during this call. See
+		/// batch_stats() for the batches they were harvested in.
 		std::uint64_t process_events();
 
 		/// Process events until either the io_service is stopped or
 		/// there are no more pending events in the queue.
 		///
 		/// \return
-		/// The number of events processed during this call.
+		/// The number of events processed during this call. See
+		/// batch_stats() for the batches they were harvested in.
 		std::uint64_t process_pending_events();
 
 		/// Block until either one event is processed or the io_service is stopped.
@@ -108,6 +145,13 @@ namespace cppcoro
 		/// This will either be 0 or 1.
 		std::uint64_t process_one_pending_event();
 
+		/// Counts of the batches of readiness events harvested by the threads
+		/// processing events, over the lifetime of the io_service.
+		///
+		/// Only the epoll backend on Linux harvests events in batches; with
+		/// other backends every count is zero.
+		event_batch_stats batch_stats() const noexcept;
+
 		/// Shut down the io_service.
 		///
 		/// This will cause any threads currently in a call to one of the process_xxx() methods
@@ -134,6 +178,20 @@ namespace cppcoro
 
 		detail::message_queue& get_io_context() noexcept;
 
+#if CPPCORO_OS_LINUX
+		/// Called by an I/O operation before it attempts to complete
+		/// synchronously on the calling thread instead of waiting for the
+		/// event loop to dispatch it.
+		///
+		/// \return
+		/// false once the calling thread has completed this io_service's
+		/// maximum number of consecutive operations inline (see the
+		/// maxInlineCompletions constructor parameter), in which case the operation must
+		/// wait for the event loop. This gives other coroutines waiting on the
+		/// io_service a chance to run.
+		bool try_complete_inline() noexcept;
+#endif
+
 	private:
 #if CPPCORO_OS_WINNT
 		class timer_thread_state;
@@ -147,6 +205,12 @@ namespace cppcoro
 
 		void try_reschedule_overflow_operations() noexcept;
 
+#if CPPCORO_OS_LINUX
+		schedule_operation* try_pop_run_queue() noexcept;
+		bool is_run_queue_empty() noexcept;
+		void wake_parked_thread() noexcept;
+#endif
+
 		bool try_enter_event_loop() noexcept;
 		void exit_event_loop() noexcept;
 
@@ -174,6 +238,24 @@ namespace cppcoro
 		// completion port (eg. due to low memory).
 		std::atomic<schedule_operation*> m_scheduleOperations;
 
+#if CPPCORO_OS_LINUX
+		// Run queue of schedule operations.
+		//
+		// schedule() pushes onto m_runQueueIncoming with a lock-free push.
+		// Event loop threads take the whole list under m_runQueueMutex and
+		// reverse it onto m_runQueueHead so that operations run in FIFO order.
+		std::atomic<schedule_operation*> m_runQueueIncoming;
+		std::mutex m_runQueueMutex;
+		schedule_operation* m_runQueueHead;
+
+		// Number of threads blocked (or about to block) waiting for events.
+		// schedule() only needs to wake the message queue if this is non-zero.
+		std::atomic<std::uint32_t> m_parkedThreadCount;
+
+		// See try_complete_inline().
+		const std::uint32_t m_maxInlineCompletions;
+#endif
+
 #if CPPCORO_OS_WINNT
 		std::atomic<timer_thread_state*> m_timerState;
 #endif
@@ -256,9 +338,18 @@ namespace cppcoro
  		friend class cppcoro::detail::async_operation_cancellable<timed_schedule_operation>;
 
  		bool try_start() noexcept;
+#if CPPCORO_USE_IO_URING
+		std::size_t get_result();
+#else
+		void cancel() noexcept;
+#endif
 
 		std::chrono::high_resolution_clock::time_point m_resumeTime;
-	 	detail::safe_file_handle_t m_timerfd;
+#if CPPCORO_USE_IO_URING
+		detail::linux::io_uring_timespec m_timeout;
+#else
+		detail::linux::timer_node m_timer;
+#endif
 	};
 #endif
 
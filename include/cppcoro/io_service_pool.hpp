@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPCORO_IO_SERVICE_POOL_HPP_INCLUDED
+#define CPPCORO_IO_SERVICE_POOL_HPP_INCLUDED
+
+#include <cppcoro/io_service.hpp>
+#include <cppcoro/recycling_frame_allocator.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace cppcoro
+{
+	namespace net
+	{
+		class socket;
+	}
+
+	/// Settings for constructing an io_service_pool.
+	struct io_service_pool_options
+	{
+		/// The number of event loops, each with its own thread. If zero, one
+		/// per hardware thread.
+		std::uint32_t thread_count = 0;
+
+		/// Restrict the thread of loop i to the i-th CPU this process may run
+		/// on, wrapping around if there are more loops than CPUs.
+		/// io_service_pool::service_for() then picks the loop pinned to the
+		/// CPU that received a socket's traffic.
+		bool pin_threads = false;
+
+		/// Give each loop's thread a recycling_frame_allocator as its default
+		/// frame allocator, so that coroutines created on the loop reuse the
+		/// frames of those that have finished. Coroutines created on the
+		/// loops must then be destroyed before the pool.
+		bool recycle_frames = false;
+	};
+
+	/// A set of io_service event loops, each run by its own thread.
+	///
+	/// Threads that share one io_service all wait on the same OS event queue,
+	/// so every event can wake several of them. Giving each thread its own
+	/// io_service, with its own event queue and run queue, avoids that
+	/// contention. Work is spread over the loops by creating each socket on
+	/// one of them (see next() and service_for()), and a coroutine can move to
+	/// a particular loop with `co_await pool.service(i).schedule()`.
+	class io_service_pool
+	{
+	public:
+
+		/// Initialise to one event loop per core on the current machine.
+		io_service_pool();
+
+		/// Construct a pool with the specified number of event loops.
+		///
+		/// \param threadCount
+		/// The number of event loops, each with its own thread.
+		///
+		/// \param pinThreads
+		/// Whether to pin each loop's thread to a CPU; see
+		/// io_service_pool_options::pin_threads.
+		explicit io_service_pool(std::uint32_t threadCount, bool pinThreads = false);
+
+		explicit io_service_pool(const io_service_pool_options& options);
+
+		/// Stops every event loop and waits for the threads to exit.
+		~io_service_pool();
+
+		io_service_pool(const io_service_pool&) = delete;
+		io_service_pool& operator=(const io_service_pool&) = delete;
+
+		/// The number of event loops.
+		std::uint32_t size() const noexcept { return static_cast<std::uint32_t>(m_services.size()); }
+
+		/// The event loop with the specified index, which must be less than
+		/// size().
+		io_service& service(std::uint32_t index) noexcept { return *m_services[index]; }
+
+		/// The event loops in turn, for assigning new sockets round-robin.
+		io_service& next() noexcept;
+
+		/// The event loop that should own a connected socket.
+		///
+		/// On Linux this is the loop for the CPU that processed the socket's
+		/// most recent incoming packets (SO_INCOMING_CPU), so that the
+		/// connection is handled where its network traffic arrives. Move the
+		/// socket to it with socket::rebind(). Elsewhere, or if the CPU isn't
+		/// known, this is next().
+		io_service& service_for(net::socket& socket) noexcept;
+
+		/// The event loop the calling thread runs, or nullptr if it isn't
+		/// one of the pool's threads.
+		io_service* current() const noexcept;
+
+		/// A snapshot of the loops' frame recycling counters, summed over
+		/// all loops. All zero unless the pool recycles frames.
+		recycling_frame_allocator_stats frame_stats() const noexcept;
+
+	private:
+
+		void run_event_loop(std::uint32_t index) noexcept;
+
+		void shutdown() noexcept;
+
+		std::vector<std::unique_ptr<io_service>> m_services;
+
+		// The CPU each loop's thread is pinned to. Empty if the threads
+		// aren't pinned.
+		std::vector<std::uint32_t> m_cpus;
+
+		// Each loop's default frame allocator. Null if frames aren't
+		// recycled.
+		std::unique_ptr<recycling_frame_allocator[]> m_frameAllocators;
+
+		std::vector<std::thread> m_threads;
+
+		std::atomic<std::uint32_t> m_nextIndex;
+
+	};
+}
+
+#endif
@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPCORO_NET_BUFFER_HPP_INCLUDED
+#define CPPCORO_NET_BUFFER_HPP_INCLUDED
+
+#include <cppcoro/config.hpp>
+
+#include <cstddef>
+
+#if CPPCORO_OS_WINNT
+# include <cppcoro/detail/win32.hpp>
+#endif
+
+namespace cppcoro::net
+{
+	/// A contiguous region of memory to be sent by a scatter/gather socket
+	/// operation.
+	///
+	/// The layout matches the platform's native I/O vector (WSABUF on Windows,
+	/// struct iovec elsewhere) so that an array of buffers can be handed
+	/// straight to the OS without being copied.
+	class const_buffer
+	{
+	public:
+
+		constexpr const_buffer() noexcept
+#if CPPCORO_OS_WINNT
+			: m_buffer()
+#else
+			: m_data(nullptr)
+			, m_size(0)
+#endif
+		{}
+
+		/// \param data
+		/// Pointer to the start of the region.
+		///
+		/// \param size
+		/// Size of the region in bytes. On Windows this is truncated to the
+		/// maximum size of a WSABUF.
+		constexpr const_buffer(const void* data, std::size_t size) noexcept
+#if CPPCORO_OS_WINNT
+			: m_buffer(const_cast<void*>(data), size)
+#else
+			: m_data(data)
+			, m_size(size)
+#endif
+		{}
+
+#if CPPCORO_OS_WINNT
+		const void* data() const noexcept { return m_buffer.buf; }
+		std::size_t size() const noexcept { return m_buffer.len; }
+#else
+		const void* data() const noexcept { return m_data; }
+		std::size_t size() const noexcept { return m_size; }
+#endif
+
+	private:
+
+#if CPPCORO_OS_WINNT
+		cppcoro::detail::win32::wsabuf m_buffer;
+#else
+		const void* m_data;
+		std::size_t m_size;
+#endif
+
+	};
+
+	/// A contiguous region of memory to be filled by a scatter/gather socket
+	/// operation.
+	///
+	/// Has the same layout as const_buffer.
+	class mutable_buffer
+	{
+	public:
+
+		constexpr mutable_buffer() noexcept
+#if CPPCORO_OS_WINNT
+			: m_buffer()
+#else
+			: m_data(nullptr)
+			, m_size(0)
+#endif
+		{}
+
+		constexpr mutable_buffer(void* data, std::size_t size) noexcept
+#if CPPCORO_OS_WINNT
+			: m_buffer(data, size)
+#else
+			: m_data(data)
+			, m_size(size)
+#endif
+		{}
+
+#if CPPCORO_OS_WINNT
+		void* data() const noexcept { return m_buffer.buf; }
+		std::size_t size() const noexcept { return m_buffer.len; }
+#else
+		void* data() const noexcept { return m_data; }
+		std::size_t size() const noexcept { return m_size; }
+#endif
+
+		operator const_buffer() const noexcept { return const_buffer{ data(), size() }; }
+
+	private:
+
+#if CPPCORO_OS_WINNT
+		cppcoro::detail::win32::wsabuf m_buffer;
+#else
+		void* m_data;
+		std::size_t m_size;
+#endif
+
+	};
+}
+
+#endif
@@ -7,22 +7,36 @@
 
 #include <cppcoro/config.hpp>
 
+#include <cppcoro/net/buffer.hpp>
 #include <cppcoro/net/ip_endpoint.hpp>
 #include <cppcoro/net/socket_accept_operation.hpp>
 #include <cppcoro/net/socket_connect_operation.hpp>
 #include <cppcoro/net/socket_disconnect_operation.hpp>
 #include <cppcoro/net/socket_recv_operation.hpp>
 #include <cppcoro/net/socket_recv_from_operation.hpp>
+#include <cppcoro/net/socket_recv_many_from_operation.hpp>
 #include <cppcoro/net/socket_send_operation.hpp>
+#include <cppcoro/net/socket_send_file_operation.hpp>
 #include <cppcoro/net/socket_send_to_operation.hpp>
+#include <cppcoro/net/socket_send_many_to_operation.hpp>
 
 #include <cppcoro/cancellation_token.hpp>
 
 #include <cppcoro/detail/platform.hpp>
 
+#include <utility>
+
+#if __has_include(<span>)
+# include <span>
+#endif
+#if CPPCORO_OS_LINUX || CPPCORO_OS_DARWIN
+# include <cppcoro/detail/message_queue.hpp>
+#endif
+
 namespace cppcoro
 {
 	class io_service;
+	class readable_file;
 
 	namespace net
 	{
@@ -93,6 +107,17 @@ namespace cppcoro
 			/// end-point of the socket's associated address-family.
 			const ip_endpoint& remote_endpoint() const noexcept { return m_remoteEndPoint; }
 
+#if CPPCORO_OS_LINUX || CPPCORO_OS_DARWIN
+			/// Move the socket to another io_service, so that its operations
+			/// complete on that io_service's event loop.
+			///
+			/// There must be no operations in progress on the socket.
+			///
+			/// Not available on Windows, where a socket's I/O completion port
+			/// can't be changed.
+			void rebind(io_service& ioSvc) noexcept;
+#endif
+
 			/// Bind the local end of this socket to the specified local end-point.
 			///
 			/// \param localEndPoint
@@ -182,6 +207,69 @@ namespace cppcoro
 				std::size_t size,
 				cancellation_token ct) noexcept;
 
+			/// Send the contents of several buffers, in order, with a single
+			/// gather operation.
+			///
+			/// \param buffers
+			/// Pointer to an array of \p bufferCount buffers. The array and
+			/// the memory it refers to must remain valid until the operation
+			/// completes.
+			///
+			/// \return
+			/// An awaitable object that will start the send operation when
+			/// co_await'ed. The result of the co_await expression is the total
+			/// number of bytes sent, which may be less than the combined size
+			/// of the buffers.
+			[[nodiscard]]
+			socket_send_operation send(
+				const const_buffer* buffers,
+				std::size_t bufferCount) noexcept;
+			[[nodiscard]]
+			socket_send_operation_cancellable send(
+				const const_buffer* buffers,
+				std::size_t bufferCount,
+				cancellation_token ct) noexcept;
+
+			/// Send part of a file without copying it through a user buffer.
+			///
+			/// \param file
+			/// The file to send from. It must remain open until the operation
+			/// completes.
+			///
+			/// \param offset
+			/// The offset within the file to start sending from. The file's
+			/// own position, if it has one, is not used or changed.
+			///
+			/// \param byteCount
+			/// The number of bytes to send.
+			///
+			/// \return
+			/// An awaitable object that will start the send operation when
+			/// co_await'ed. The result of the co_await expression is the number
+			/// of bytes sent. Like send(), this may be less than \p byteCount,
+			/// in which case the caller should send the remainder starting
+			/// from the new offset. It is zero once \p offset reaches the end
+			/// of the file.
+			///
+			/// The kernel reads the file on the thread that performs the send.
+			/// The first attempt is made on the calling thread. On Linux, if
+			/// the socket has no room, the operation waits for it and then
+			/// sends from a blocking I/O thread, so that a range that is not in
+			/// the page cache does not stall the io_service's event loop. With
+			/// the io_uring backend, and on Darwin, that send happens on the
+			/// thread running the event loop instead.
+			[[nodiscard]]
+			socket_send_file_operation send_file(
+				const readable_file& file,
+				std::uint64_t offset,
+				std::size_t byteCount) noexcept;
+			[[nodiscard]]
+			socket_send_file_operation_cancellable send_file(
+				const readable_file& file,
+				std::uint64_t offset,
+				std::size_t byteCount,
+				cancellation_token ct) noexcept;
+
 			[[nodiscard]]
 			socket_recv_operation recv(
 				void* buffer,
@@ -192,6 +280,56 @@ namespace cppcoro
 				std::size_t size,
 				cancellation_token ct) noexcept;
 
+			/// Receive into several buffers, filling each in turn, with a
+			/// single scatter operation.
+			///
+			/// \param buffers
+			/// Pointer to an array of \p bufferCount buffers. The array and
+			/// the memory it refers to must remain valid until the operation
+			/// completes.
+			///
+			/// \return
+			/// An awaitable object that will start the receive operation when
+			/// co_await'ed. The result of the co_await expression is the total
+			/// number of bytes received, or zero if the connection was closed.
+			[[nodiscard]]
+			socket_recv_operation recv(
+				const mutable_buffer* buffers,
+				std::size_t bufferCount) noexcept;
+			[[nodiscard]]
+			socket_recv_operation_cancellable recv(
+				const mutable_buffer* buffers,
+				std::size_t bufferCount,
+				cancellation_token ct) noexcept;
+
+#if __cpp_lib_span
+			[[nodiscard]]
+			socket_send_operation send(std::span<const const_buffer> buffers) noexcept
+			{
+				return send(buffers.data(), buffers.size());
+			}
+			[[nodiscard]]
+			socket_send_operation_cancellable send(
+				std::span<const const_buffer> buffers,
+				cancellation_token ct) noexcept
+			{
+				return send(buffers.data(), buffers.size(), std::move(ct));
+			}
+
+			[[nodiscard]]
+			socket_recv_operation recv(std::span<const mutable_buffer> buffers) noexcept
+			{
+				return recv(buffers.data(), buffers.size());
+			}
+			[[nodiscard]]
+			socket_recv_operation_cancellable recv(
+				std::span<const mutable_buffer> buffers,
+				cancellation_token ct) noexcept
+			{
+				return recv(buffers.data(), buffers.size(), std::move(ct));
+			}
+#endif
+
 			[[nodiscard]]
 			socket_recv_from_operation recv_from(
 				void* buffer,
@@ -214,6 +352,86 @@ namespace cppcoro
 				std::size_t size,
 				cancellation_token ct) noexcept;
 
+			/// Receive up to \p datagramCount datagrams with as few system
+			/// calls as possible.
+			///
+			/// The operation completes once at least one datagram has been
+			/// received, filling the slots in order with as many datagrams as
+			/// are available without blocking.
+			///
+			/// \param datagrams
+			/// Pointer to an array of \p datagramCount slots. The buffer of each
+			/// slot must be set; its source and size are set when a datagram
+			/// is received into it. The array must remain valid until the
+			/// operation completes.
+			///
+			/// \return
+			/// An awaitable object that will start the receive operation when
+			/// co_await'ed. The result of the co_await expression is the number
+			/// of slots filled. Winsock has no batched receive, so on Windows
+			/// this is at most one.
+			[[nodiscard]]
+			socket_recv_many_from_operation recv_many_from(
+				incoming_datagram* datagrams,
+				std::size_t datagramCount) noexcept;
+			[[nodiscard]]
+			socket_recv_many_from_operation_cancellable recv_many_from(
+				incoming_datagram* datagrams,
+				std::size_t datagramCount,
+				cancellation_token ct) noexcept;
+
+			/// Send up to \p datagramCount datagrams with as few system calls
+			/// as possible.
+			///
+			/// \param datagrams
+			/// Pointer to an array of \p datagramCount datagrams. The array and
+			/// the memory it refers to must remain valid until the operation
+			/// completes.
+			///
+			/// \return
+			/// An awaitable object that will start the send operation when
+			/// co_await'ed. The result of the co_await expression is the number
+			/// of datagrams sent, which may be fewer than \p datagramCount if
+			/// the socket's send buffer fills up. Winsock has no batched send,
+			/// so on Windows this is at most one.
+			[[nodiscard]]
+			socket_send_many_to_operation send_many_to(
+				const outgoing_datagram* datagrams,
+				std::size_t datagramCount) noexcept;
+			[[nodiscard]]
+			socket_send_many_to_operation_cancellable send_many_to(
+				const outgoing_datagram* datagrams,
+				std::size_t datagramCount,
+				cancellation_token ct) noexcept;
+
+#if __cpp_lib_span
+			[[nodiscard]]
+			socket_recv_many_from_operation recv_many_from(std::span<incoming_datagram> datagrams) noexcept
+			{
+				return recv_many_from(datagrams.data(), datagrams.size());
+			}
+			[[nodiscard]]
+			socket_recv_many_from_operation_cancellable recv_many_from(
+				std::span<incoming_datagram> datagrams,
+				cancellation_token ct) noexcept
+			{
+				return recv_many_from(datagrams.data(), datagrams.size(), std::move(ct));
+			}
+
+			[[nodiscard]]
+			socket_send_many_to_operation send_many_to(std::span<const outgoing_datagram> datagrams) noexcept
+			{
+				return send_many_to(datagrams.data(), datagrams.size());
+			}
+			[[nodiscard]]
+			socket_send_many_to_operation_cancellable send_many_to(
+				std::span<const outgoing_datagram> datagrams,
+				cancellation_token ct) noexcept
+			{
+				return send_many_to(datagrams.data(), datagrams.size(), std::move(ct));
+			}
+#endif
+
 			void close_send();
 			void close_recv();
 
@@ -240,9 +458,29 @@ namespace cppcoro
 
 			friend class socket_accept_operation_impl;
 			friend class socket_connect_operation_impl;
+			friend class socket_disconnect_operation_impl;
+			friend class socket_recv_operation_impl;
+			friend class socket_recv_from_operation_impl;
+			friend class socket_recv_many_from_operation_impl;
+			friend class socket_send_operation_impl;
+			friend class socket_send_file_operation_impl;
+			friend class socket_send_to_operation_impl;
+			friend class socket_send_many_to_operation_impl;
+
+#if CPPCORO_OS_LINUX || CPPCORO_OS_DARWIN
+			/// Wait for the socket to become ready for \p operation, which then
+			/// runs its m_completeFunc.
+			void watch(
+				cppcoro::detail::async_operation_base& operation,
+				cppcoro::detail::watch_type events);
+#endif
 
 			cppcoro::detail::socket_handle_t m_handle;
 			cppcoro::io_service* m_ioService;
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+			// The socket's persistent epoll registration, if it has one.
+			cppcoro::detail::linux::fd_registration* m_registration;
+#endif
 
 			ip_endpoint m_localEndPoint;
 			ip_endpoint m_remoteEndPoint;
@@ -44,6 +44,9 @@ namespace cppcoro
 			socket& m_listeningSocket;
 			socket& m_acceptingSocket;
 			alignas(8) std::uint8_t m_addressBuffer[88];
+#if CPPCORO_USE_IO_URING
+			std::uint32_t m_addressLength;
+#endif
 #if CPPCORO_COMPILER_MSVC
 # pragma warning(pop)
 #endif
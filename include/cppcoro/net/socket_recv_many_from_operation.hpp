@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPCORO_NET_SOCKET_RECV_MANY_FROM_OPERATION_HPP_INCLUDED
+#define CPPCORO_NET_SOCKET_RECV_MANY_FROM_OPERATION_HPP_INCLUDED
+
+#include <cppcoro/config.hpp>
+#include <cppcoro/cancellation_token.hpp>
+#include <cppcoro/net/buffer.hpp>
+#include <cppcoro/net/ip_endpoint.hpp>
+
+#include <cstdint>
+
+#include <cppcoro/detail/platform.hpp>
+#include <cppcoro/detail/async_operation.hpp>
+
+namespace cppcoro::net
+{
+	class socket;
+
+	/// A slot to be filled with one datagram by socket::recv_many_from().
+	struct incoming_datagram
+	{
+		/// The memory to receive the datagram into.
+		mutable_buffer buffer;
+
+		/// Set to the address the datagram was sent from.
+		ip_endpoint source;
+
+		/// Set to the size of the datagram. If this is larger than
+		/// buffer.size() then the datagram was truncated to fit the buffer.
+		std::size_t size = 0;
+	};
+
+	class socket_recv_many_from_operation_impl
+	{
+	public:
+
+		socket_recv_many_from_operation_impl(
+			socket& s,
+			incoming_datagram* datagrams,
+			std::size_t datagramCount) noexcept
+			: m_socket(s)
+			, m_datagrams(datagrams)
+			, m_datagramCount(datagramCount)
+		{}
+
+		bool try_start(cppcoro::detail::async_operation_base& operation) noexcept;
+		void cancel(cppcoro::detail::async_operation_base& operation) noexcept;
+		std::size_t get_result(cppcoro::detail::async_operation_base& operation);
+
+	private:
+
+		socket& m_socket;
+		incoming_datagram* m_datagrams;
+		std::size_t m_datagramCount;
+
+#if CPPCORO_OS_WINNT
+		static constexpr std::size_t sockaddrStorageAlignment = 4;
+
+		// Storage suitable for either SOCKADDR_IN or SOCKADDR_IN6
+		alignas(sockaddrStorageAlignment) std::uint8_t m_sourceSockaddrStorage[28];
+		int m_sourceSockaddrLength;
+#endif
+
+	};
+
+	class socket_recv_many_from_operation
+		: public cppcoro::detail::async_operation<socket_recv_many_from_operation>
+	{
+	public:
+
+		socket_recv_many_from_operation(
+			socket& s,
+			incoming_datagram* datagrams,
+			std::size_t datagramCount,
+			cppcoro::io_service* ioService) noexcept
+			: cppcoro::detail::async_operation<socket_recv_many_from_operation>(ioService)
+			, m_impl(s, datagrams, datagramCount)
+		{}
+
+	private:
+
+		friend class cppcoro::detail::async_operation<socket_recv_many_from_operation>;
+
+		bool try_start() noexcept { return m_impl.try_start(*this); }
+		decltype(auto) get_result() { return m_impl.get_result(*this); }
+
+		socket_recv_many_from_operation_impl m_impl;
+
+	};
+
+	class socket_recv_many_from_operation_cancellable
+		: public cppcoro::detail::async_operation_cancellable<socket_recv_many_from_operation_cancellable>
+	{
+	public:
+
+		socket_recv_many_from_operation_cancellable(
+			socket& s,
+			incoming_datagram* datagrams,
+			std::size_t datagramCount,
+			cppcoro::io_service* ioService,
+			cancellation_token&& ct) noexcept
+			: cppcoro::detail::async_operation_cancellable<socket_recv_many_from_operation_cancellable>(ioService, std::move(ct))
+			, m_impl(s, datagrams, datagramCount)
+		{}
+
+	private:
+
+		friend class cppcoro::detail::async_operation_cancellable<socket_recv_many_from_operation_cancellable>;
+
+		bool try_start() noexcept { return m_impl.try_start(*this); }
+		decltype(auto) get_result() { return m_impl.get_result(*this); }
+
+		socket_recv_many_from_operation_impl m_impl;
+
+	};
+}
+
+#endif
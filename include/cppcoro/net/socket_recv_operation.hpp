@@ -7,6 +7,7 @@
 
 #include <cppcoro/config.hpp>
 #include <cppcoro/cancellation_token.hpp>
+#include <cppcoro/net/buffer.hpp>
 
 #include <cstdint>
 
@@ -32,6 +33,23 @@ namespace cppcoro::net
 			, m_buffer(buffer)
 			, m_byteCount(byteCount)
 #endif
+			, m_buffers(nullptr)
+			, m_bufferCount(0)
+		{}
+
+		socket_recv_operation_impl(
+			socket& s,
+			const mutable_buffer* buffers,
+			std::size_t bufferCount) noexcept
+			: m_socket(s)
+#if CPPCORO_OS_WINNT
+			, m_buffer()
+#elif CPPCORO_OS_LINUX || CPPCORO_OS_DARWIN
+			, m_buffer(nullptr)
+			, m_byteCount(0)
+#endif
+			, m_buffers(buffers)
+			, m_bufferCount(bufferCount)
 		{}
 
 		bool try_start(cppcoro::detail::async_operation_base& operation) noexcept;
@@ -46,6 +64,9 @@ namespace cppcoro::net
 		void* m_buffer;
 		std::size_t m_byteCount;
 #endif
+		// Set for a scatter/gather operation, in which case m_buffer is unused.
+		const mutable_buffer* m_buffers;
+		std::size_t m_bufferCount;
 
 	};
 
@@ -63,6 +84,15 @@ namespace cppcoro::net
 				, m_impl(s, buffer, byteCount)
 		{}
 
+		socket_recv_operation(
+			socket& s,
+			const mutable_buffer* buffers,
+			std::size_t bufferCount,
+			cppcoro::io_service* ioService) noexcept
+			: cppcoro::detail::async_operation<socket_recv_operation>(ioService)
+			, m_impl(s, buffers, bufferCount)
+		{}
+
 	private:
 
 		friend class cppcoro::detail::async_operation<socket_recv_operation>;
@@ -88,6 +118,16 @@ namespace cppcoro::net
 			, m_impl(s, buffer, byteCount)
 		{}
 
+		socket_recv_operation_cancellable(
+			socket& s,
+			const mutable_buffer* buffers,
+			std::size_t bufferCount,
+			cppcoro::io_service* ioService,
+			cancellation_token&& ct) noexcept
+			: cppcoro::detail::async_operation_cancellable<socket_recv_operation_cancellable>(ioService, std::move(ct))
+			, m_impl(s, buffers, bufferCount)
+		{}
+
 	private:
 
 		friend class cppcoro::detail::async_operation_cancellable<socket_recv_operation_cancellable>;
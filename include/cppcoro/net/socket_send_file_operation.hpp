@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPCORO_NET_SOCKET_SEND_FILE_OPERATION_HPP_INCLUDED
+#define CPPCORO_NET_SOCKET_SEND_FILE_OPERATION_HPP_INCLUDED
+
+#include <cppcoro/config.hpp>
+#include <cppcoro/cancellation_token.hpp>
+
+#include <atomic>
+#include <cstdint>
+
+#include <cppcoro/detail/platform.hpp>
+#include <cppcoro/detail/async_operation.hpp>
+
+namespace cppcoro::net
+{
+	class socket;
+
+	class socket_send_file_operation_impl
+	{
+	public:
+
+		socket_send_file_operation_impl(
+			socket& s,
+			cppcoro::detail::file_handle_t fileHandle,
+			std::uint64_t offset,
+			std::size_t byteCount) noexcept
+			: m_socket(s)
+			, m_fileHandle(fileHandle)
+			, m_offset(offset)
+			, m_byteCount(byteCount)
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+			, m_completionCallback(nullptr)
+			, m_offloaded(false)
+#endif
+		{}
+
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+		using callback_type = cppcoro::detail::async_operation_base::callback_type;
+
+		/// If the socket has no room, wait until it does and then call
+		/// \p onSocketReady, which should forward to on_socket_ready(),
+		/// in place of the operation's completion callback.
+		bool try_start(
+			cppcoro::detail::async_operation_base& operation,
+			callback_type* onSocketReady) noexcept;
+
+		/// Send the file range from a blocking I/O thread, as reading it may
+		/// block on the disk, and then complete the operation.
+		void on_socket_ready(cppcoro::detail::async_operation_base& operation) noexcept;
+#else
+		bool try_start(cppcoro::detail::async_operation_base& operation) noexcept;
+#endif
+		void cancel(cppcoro::detail::async_operation_base& operation) noexcept;
+
+	private:
+
+		socket& m_socket;
+		cppcoro::detail::file_handle_t m_fileHandle;
+		std::uint64_t m_offset;
+		std::size_t m_byteCount;
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+		// The operation's own callback, replaced while waiting for the socket.
+		callback_type* m_completionCallback;
+		// Set once the send has been handed to a blocking I/O thread.
+		std::atomic<bool> m_offloaded;
+#endif
+
+	};
+
+	class socket_send_file_operation
+		: public cppcoro::detail::async_operation<socket_send_file_operation>
+	{
+	public:
+
+		socket_send_file_operation(
+			socket& s,
+			cppcoro::detail::file_handle_t fileHandle,
+			std::uint64_t offset,
+			std::size_t byteCount,
+			cppcoro::io_service* ioService) noexcept
+			: cppcoro::detail::async_operation<socket_send_file_operation>(ioService)
+			, m_impl(s, fileHandle, offset, byteCount)
+		{}
+
+	private:
+
+		friend class cppcoro::detail::async_operation<socket_send_file_operation>;
+
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+		bool try_start() noexcept { return m_impl.try_start(*this, &on_socket_ready); }
+
+		static void on_socket_ready(cppcoro::detail::async_operation_base* operation) noexcept
+		{
+			auto* self = static_cast<socket_send_file_operation*>(operation);
+			self->m_impl.on_socket_ready(*self);
+		}
+#else
+		bool try_start() noexcept { return m_impl.try_start(*this); }
+#endif
+
+		socket_send_file_operation_impl m_impl;
+
+	};
+
+	class socket_send_file_operation_cancellable
+		: public cppcoro::detail::async_operation_cancellable<socket_send_file_operation_cancellable>
+	{
+	public:
+
+		socket_send_file_operation_cancellable(
+			socket& s,
+			cppcoro::detail::file_handle_t fileHandle,
+			std::uint64_t offset,
+			std::size_t byteCount,
+			cppcoro::io_service* ioService,
+			cancellation_token&& ct) noexcept
+			: cppcoro::detail::async_operation_cancellable<socket_send_file_operation_cancellable>(ioService, std::move(ct))
+			, m_impl(s, fileHandle, offset, byteCount)
+		{}
+
+	private:
+
+		friend class cppcoro::detail::async_operation_cancellable<socket_send_file_operation_cancellable>;
+
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+		bool try_start() noexcept { return m_impl.try_start(*this, &on_socket_ready); }
+		void cancel() noexcept { m_impl.cancel(*this); }
+
+		static void on_socket_ready(cppcoro::detail::async_operation_base* operation) noexcept
+		{
+			auto* self = static_cast<socket_send_file_operation_cancellable*>(operation);
+			self->m_impl.on_socket_ready(*self);
+		}
+#else
+		bool try_start() noexcept { return m_impl.try_start(*this); }
+#endif
+
+		socket_send_file_operation_impl m_impl;
+
+	};
+}
+
+#endif
@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPCORO_NET_SOCKET_SEND_MANY_TO_OPERATION_HPP_INCLUDED
+#define CPPCORO_NET_SOCKET_SEND_MANY_TO_OPERATION_HPP_INCLUDED
+
+#include <cppcoro/config.hpp>
+#include <cppcoro/cancellation_token.hpp>
+#include <cppcoro/net/buffer.hpp>
+#include <cppcoro/net/ip_endpoint.hpp>
+
+#include <cstdint>
+
+#include <cppcoro/detail/platform.hpp>
+#include <cppcoro/detail/async_operation.hpp>
+
+namespace cppcoro::net
+{
+	class socket;
+
+	/// A datagram to be sent by socket::send_many_to().
+	struct outgoing_datagram
+	{
+		/// The contents of the datagram.
+		const_buffer buffer;
+
+		/// The address to send the datagram to.
+		ip_endpoint destination;
+	};
+
+	class socket_send_many_to_operation_impl
+	{
+	public:
+
+		socket_send_many_to_operation_impl(
+			socket& s,
+			const outgoing_datagram* datagrams,
+			std::size_t datagramCount) noexcept
+			: m_socket(s)
+			, m_datagrams(datagrams)
+			, m_datagramCount(datagramCount)
+		{}
+
+		bool try_start(cppcoro::detail::async_operation_base& operation) noexcept;
+		void cancel(cppcoro::detail::async_operation_base& operation) noexcept;
+		std::size_t get_result(cppcoro::detail::async_operation_base& operation);
+
+	private:
+
+		socket& m_socket;
+		const outgoing_datagram* m_datagrams;
+		std::size_t m_datagramCount;
+
+	};
+
+	class socket_send_many_to_operation
+		: public cppcoro::detail::async_operation<socket_send_many_to_operation>
+	{
+	public:
+
+		socket_send_many_to_operation(
+			socket& s,
+			const outgoing_datagram* datagrams,
+			std::size_t datagramCount,
+			cppcoro::io_service* ioService) noexcept
+			: cppcoro::detail::async_operation<socket_send_many_to_operation>(ioService)
+			, m_impl(s, datagrams, datagramCount)
+		{}
+
+	private:
+
+		friend class cppcoro::detail::async_operation<socket_send_many_to_operation>;
+
+		bool try_start() noexcept { return m_impl.try_start(*this); }
+		decltype(auto) get_result() { return m_impl.get_result(*this); }
+
+		socket_send_many_to_operation_impl m_impl;
+
+	};
+
+	class socket_send_many_to_operation_cancellable
+		: public cppcoro::detail::async_operation_cancellable<socket_send_many_to_operation_cancellable>
+	{
+	public:
+
+		socket_send_many_to_operation_cancellable(
+			socket& s,
+			const outgoing_datagram* datagrams,
+			std::size_t datagramCount,
+			cppcoro::io_service* ioService,
+			cancellation_token&& ct) noexcept
+			: cppcoro::detail::async_operation_cancellable<socket_send_many_to_operation_cancellable>(ioService, std::move(ct))
+			, m_impl(s, datagrams, datagramCount)
+		{}
+
+	private:
+
+		friend class cppcoro::detail::async_operation_cancellable<socket_send_many_to_operation_cancellable>;
+
+		bool try_start() noexcept { return m_impl.try_start(*this); }
+		decltype(auto) get_result() { return m_impl.get_result(*this); }
+
+		socket_send_many_to_operation_impl m_impl;
+
+	};
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include <cppcoro/generator.hpp>
 
 #include <cppcoro/coroutine.hpp>
+#include <cppcoro/frame_stats.hpp>
 #include <type_traits>
 #include <utility>
 #include <cassert>
@@ -21,6 +22,7 @@ namespace cppcoro
 	public:
 
 		class promise_type final
+			: public detail::frame_counting_promise<frame_kind::recursive_generator>
 		{
 		public:
 
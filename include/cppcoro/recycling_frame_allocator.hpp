@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPCORO_RECYCLING_FRAME_ALLOCATOR_HPP_INCLUDED
+#define CPPCORO_RECYCLING_FRAME_ALLOCATOR_HPP_INCLUDED
+
+#include <cppcoro/frame_allocator.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+namespace cppcoro
+{
+	/// Counters describing how well a recycling_frame_allocator reuses
+	/// frames.
+	struct recycling_frame_allocator_stats
+	{
+		/// The number of allocations served with a recycled frame.
+		std::uint64_t hits = 0;
+
+		/// The number of allocations that had to use the heap.
+		std::uint64_t misses = 0;
+	};
+
+	/// A frame allocator that keeps freed frames for reuse, so that once a
+	/// program has created the largest number of coroutines it has live at
+	/// once, creating more does not allocate from the heap.
+	///
+	/// Frames are grouped into size classes of 64 bytes, up to
+	/// max_recycled_size; larger frames use the global operator new.
+	///
+	/// Only one thread may allocate from the allocator: the first thread to
+	/// do so, which is normally the thread that has it as its default frame
+	/// allocator. Frames may be freed on any thread. Frames freed on other
+	/// threads are handed back through a lock-free list, which the owning
+	/// thread takes over in one go when it runs out of frames of that size.
+	///
+	/// Memory is only returned to the heap when the allocator is destroyed,
+	/// which must be after every frame allocated from it has been freed.
+	class recycling_frame_allocator final : public frame_allocator
+	{
+	public:
+
+		static constexpr std::size_t size_class_granularity = 64;
+		static constexpr std::size_t max_recycled_size = 2048;
+
+		recycling_frame_allocator() noexcept;
+		~recycling_frame_allocator();
+
+		recycling_frame_allocator(const recycling_frame_allocator&) = delete;
+		recycling_frame_allocator& operator=(const recycling_frame_allocator&) = delete;
+
+		/// A snapshot of the allocator's counters. May be called from any
+		/// thread.
+		recycling_frame_allocator_stats stats() const noexcept;
+
+		void* allocate(std::size_t size) override;
+		void deallocate(void* pointer, std::size_t size) noexcept override;
+
+	private:
+
+		static constexpr std::size_t size_class_count =
+			max_recycled_size / size_class_granularity;
+
+		struct free_block
+		{
+			free_block* m_next;
+		};
+
+		struct size_class
+		{
+			// Frames freed on the owning thread.
+			free_block* m_freeList = nullptr;
+
+			// Frames freed on other threads.
+			std::atomic<free_block*> m_remoteFreeList{ nullptr };
+		};
+
+		static std::size_t size_class_index(std::size_t size) noexcept
+		{
+			return (size - 1) / size_class_granularity;
+		}
+
+		static void free_all(free_block* list) noexcept;
+
+		// Increment a counter that only the owning thread writes.
+		static void add(std::atomic<std::uint64_t>& counter) noexcept
+		{
+			counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		// The thread that allocates from the allocator, set by its first
+		// allocation.
+		std::thread::id m_owner;
+
+		size_class m_sizeClasses[size_class_count];
+
+		std::atomic<std::uint64_t> m_hitCount;
+		std::atomic<std::uint64_t> m_missCount;
+
+	};
+}
+
+#endif
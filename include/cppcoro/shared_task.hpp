@@ -8,12 +8,15 @@
 #include <cppcoro/config.hpp>
 #include <cppcoro/awaitable_traits.hpp>
 #include <cppcoro/broken_promise.hpp>
+#include <cppcoro/frame_allocator.hpp>
 #include <cppcoro/task.hpp>
 
 #include <cppcoro/detail/remove_rvalue_reference.hpp>
 
 #include <atomic>
+#include <cstddef>
 #include <exception>
+#include <memory>
 #include <utility>
 #include <type_traits>
 
@@ -32,7 +35,7 @@ namespace cppcoro
 			shared_task_waiter* m_next;
 		};
 
-		class shared_task_promise_base
+		class shared_task_promise_base : public frame_allocating_promise<frame_kind::shared_task>
 		{
 			friend struct final_awaiter;
 
@@ -8,6 +8,7 @@
 /// Windows XP does not support CancelIoEx and thus cannot thread-safely cancel io requests
 #if !CPPCORO_OS_WINNT || CPPCORO_OS_WINNT >= 0x0600
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <thread>
@@ -17,6 +18,107 @@
 
 namespace cppcoro
 {
+	class spin_wait;
+
+	/// Settings for constructing a static_thread_pool.
+	struct static_thread_pool_options
+	{
+		/// Which CPUs the pool's worker threads may run on.
+		enum class affinity_policy
+		{
+			/// Workers may run on any CPU.
+			none,
+
+			/// Worker i may only run on the CPUs in
+			/// cpu_sets[i % cpu_sets.size()].
+			cpu_sets,
+
+			/// Each worker is pinned to one hardware thread of a different
+			/// physical core, wrapping around if there are more workers than
+			/// cores.
+			one_per_core,
+
+			/// Workers may only run on the CPUs of NUMA node numa_node.
+			numa_node,
+		};
+
+		/// The number of worker threads. If zero, one per CPU allowed by the
+		/// affinity policy, or one per hardware thread if that is unknown.
+		std::uint32_t thread_count = 0;
+
+		affinity_policy affinity = affinity_policy::none;
+
+		/// The CPU numbers each worker may run on when affinity is cpu_sets.
+		std::vector<std::vector<std::uint32_t>> cpu_sets;
+
+		/// The NUMA node to run on when affinity is numa_node.
+		std::uint32_t numa_node = 0;
+
+		/// How an idle worker waits between checks for new work.
+		enum class spin_strategy
+		{
+			/// Busy-wait with the CPU's pause instruction for exponentially
+			/// longer each time, then yield the thread.
+			backoff,
+
+			/// Execute the CPU's pause instruction once. Lowest latency, but
+			/// keeps the CPU busy.
+			pause,
+
+			/// Yield the thread to the OS scheduler.
+			yield,
+		};
+
+		/// The most times an idle worker checks for new work before going to
+		/// sleep. Zero makes idle workers sleep straight away.
+		std::uint32_t spin_count = 30;
+
+		spin_strategy spin = spin_strategy::backoff;
+
+		/// Adapt each worker's spin count, up to spin_count, to how soon work
+		/// arrives after it goes to sleep. Workers that are woken soon after
+		/// sleeping spin for longer next time, and those that sleep for
+		/// longer than they spun spin for less.
+		bool adaptive_spin = false;
+
+		/// How many operations a worker takes from higher priority lanes
+		/// while a lower priority lane has work waiting before it takes one
+		/// from the lower priority lane. Zero gives strict priority, where
+		/// lower priority work only runs when there is no other work.
+		std::uint32_t priority_quota = 16;
+
+		/// Give each worker a recycling_frame_allocator as its default frame
+		/// allocator, so that coroutines created on the workers reuse the
+		/// frames of those that have finished instead of allocating from the
+		/// heap. Frames freed on other threads are returned to the worker
+		/// that allocated them. Coroutines created on the workers must then
+		/// be destroyed before the pool.
+		bool recycle_frames = false;
+	};
+
+	/// Counters describing how a static_thread_pool's workers have spent
+	/// their idle time and allocated coroutine frames.
+	struct static_thread_pool_stats
+	{
+		/// The number of times idle workers checked for new work while
+		/// spinning.
+		std::uint64_t spins = 0;
+
+		/// The number of times an idle worker found new work while spinning.
+		std::uint64_t spin_successes = 0;
+
+		/// The number of times an idle worker went to sleep.
+		std::uint64_t parks = 0;
+
+		/// The number of coroutine frames allocated on workers that reused a
+		/// recycled frame, when the pool recycles frames.
+		std::uint64_t frame_cache_hits = 0;
+
+		/// The number of coroutine frames allocated on workers that had to
+		/// be allocated from the heap, when the pool recycles frames.
+		std::uint64_t frame_cache_misses = 0;
+	};
+
 	class static_thread_pool
 	{
 	public:
@@ -31,13 +133,36 @@ namespace cppcoro
 		/// The number of threads in the pool that will be used to execute work.
 		explicit static_thread_pool(std::uint32_t threadCount);
 
+		/// Construct a thread pool whose threads are placed according to
+		/// \p options.
+		///
+		/// Each worker thread restricts itself to its CPUs before allocating
+		/// its work queue, so that on NUMA systems the queue is allocated on
+		/// the worker's node. Affinity policies that the platform can't
+		/// support leave the workers unpinned.
+		explicit static_thread_pool(const static_thread_pool_options& options);
+
 		~static_thread_pool();
 
+		/// The lanes that work can be scheduled in. Workers run work from
+		/// higher priority lanes first, but run some lower priority work
+		/// regularly so that it isn't starved (see
+		/// static_thread_pool_options::priority_quota).
+		enum class priority : std::uint8_t
+		{
+			high,
+			normal,
+			low,
+		};
+
 		class schedule_operation
 		{
 		public:
 
-			schedule_operation(static_thread_pool* tp) noexcept : m_threadPool(tp) {}
+			schedule_operation(static_thread_pool* tp, priority p = priority::normal) noexcept
+				: m_threadPool(tp)
+				, m_priority(p)
+			{}
 
 			bool await_ready() noexcept { return false; }
 			void await_suspend(cppcoro::coroutine_handle<> awaitingCoroutine) noexcept;
@@ -48,6 +173,7 @@ namespace cppcoro
 			friend class static_thread_pool;
 
 			static_thread_pool* m_threadPool;
+			priority m_priority;
 			cppcoro::coroutine_handle<> m_awaitingCoroutine;
 			schedule_operation* m_next;
 
@@ -55,11 +181,38 @@ namespace cppcoro
 
 		std::uint32_t thread_count() const noexcept { return m_threadCount; }
 
+		/// A snapshot of the pool's counters, summed over all worker
+		/// threads.
+		static_thread_pool_stats stats() const noexcept;
+
+		/// Return an operation that resumes the awaiting coroutine on one of
+		/// the pool's threads.
+		///
+		/// \param p
+		/// The priority lane to queue the coroutine in.
 		[[nodiscard]]
-		schedule_operation schedule() noexcept { return schedule_operation{ this }; }
+		schedule_operation schedule(priority p = priority::normal) noexcept
+		{
+			return schedule_operation{ this, p };
+		}
 
 	private:
 
+		static constexpr std::size_t priority_count = 3;
+
+		// The global FIFO queue of operations for one priority lane, which
+		// remote threads enqueue to.
+		struct global_queue
+		{
+			global_queue() noexcept : m_head(nullptr), m_tail(nullptr) {}
+
+			std::mutex m_mutex;
+			std::atomic<schedule_operation*> m_head;
+
+			//alignas(std::hardware_destructive_interference_size)
+			std::atomic<schedule_operation*> m_tail;
+		};
+
 		friend class schedule_operation;
 
 		void run_worker_thread(std::uint32_t threadIndex) noexcept;
@@ -76,38 +229,73 @@ namespace cppcoro
 
 		bool is_shutdown_requested() const noexcept;
 
+		// Wait a little before checking for work again.
+		void spin(spin_wait& spinWait) const noexcept;
+
 		void notify_intent_to_sleep(std::uint32_t threadIndex) noexcept;
 		void try_clear_intent_to_sleep(std::uint32_t threadIndex) noexcept;
 
-		schedule_operation* try_global_dequeue() noexcept;
+		class thread_state;
+
+		/// Find the next operation for a worker thread to run, from its own
+		/// queues, the global queues or by stealing, in priority order.
+		///
+		/// \return
+		/// The operation to run, or nullptr if no work could be found.
+		schedule_operation* try_dequeue(std::uint32_t threadIndex) noexcept;
+
+		/// Whether there is work in a lane with higher priority than \p lane
+		/// in the thread's own queues or the global queues.
+		bool approx_has_higher_priority_work(
+			const thread_state& state, std::size_t lane) const noexcept;
 
-		/// Try to steal a task from another thread.
+		/// Record that a worker is about to run an operation from \p lane.
+		schedule_operation* note_dequeued(thread_state& state, schedule_operation* operation) noexcept;
+
+		schedule_operation* try_global_dequeue(std::size_t lane) noexcept;
+
+		/// Try to steal tasks in \p lane from another thread.
 		///
 		/// \return
 		/// A pointer to the operation that was stolen if one could be stolen
 		/// from another thread. Otherwise returns nullptr if none of the other
 		/// threads had any tasks that could be stolen.
-		schedule_operation* try_steal_from_other_thread(std::uint32_t thisThreadIndex) noexcept;
+		schedule_operation* try_steal_from_other_thread(
+			std::uint32_t thisThreadIndex, std::size_t lane) noexcept;
 
-		void wake_one_thread() noexcept;
+		/// Try to take the operation another thread was going to run next.
+		schedule_operation* try_steal_next_to_run_from_other_thread(
+			std::uint32_t thisThreadIndex) noexcept;
 
-		class thread_state;
+		/// Call \p func with the state of each other thread, nearest
+		/// first, until it returns an operation.
+		template<typename FUNC>
+		schedule_operation* for_each_other_thread_nearest_first(
+			std::uint32_t thisThreadIndex, FUNC func) noexcept;
+
+		void wake_one_thread() noexcept;
 
 		static thread_local thread_state* s_currentState;
 		static thread_local static_thread_pool* s_currentThreadPool;
 
+		// The CPUs each worker may run on, cycled over the workers.
+		// Empty if the workers aren't pinned.
+		const std::vector<std::vector<std::uint32_t>> m_cpuSets;
+
 		const std::uint32_t m_threadCount;
 		const std::unique_ptr<thread_state[]> m_threadStates;
 
+		const std::uint32_t m_spinCount;
+		const static_thread_pool_options::spin_strategy m_spinStrategy;
+		const bool m_adaptiveSpin;
+		const std::uint32_t m_priorityQuota;
+		const bool m_recycleFrames;
+
 		std::vector<std::thread> m_threads;
 
 		std::atomic<bool> m_stopRequested;
 
-		std::mutex m_globalQueueMutex;
-		std::atomic<schedule_operation*> m_globalQueueHead;
-
-		//alignas(std::hardware_destructive_interference_size)
-		std::atomic<schedule_operation*> m_globalQueueTail;
+		global_queue m_globalQueues[priority_count];
 
 		//alignas(std::hardware_destructive_interference_size)
 		std::atomic<std::uint32_t> m_sleepingThreadCount;
@@ -8,6 +8,7 @@
 #include <cppcoro/detail/lightweight_manual_reset_event.hpp>
 #include <cppcoro/detail/sync_wait_task.hpp>
 #include <cppcoro/awaitable_traits.hpp>
+#include <cppcoro/detail/get_awaiter.hpp>
 
 #include <cstdint>
 #include <atomic>
@@ -24,13 +25,33 @@ namespace cppcoro
 		// reference to a coroutine which causes the compiler to think it needs to
 		// 'move' parameters passed by rvalue reference.
 		auto task = detail::make_sync_wait_task<AWAITABLE>(awaitable);
+		detail::lightweight_manual_reset_event event;
+		task.start(event);
+		event.wait();
+		return task.result();
 #else
-		auto task = detail::make_sync_wait_task(std::forward<AWAITABLE>(awaitable));
-#endif
+		auto&& awaiter = detail::get_awaiter(static_cast<AWAITABLE&&>(awaitable));
+		if (awaiter.await_ready())
+		{
+			// Already complete, so there is nothing to wait for.
+			return awaiter.await_resume();
+		}
+
+		// Otherwise suspend a coroutine on the awaiter, with its frame in a
+		// buffer on this stack, and wait for it to be resumed.
+		using awaiter_t = std::remove_reference_t<decltype(awaiter)>;
+		detail::sync_wait_suspending_awaiter<awaiter_t> suspendingAwaiter{ awaiter };
+		detail::sync_wait_frame_buffer buffer;
+		auto task = [&]
+		{
+			detail::next_frame_allocator_scope scope{ buffer };
+			return detail::make_sync_wait_task(suspendingAwaiter);
+		}();
 		detail::lightweight_manual_reset_event event;
 		task.start(event);
 		event.wait();
 		return task.result();
+#endif
 	}
 }
 
@@ -8,6 +8,7 @@
 #include <cppcoro/config.hpp>
 #include <cppcoro/awaitable_traits.hpp>
 #include <cppcoro/broken_promise.hpp>
+#include <cppcoro/frame_allocator.hpp>
 
 #include <cppcoro/detail/remove_rvalue_reference.hpp>
 
@@ -15,6 +16,7 @@
 #include <exception>
 #include <utility>
 #include <type_traits>
+#include <cstddef>
 #include <cstdint>
 #include <cassert>
 #include <new>
@@ -27,7 +29,7 @@ namespace cppcoro
 
 	namespace detail
 	{
-		class task_promise_base
+		class task_promise_base : public frame_allocating_promise<frame_kind::task>
 		{
 			friend struct final_awaitable;
 
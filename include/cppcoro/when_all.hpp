@@ -19,6 +19,10 @@
 #include <type_traits>
 #include <cassert>
 
+#if __has_include(<span>)
+# include <span>
+#endif
+
 namespace cppcoro
 {
 	//////////
@@ -86,6 +90,59 @@ namespace cppcoro
 			return results;
 		}, when_all_ready(std::move(awaitables)));
 	}
+
+#if __cpp_lib_span
+	//////////
+	// when_all() with span of awaitable
+
+	/// Await all of \p awaitables, each as an rvalue, without taking
+	/// ownership of them.
+	///
+	/// Rather than a coroutine frame allocated for each awaitable, the state
+	/// of the operation is kept in one block of \p buffer. The result is
+	/// void if the awaitables' results are void, or otherwise a vector of
+	/// their results. Rethrows the exception of the first awaitable that
+	/// failed, if any.
+	template<
+		typename AWAITABLE,
+		typename RESULT = typename awaitable_traits<AWAITABLE&&>::await_result_t>
+	[[nodiscard]] auto when_all(std::span<AWAITABLE> awaitables, when_all_buffer& buffer)
+	{
+		return detail::when_all_range_awaitable<RESULT>(
+			awaitables.data(), awaitables.size(), &buffer);
+	}
+
+	/// Await all of \p awaitables, as above, assigning the result of each to
+	/// the element of \p results at the same index rather than returning a
+	/// vector of them, so that nothing is allocated once \p buffer is warm.
+	///
+	/// \p results must have at least as many elements as \p awaitables. If
+	/// an awaitable failed, the results before it have been assigned when
+	/// its exception is rethrown.
+	template<
+		typename AWAITABLE,
+		typename OUTPUT,
+		typename RESULT = typename awaitable_traits<AWAITABLE&&>::await_result_t,
+		std::enable_if_t<std::is_assignable_v<OUTPUT&, RESULT&&>, int> = 0>
+	[[nodiscard]] auto when_all(
+		std::span<AWAITABLE> awaitables, std::span<OUTPUT> results, when_all_buffer& buffer)
+	{
+		assert(results.size() >= awaitables.size());
+		return detail::when_all_range_into_awaitable<RESULT, OUTPUT>(
+			awaitables.data(), awaitables.size(), results.data(), &buffer);
+	}
+
+	/// Await all of \p awaitables, as above, with the state of the operation
+	/// kept in a single allocation.
+	template<
+		typename AWAITABLE,
+		typename RESULT = typename awaitable_traits<AWAITABLE&&>::await_result_t>
+	[[nodiscard]] auto when_all(std::span<AWAITABLE> awaitables)
+	{
+		return detail::when_all_range_awaitable<RESULT>(
+			awaitables.data(), awaitables.size(), nullptr);
+	}
+#endif
 }
 
 #endif
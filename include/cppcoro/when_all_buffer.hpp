@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPCORO_WHEN_ALL_BUFFER_HPP_INCLUDED
+#define CPPCORO_WHEN_ALL_BUFFER_HPP_INCLUDED
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+
+namespace cppcoro
+{
+	namespace detail
+	{
+		class when_all_frame_arena;
+	}
+
+	/// Storage for the state of a when_all() or when_all_ready() over a
+	/// std::span of awaitables.
+	///
+	/// The buffer grows to fit the largest operation it has been used for
+	/// and keeps its memory, so reusing one buffer for a series of
+	/// operations of similar size avoids allocating for each of them.
+	///
+	/// A buffer may only be used by one operation at a time, and must
+	/// outlive the operations that use it.
+	class when_all_buffer
+	{
+	public:
+
+		when_all_buffer() noexcept
+			: m_storage(nullptr)
+			, m_capacity(0)
+			, m_inUse(false)
+		{}
+
+		~when_all_buffer()
+		{
+			assert(!m_inUse);
+			if (m_storage != nullptr)
+			{
+				::operator delete(m_storage, m_capacity);
+			}
+		}
+
+		when_all_buffer(const when_all_buffer&) = delete;
+		when_all_buffer& operator=(const when_all_buffer&) = delete;
+
+		/// The number of bytes the buffer can hold without allocating.
+		std::size_t capacity() const noexcept
+		{
+			return m_capacity;
+		}
+
+	private:
+
+		friend class detail::when_all_frame_arena;
+
+		void* reserve(std::size_t size)
+		{
+			if (size > m_capacity)
+			{
+				void* storage = ::operator new(size);
+				if (m_storage != nullptr)
+				{
+					::operator delete(m_storage, m_capacity);
+				}
+				m_storage = storage;
+				m_capacity = size;
+			}
+
+			return m_storage;
+		}
+
+		void* m_storage;
+		std::size_t m_capacity;
+		bool m_inUse;
+
+	};
+}
+
+#endif
@@ -9,7 +9,9 @@
 #include <cppcoro/awaitable_traits.hpp>
 #include <cppcoro/is_awaitable.hpp>
 
+#include <cppcoro/when_all_buffer.hpp>
 #include <cppcoro/detail/when_all_ready_awaitable.hpp>
+#include <cppcoro/detail/when_all_range_awaitable.hpp>
 #include <cppcoro/detail/when_all_task.hpp>
 #include <cppcoro/detail/unwrap_reference.hpp>
 
@@ -18,6 +20,10 @@
 #include <vector>
 #include <type_traits>
 
+#if __has_include(<span>)
+# include <span>
+#endif
+
 namespace cppcoro
 {
 	template<
@@ -51,6 +57,35 @@ namespace cppcoro
 		return detail::when_all_ready_awaitable<std::vector<detail::when_all_task<RESULT>>>(
 			std::move(tasks));
 	}
+
+#if __cpp_lib_span
+	/// Await all of \p awaitables, each as an rvalue, without taking
+	/// ownership of them.
+	///
+	/// Rather than a coroutine frame allocated for each awaitable, the state
+	/// of the operation is kept in one block of \p buffer. The returned
+	/// awaitable must be co_await'ed as an lvalue; the result is a span of
+	/// tasks whose results can be read until the awaitable is destroyed.
+	template<
+		typename AWAITABLE,
+		typename RESULT = typename awaitable_traits<AWAITABLE&&>::await_result_t>
+	[[nodiscard]] auto when_all_ready(std::span<AWAITABLE> awaitables, when_all_buffer& buffer)
+	{
+		return detail::when_all_ready_range_awaitable<RESULT>(
+			awaitables.data(), awaitables.size(), &buffer);
+	}
+
+	/// Await all of \p awaitables, as above, with the state of the operation
+	/// kept in a single allocation.
+	template<
+		typename AWAITABLE,
+		typename RESULT = typename awaitable_traits<AWAITABLE&&>::await_result_t>
+	[[nodiscard]] auto when_all_ready(std::span<AWAITABLE> awaitables)
+	{
+		return detail::when_all_ready_range_awaitable<RESULT>(
+			awaitables.data(), awaitables.size(), nullptr);
+	}
+#endif
 }
 
 #endif
@@ -9,6 +9,26 @@
 # define WIN32_LEAN_AND_MEAN
 # include <windows.h>
 # include <system_error>
+#elif CPPCORO_OS_LINUX
+# include <unistd.h>
+# include <sys/syscall.h>
+# include <linux/futex.h>
+# include <cassert>
+
+namespace
+{
+	namespace local
+	{
+		constexpr int set_flag = 1;
+		constexpr int waiter_increment = 2;
+
+		// No futex() function provided by libc.
+		int futex(int* address, int operation, int value) noexcept
+		{
+			return static_cast<int>(::syscall(SYS_futex, address, operation, value, nullptr, nullptr, 0));
+		}
+	}
+}
 #endif
 
 namespace cppcoro
@@ -64,6 +84,71 @@ namespace cppcoro
 		}
 	}
 
+#elif CPPCORO_OS_LINUX
+
+	auto_reset_event::auto_reset_event(bool initiallySet)
+		: m_value(initiallySet ? local::set_flag : 0)
+	{}
+
+	auto_reset_event::~auto_reset_event()
+	{}
+
+	void auto_reset_event::set()
+	{
+		const int oldValue = m_value.fetch_or(local::set_flag, std::memory_order_release);
+		if ((oldValue & local::set_flag) == 0 && oldValue >= local::waiter_increment)
+		{
+			[[maybe_unused]] int result = local::futex(
+				reinterpret_cast<int*>(&m_value), FUTEX_WAKE_PRIVATE, 1);
+
+			// There are no errors expected here unless this class (or the
+			// caller) has done something wrong.
+			assert(result != -1);
+		}
+	}
+
+	void auto_reset_event::wait()
+	{
+		int value = m_value.load(std::memory_order_relaxed);
+		while (true)
+		{
+			if ((value & local::set_flag) != 0)
+			{
+				if (m_value.compare_exchange_weak(
+					value,
+					value & ~local::set_flag,
+					std::memory_order_acquire,
+					std::memory_order_relaxed))
+				{
+					return;
+				}
+				continue;
+			}
+
+			// Register as a waiter before sleeping so that set() knows to
+			// wake us up.
+			if (!m_value.compare_exchange_weak(
+				value,
+				value + local::waiter_increment,
+				std::memory_order_relaxed,
+				std::memory_order_relaxed))
+			{
+				continue;
+			}
+
+			// Returns immediately if the value has changed since we
+			// registered, eg. if the event has been set. Spurious wake-ups
+			// and other errors just send us around the loop again.
+			(void)local::futex(
+				reinterpret_cast<int*>(&m_value),
+				FUTEX_WAIT_PRIVATE,
+				value + local::waiter_increment);
+
+			value = m_value.fetch_sub(local::waiter_increment, std::memory_order_relaxed) -
+				local::waiter_increment;
+		}
+	}
+
 #else
 
 	auto_reset_event::auto_reset_event(bool initiallySet)
@@ -9,6 +9,8 @@
 
 #if CPPCORO_OS_WINNT
 # include <cppcoro/detail/win32.hpp>
+#elif CPPCORO_OS_LINUX
+# include <atomic>
 #else
 # include <mutex>
 # include <condition_variable>
@@ -32,6 +34,11 @@ namespace cppcoro
 
 #if CPPCORO_OS_WINNT
 		cppcoro::detail::win32::safe_handle m_event;
+#elif CPPCORO_OS_LINUX
+		// Bit 0 is set while the event is set. The remaining bits count the
+		// threads waiting, so that set() only makes a futex() call when
+		// there is someone to wake up.
+		std::atomic<int> m_value;
 #else
 		std::mutex m_mutex;
 		std::condition_variable m_cv;
@@ -0,0 +1,289 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "cpu_topology.hpp"
+
+#include <cppcoro/config.hpp>
+
+#if CPPCORO_OS_LINUX
+# include <algorithm>
+# include <exception>
+# include <fstream>
+# include <map>
+# include <memory>
+# include <sstream>
+# include <string>
+# include <sched.h>
+#elif CPPCORO_OS_WINNT
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+#endif
+
+#if CPPCORO_OS_LINUX
+namespace
+{
+	namespace local
+	{
+		bool read_line(const std::string& path, std::string& line)
+		{
+			std::ifstream file{ path };
+			return static_cast<bool>(std::getline(file, line));
+		}
+
+		// Parse a kernel CPU list such as "0-3,8,10-11".
+		std::vector<std::uint32_t> parse_cpu_list(const std::string& list)
+		{
+			std::vector<std::uint32_t> cpus;
+			std::istringstream stream{ list };
+			std::string range;
+			while (std::getline(stream, range, ','))
+			{
+				unsigned long first = 0;
+				unsigned long last = 0;
+				const auto dash = range.find('-');
+				try
+				{
+					first = std::stoul(range.substr(0, dash));
+					last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+				}
+				catch (const std::exception&)
+				{
+					continue;
+				}
+
+				for (auto cpu = first; cpu <= last; ++cpu)
+				{
+					cpus.push_back(static_cast<std::uint32_t>(cpu));
+				}
+			}
+			return cpus;
+		}
+
+		// An identifier for the last-level cache the CPU uses: the set of
+		// CPUs sharing its L3, or failing that its physical package.
+		std::string cache_key(std::uint32_t cpu)
+		{
+			const std::string cpuPath = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+			std::string line;
+			for (int index = 0; read_line(cpuPath + "/cache/index" + std::to_string(index) + "/level", line); ++index)
+			{
+				if (line == "3" &&
+					read_line(cpuPath + "/cache/index" + std::to_string(index) + "/shared_cpu_list", line))
+				{
+					return "l3:" + line;
+				}
+			}
+
+			if (read_line(cpuPath + "/topology/physical_package_id", line))
+			{
+				return "package:" + line;
+			}
+
+			return {};
+		}
+	}
+}
+#endif
+
+namespace cppcoro
+{
+	const cpu_topology& cpu_topology::get()
+	{
+		static const cpu_topology topology;
+		return topology;
+	}
+
+	std::uint32_t cpu_topology::current_cpu() noexcept
+	{
+#if CPPCORO_OS_LINUX
+		const int cpu = ::sched_getcpu();
+		return cpu < 0 ? unknown_cpu : static_cast<std::uint32_t>(cpu);
+#elif CPPCORO_OS_WINNT
+		return static_cast<std::uint32_t>(::GetCurrentProcessorNumber());
+#else
+		return unknown_cpu;
+#endif
+	}
+
+	std::uint32_t cpu_topology::distance(std::uint32_t a, std::uint32_t b) const noexcept
+	{
+		if (a >= m_cpus.size() || b >= m_cpus.size())
+		{
+			return 0;
+		}
+
+		if (m_cpus[a].m_cache == m_cpus[b].m_cache)
+		{
+			return 0;
+		}
+
+		return m_cpus[a].m_node == m_cpus[b].m_node ? 1 : 2;
+	}
+
+	std::vector<std::uint32_t> cpu_topology::one_cpu_per_core() const
+	{
+		std::vector<std::uint32_t> cpus;
+		std::vector<bool> coreSeen(m_cpus.size(), false);
+		for (auto cpu : m_availableCpus)
+		{
+			const auto core = m_cpus[cpu].m_core;
+			if (!coreSeen[core])
+			{
+				coreSeen[core] = true;
+				cpus.push_back(cpu);
+			}
+		}
+		return cpus;
+	}
+
+	std::vector<std::uint32_t> cpu_topology::node_cpus(std::uint32_t node) const
+	{
+		std::vector<std::uint32_t> cpus;
+		for (auto cpu : m_availableCpus)
+		{
+			if (m_cpus[cpu].m_node == node)
+			{
+				cpus.push_back(cpu);
+			}
+		}
+		return cpus;
+	}
+
+	bool cpu_topology::set_current_thread_affinity(const std::vector<std::uint32_t>& cpus) noexcept
+	{
+		if (cpus.empty())
+		{
+			return false;
+		}
+
+#if CPPCORO_OS_LINUX
+		std::uint32_t cpuCount = 0;
+		for (auto cpu : cpus)
+		{
+			cpuCount = std::max(cpuCount, cpu + 1);
+		}
+
+		cpu_set_t* cpuSet = CPU_ALLOC(cpuCount);
+		if (cpuSet == nullptr)
+		{
+			return false;
+		}
+
+		const std::size_t cpuSetSize = CPU_ALLOC_SIZE(cpuCount);
+		CPU_ZERO_S(cpuSetSize, cpuSet);
+		for (auto cpu : cpus)
+		{
+			CPU_SET_S(cpu, cpuSetSize, cpuSet);
+		}
+
+		const bool ok = ::sched_setaffinity(0, cpuSetSize, cpuSet) == 0;
+		CPU_FREE(cpuSet);
+		return ok;
+#elif CPPCORO_OS_WINNT
+		// Only the calling thread's processor group can be addressed here.
+		DWORD_PTR mask = 0;
+		for (auto cpu : cpus)
+		{
+			if (cpu < sizeof(mask) * 8)
+			{
+				mask |= DWORD_PTR(1) << cpu;
+			}
+		}
+		return mask != 0 && ::SetThreadAffinityMask(::GetCurrentThread(), mask) != 0;
+#else
+		return false;
+#endif
+	}
+
+	cpu_topology::cpu_topology()
+	{
+#if CPPCORO_OS_LINUX
+		try
+		{
+			std::string line;
+			if (!local::read_line("/sys/devices/system/cpu/possible", line))
+			{
+				return;
+			}
+
+			const auto cpus = local::parse_cpu_list(line);
+			std::uint32_t cpuCount = 0;
+			for (auto cpu : cpus)
+			{
+				cpuCount = std::max(cpuCount, cpu + 1);
+			}
+			m_cpus.assign(cpuCount, cpu_info{ 0, 0, 0 });
+
+			std::map<std::string, std::uint32_t> caches;
+			for (auto cpu : cpus)
+			{
+				const auto key = local::cache_key(cpu);
+				m_cpus[cpu].m_cache = caches.emplace(key, static_cast<std::uint32_t>(caches.size())).first->second;
+
+				m_cpus[cpu].m_core = cpu;
+				if (local::read_line(
+					"/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list", line))
+				{
+					const auto siblings = local::parse_cpu_list(line);
+					if (!siblings.empty() && siblings.front() < cpuCount)
+					{
+						m_cpus[cpu].m_core = siblings.front();
+					}
+				}
+			}
+
+			// Only offer CPUs that are online and in our affinity mask.
+			std::vector<std::uint32_t> onlineCpus = cpus;
+			if (local::read_line("/sys/devices/system/cpu/online", line))
+			{
+				onlineCpus = local::parse_cpu_list(line);
+			}
+
+			auto freeCpuSet = [](cpu_set_t* cpuSet) { CPU_FREE(cpuSet); };
+			std::unique_ptr<cpu_set_t, decltype(freeCpuSet)> allowedCpus{ CPU_ALLOC(cpuCount), freeCpuSet };
+			const std::size_t allowedCpusSize = CPU_ALLOC_SIZE(cpuCount);
+			const bool haveAffinity = allowedCpus &&
+				::sched_getaffinity(0, allowedCpusSize, allowedCpus.get()) == 0;
+			for (auto cpu : onlineCpus)
+			{
+				if (cpu < cpuCount &&
+					(!haveAffinity || CPU_ISSET_S(cpu, allowedCpusSize, allowedCpus.get())))
+				{
+					m_availableCpus.push_back(cpu);
+				}
+			}
+
+			if (local::read_line("/sys/devices/system/node/online", line))
+			{
+				for (auto node : local::parse_cpu_list(line))
+				{
+					std::string nodeCpus;
+					if (!local::read_line(
+						"/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", nodeCpus))
+					{
+						continue;
+					}
+
+					for (auto cpu : local::parse_cpu_list(nodeCpus))
+					{
+						if (cpu < cpuCount)
+						{
+							m_cpus[cpu].m_node = node;
+						}
+					}
+				}
+			}
+		}
+		catch (...)
+		{
+			// Without a topology every CPU is as good as any other.
+			m_cpus.clear();
+			m_availableCpus.clear();
+		}
+#endif
+	}
+}
@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPCORO_CPU_TOPOLOGY_HPP_INCLUDED
+#define CPPCORO_CPU_TOPOLOGY_HPP_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+namespace cppcoro
+{
+	/// Which CPUs share a last-level cache or a NUMA node.
+	///
+	/// Read from /sys/devices/system on Linux. Elsewhere every CPU is
+	/// treated as sharing a single cache and node.
+	class cpu_topology
+	{
+	public:
+
+		static constexpr std::uint32_t unknown_cpu = ~std::uint32_t(0);
+
+		/// The largest value returned by distance().
+		static constexpr std::uint32_t max_distance = 2;
+
+		/// The topology of this machine, read on first use.
+		static const cpu_topology& get();
+
+		/// The CPU the calling thread is running on, or unknown_cpu.
+		static std::uint32_t current_cpu() noexcept;
+
+		/// How far apart two CPUs are.
+		///
+		/// \return
+		/// 0 if the CPUs share a last-level cache (or either is unknown),
+		/// 1 if they are on the same NUMA node, otherwise 2.
+		std::uint32_t distance(std::uint32_t a, std::uint32_t b) const noexcept;
+
+		/// The online CPUs this process is allowed to run on, in increasing
+		/// order. Empty if the topology is unknown.
+		const std::vector<std::uint32_t>& available_cpus() const noexcept { return m_availableCpus; }
+
+		/// The first available CPU of each physical core.
+		std::vector<std::uint32_t> one_cpu_per_core() const;
+
+		/// The available CPUs on NUMA node \p node.
+		std::vector<std::uint32_t> node_cpus(std::uint32_t node) const;
+
+		/// Restrict the calling thread to running on \p cpus.
+		///
+		/// \return
+		/// true if the thread's affinity was changed, false if \p cpus is
+		/// empty or the platform doesn't support it.
+		static bool set_current_thread_affinity(const std::vector<std::uint32_t>& cpus) noexcept;
+
+	private:
+
+		cpu_topology();
+
+		struct cpu_info
+		{
+			std::uint32_t m_cache;
+			std::uint32_t m_node;
+			// The lowest numbered CPU sharing this CPU's physical core.
+			std::uint32_t m_core;
+		};
+
+		// Indexed by CPU number.
+		std::vector<cpu_info> m_cpus;
+
+		std::vector<std::uint32_t> m_availableCpus;
+
+	};
+}
+
+#endif
@@ -0,0 +1,258 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cppcoro/elastic_thread_pool.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace cppcoro
+{
+	thread_local elastic_thread_pool* elastic_thread_pool::s_currentThreadPool = nullptr;
+	thread_local std::uint32_t elastic_thread_pool::s_blockingSectionDepth = 0;
+
+	void elastic_thread_pool::schedule_operation::await_suspend(
+		cppcoro::coroutine_handle<> awaitingCoroutine) noexcept
+	{
+		m_awaitingCoroutine = awaitingCoroutine;
+		m_threadPool->schedule_impl(this);
+	}
+
+	elastic_thread_pool::blocking_section::blocking_section(elastic_thread_pool& tp) noexcept
+		: m_threadPool(s_currentThreadPool == &tp ? &tp : nullptr)
+	{
+		if (m_threadPool != nullptr)
+		{
+			m_threadPool->enter_blocking_section();
+		}
+	}
+
+	elastic_thread_pool::blocking_section::~blocking_section()
+	{
+		if (m_threadPool != nullptr)
+		{
+			m_threadPool->leave_blocking_section();
+		}
+	}
+
+	elastic_thread_pool::elastic_thread_pool()
+		: elastic_thread_pool(
+			std::max(std::thread::hardware_concurrency(), 1u),
+			std::max(std::thread::hardware_concurrency(), 1u) * 4)
+	{
+	}
+
+	elastic_thread_pool::elastic_thread_pool(
+		std::uint32_t threadCount,
+		std::uint32_t maxThreadCount,
+		std::chrono::milliseconds idleTimeout)
+		: m_minThreadCount(std::max(threadCount, 1u))
+		, m_maxThreadCount(std::max(maxThreadCount, m_minThreadCount))
+		, m_idleTimeout(idleTimeout)
+		, m_head(nullptr)
+		, m_tail(nullptr)
+		, m_blockedThreadCount(0)
+		, m_idleThreadCount(0)
+		, m_stopRequested(false)
+	{
+		try
+		{
+			std::lock_guard lock{ m_mutex };
+			for (std::uint32_t i = 0; i < m_minThreadCount; ++i)
+			{
+				start_thread_locked();
+			}
+		}
+		catch (...)
+		{
+			{
+				std::lock_guard lock{ m_mutex };
+				m_stopRequested = true;
+			}
+			m_workAvailable.notify_all();
+
+			for (auto& thread : m_threads)
+			{
+				thread.join();
+			}
+
+			throw;
+		}
+	}
+
+	elastic_thread_pool::~elastic_thread_pool()
+	{
+		{
+			std::lock_guard lock{ m_mutex };
+			m_stopRequested = true;
+		}
+		m_workAvailable.notify_all();
+
+		// Threads no longer start or retire once a stop is requested, so
+		// the lists can be read without the lock.
+		for (auto& thread : m_threads)
+		{
+			thread.join();
+		}
+
+		for (auto& thread : m_retiredThreads)
+		{
+			thread.join();
+		}
+	}
+
+	std::uint32_t elastic_thread_pool::thread_count() const noexcept
+	{
+		std::lock_guard lock{ m_mutex };
+		return static_cast<std::uint32_t>(m_threads.size());
+	}
+
+	void elastic_thread_pool::run_worker_thread(thread_list::iterator self) noexcept
+	{
+		s_currentThreadPool = this;
+
+		std::unique_lock lock{ m_mutex };
+		while (true)
+		{
+			// Queued work is left unrun once a stop has been requested.
+			if (m_stopRequested)
+			{
+				return;
+			}
+
+			if (m_head == nullptr)
+			{
+				++m_idleThreadCount;
+				const auto deadline = std::chrono::steady_clock::now() + m_idleTimeout;
+				const bool timedOut = !m_workAvailable.wait_until(
+					lock, deadline, [this] { return m_head != nullptr || m_stopRequested; });
+				--m_idleThreadCount;
+
+				// Exit if the pool has more running threads than it needs.
+				// Blocked threads don't count, as they will need replacing
+				// again if they are still blocked.
+				if (timedOut &&
+					m_threads.size() - m_blockedThreadCount > m_minThreadCount)
+				{
+					// Leave the thread to be joined by the next blocking
+					// section or by the destructor. Neither can join it until
+					// the lock is released, after which this thread no longer
+					// touches the pool.
+					m_retiredThreads.push_back(std::move(*self));
+					m_threads.erase(self);
+					return;
+				}
+
+				continue;
+			}
+
+			schedule_operation* op = m_head;
+			m_head = op->m_next;
+			if (m_head == nullptr)
+			{
+				m_tail = nullptr;
+			}
+
+			lock.unlock();
+			op->m_awaitingCoroutine.resume();
+			lock.lock();
+		}
+	}
+
+	void elastic_thread_pool::schedule_impl(schedule_operation* operation) noexcept
+	{
+		operation->m_next = nullptr;
+
+		bool wakeThread;
+		{
+			std::lock_guard lock{ m_mutex };
+			if (m_tail == nullptr)
+			{
+				m_head = operation;
+			}
+			else
+			{
+				m_tail->m_next = operation;
+			}
+			m_tail = operation;
+
+			wakeThread = m_idleThreadCount > 0;
+		}
+
+		if (wakeThread)
+		{
+			m_workAvailable.notify_one();
+		}
+	}
+
+	void elastic_thread_pool::start_thread_locked()
+	{
+		auto self = m_threads.emplace(m_threads.end());
+		try
+		{
+			// The new thread can't use its list entry until m_mutex is
+			// released, by which time the entry holds the thread.
+			*self = std::thread([this, self] { run_worker_thread(self); });
+		}
+		catch (...)
+		{
+			m_threads.erase(self);
+			throw;
+		}
+	}
+
+	void elastic_thread_pool::enter_blocking_section() noexcept
+	{
+		// A nested section doesn't block the thread any further.
+		if (s_blockingSectionDepth++ != 0)
+		{
+			return;
+		}
+
+		std::vector<std::thread> retiredThreads;
+		{
+			std::lock_guard lock{ m_mutex };
+			++m_blockedThreadCount;
+
+			const auto threadCount = static_cast<std::uint32_t>(m_threads.size());
+			if (!m_stopRequested &&
+				threadCount - m_blockedThreadCount < m_minThreadCount &&
+				threadCount < m_maxThreadCount)
+			{
+				try
+				{
+					start_thread_locked();
+				}
+				catch (...)
+				{
+					// Carry on without the extra thread; work still runs
+					// once the blocked threads return.
+				}
+			}
+
+			retiredThreads.swap(m_retiredThreads);
+		}
+
+		for (auto& thread : retiredThreads)
+		{
+			thread.join();
+		}
+	}
+
+	void elastic_thread_pool::leave_blocking_section() noexcept
+	{
+		if (--s_blockingSectionDepth != 0)
+		{
+			return;
+		}
+
+		// Any surplus threads this leaves retire once they have been idle
+		// for the idle timeout.
+		std::lock_guard lock{ m_mutex };
+		assert(m_blockedThreadCount > 0);
+		--m_blockedThreadCount;
+	}
+}
@@ -64,20 +64,54 @@ bool cppcoro::file_read_operation_impl::try_start(
 
 #elif CPPCORO_OS_LINUX || CPPCORO_OS_DARWIN
 #include <unistd.h>
+#if CPPCORO_USE_IO_URING
+#include <linux/io_uring.h>
+#endif
 
 bool cppcoro::file_read_operation_impl::try_start(
 	cppcoro::detail::async_operation_base& operation) noexcept
 {
 	operation.m_fd = m_fileHandle;
-	auto seek_res = lseek(m_fileHandle, m_offset, SEEK_SET);
-	if (seek_res < 0) {
-		operation.m_res = -errno;
-		return false;
-	}
+#if CPPCORO_USE_IO_URING
+	// Positional I/O, so no lseek() is needed.
+	return operation.try_submit({
+		IORING_OP_READ,
+		m_fileHandle,
+		m_buffer,
+		m_byteCount <= 0xFFFFFFFF ?
+			static_cast<std::uint32_t>(m_byteCount) : std::uint32_t(0xFFFFFFFF),
+		m_offset,
+		0 });
+#else
+	// Positional I/O so that concurrent operations on the same file don't
+	// race on the file offset.
 	operation.m_completeFunc = [&]() {
-		return read(m_fileHandle, m_buffer, m_byteCount);
+		return pread(m_fileHandle, m_buffer, m_byteCount, static_cast<off_t>(m_offset));
 	};
+#if CPPCORO_OS_LINUX
+	// epoll can't wait for regular files, which are always "ready" but may
+	// still block on the disk, so run the I/O on a blocking I/O thread.
+	if (operation.m_ioService->get_io_context().submit_blocking(&operation))
+	{
+		return true;
+	}
+
+	// Couldn't offload it, so do it here.
+	const int result = operation.m_completeFunc();
+	operation.m_res = result < 0 ? -errno : result;
+	return false;
+#else
 	operation.m_ioService->get_io_context().watch_handle(m_fileHandle, reinterpret_cast<void*>(&operation), detail::watch_type::readable);
 	return true;
+#endif
+#endif
+}
+
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+void cppcoro::file_read_operation_impl::cancel(
+	cppcoro::detail::async_operation_base& operation) noexcept
+{
+	operation.m_ioService->get_io_context().cancel_blocking(&operation);
 }
 #endif
+#endif
@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cppcoro/frame_stats.hpp>
+
+#include <atomic>
+
+namespace
+{
+	namespace local
+	{
+		struct kind_counters
+		{
+			std::atomic<std::uint64_t> m_allocations{ 0 };
+			std::atomic<std::uint64_t> m_deallocations{ 0 };
+			std::atomic<std::uint64_t> m_allocatedBytes{ 0 };
+			std::atomic<std::uint64_t> m_largestFrameSize{ 0 };
+			std::atomic<std::uint64_t> m_sizeHistogram[cppcoro::frame_kind_stats::bucket_count] = {};
+		};
+
+		kind_counters counters[cppcoro::frame_kind_count];
+
+		kind_counters& counters_for(cppcoro::frame_kind kind) noexcept
+		{
+			return counters[static_cast<std::size_t>(kind)];
+		}
+	}
+}
+
+namespace cppcoro
+{
+	frame_stats_snapshot snapshot_frame_stats() noexcept
+	{
+		frame_stats_snapshot snapshot;
+		for (std::size_t i = 0; i < frame_kind_count; ++i)
+		{
+			auto& counters = local::counters[i];
+			auto& stats = snapshot.kinds[i];
+
+			stats.deallocations = counters.m_deallocations.load(std::memory_order_relaxed);
+			stats.allocations = counters.m_allocations.load(std::memory_order_relaxed);
+			stats.allocated_bytes = counters.m_allocatedBytes.load(std::memory_order_relaxed);
+			stats.largest_frame_size = counters.m_largestFrameSize.load(std::memory_order_relaxed);
+			for (std::size_t bucket = 0; bucket < frame_kind_stats::bucket_count; ++bucket)
+			{
+				stats.size_histogram[bucket] =
+					counters.m_sizeHistogram[bucket].load(std::memory_order_relaxed);
+			}
+		}
+
+		return snapshot;
+	}
+
+	void detail::record_frame_allocation(frame_kind kind, std::size_t size) noexcept
+	{
+		auto& counters = local::counters_for(kind);
+		counters.m_allocations.fetch_add(1, std::memory_order_relaxed);
+		counters.m_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+		counters.m_sizeHistogram[frame_kind_stats::bucket_index(size)].fetch_add(
+			1, std::memory_order_relaxed);
+
+		std::uint64_t largest = counters.m_largestFrameSize.load(std::memory_order_relaxed);
+		while (size > largest &&
+			!counters.m_largestFrameSize.compare_exchange_weak(
+				largest, size, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void detail::record_frame_deallocation(frame_kind kind) noexcept
+	{
+		local::counters_for(kind).m_deallocations.fetch_add(1, std::memory_order_relaxed);
+	}
+}
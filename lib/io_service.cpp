@@ -23,10 +23,49 @@
 # include <windows.h>
 #elif CPPCORO_OS_LINUX
 # include <sys/timerfd.h>
+# if CPPCORO_USE_IO_URING
+#  include <linux/io_uring.h>
+# endif
 #elif CPPCORO_OS_DARWIN
 # include <sys/event.h>
 #endif
 
+#if CPPCORO_OS_LINUX
+# ifndef CPPCORO_MAX_INLINE_COMPLETIONS
+#  define CPPCORO_MAX_INLINE_COMPLETIONS 16
+# endif
+# ifndef CPPCORO_EPOLL_BATCH_SIZE
+#  define CPPCORO_EPOLL_BATCH_SIZE 128
+# endif
+
+namespace
+{
+	namespace local
+	{
+		// Default maximum number of I/O operations a thread may complete
+		// inline before one of them must go through the event loop.
+		// Override by defining CPPCORO_MAX_INLINE_COMPLETIONS when building the
+		// library, or per io_service with its maxInlineCompletions parameter.
+		constexpr std::uint32_t default_max_inline_completions = CPPCORO_MAX_INLINE_COMPLETIONS;
+
+		// Default maximum number of readiness events harvested per
+		// epoll_wait() call. Override by defining CPPCORO_EPOLL_BATCH_SIZE when
+		// building the library, or per io_service with its eventBatchSize
+		// parameter.
+		constexpr std::uint32_t default_event_batch_size = CPPCORO_EPOLL_BATCH_SIZE;
+		static_assert(default_event_batch_size > 0);
+
+		struct inline_completion_state
+		{
+			const cppcoro::io_service* m_service = nullptr;
+			std::uint32_t m_count = 0;
+		};
+
+		thread_local inline_completion_state inlineCompletions;
+	}
+}
+#endif
+
 #if CPPCORO_OS_WINNT
 /// \brief
 /// A queue of pending timers that supports efficiently determining
@@ -276,10 +315,43 @@ cppcoro::io_service::io_service()
 }
 
 cppcoro::io_service::io_service(std::uint32_t concurrencyHint)
+#if CPPCORO_OS_LINUX
+	: io_service(concurrencyHint, local::default_max_inline_completions)
+#else
+	: io_service(concurrencyHint, 0)
+#endif
+{
+}
+
+cppcoro::io_service::io_service(
+	std::uint32_t concurrencyHint,
+	std::uint32_t maxInlineCompletions)
+#if CPPCORO_OS_LINUX
+	: io_service(concurrencyHint, maxInlineCompletions, local::default_event_batch_size)
+#else
+	: io_service(concurrencyHint, maxInlineCompletions, 0)
+#endif
+{
+}
+
+cppcoro::io_service::io_service(
+	std::uint32_t concurrencyHint,
+	[[maybe_unused]] std::uint32_t maxInlineCompletions,
+	[[maybe_unused]] std::uint32_t eventBatchSize)
 	: m_threadState(0)
 	, m_workCount(0)
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+	, m_mq(concurrencyHint, std::max<std::uint32_t>(eventBatchSize, 1))
+#else
 	, m_mq(concurrencyHint)
+#endif
 	, m_scheduleOperations(nullptr)
+#if CPPCORO_OS_LINUX
+	, m_runQueueIncoming(nullptr)
+	, m_runQueueHead(nullptr)
+	, m_parkedThreadCount(0)
+	, m_maxInlineCompletions(maxInlineCompletions)
+#endif
 #if CPPCORO_OS_WINNT
 	, m_timerState(nullptr)
 #endif
@@ -296,6 +368,15 @@ cppcoro::io_service::~io_service()
 #endif
 }
 
+cppcoro::io_service::event_batch_stats cppcoro::io_service::batch_stats() const noexcept
+{
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+	return m_mq.batch_stats();
+#else
+	return {};
+#endif
+}
+
 cppcoro::io_service::schedule_operation cppcoro::io_service::schedule() noexcept
 {
 	return schedule_operation{ *this };
@@ -414,8 +495,51 @@ cppcoro::detail::message_queue& cppcoro::io_service::get_io_context() noexcept
 	return m_mq;
 }
 
+#if CPPCORO_OS_LINUX
+bool cppcoro::io_service::try_complete_inline() noexcept
+{
+	auto& state = local::inlineCompletions;
+	if (state.m_service != this)
+	{
+		state.m_service = this;
+		state.m_count = 0;
+	}
+
+	if (state.m_count >= m_maxInlineCompletions)
+	{
+		// The operation that is refused will suspend its coroutine, so the
+		// next one starts a new run.
+		state.m_count = 0;
+		return false;
+	}
+
+	++state.m_count;
+	return true;
+}
+#endif
+
 void cppcoro::io_service::schedule_impl(schedule_operation* operation) noexcept
 {
+#if CPPCORO_OS_LINUX
+	// Queue the operation in-process rather than round-tripping it through
+	// the kernel. Only threads that are blocked waiting for events need to
+	// be woken.
+	//
+	// The seq_cst push pairs with the seq_cst increment of
+	// m_parkedThreadCount in try_process_one_event() so that either we see
+	// the parked thread or it sees this operation before blocking.
+	auto* head = m_runQueueIncoming.load(std::memory_order_relaxed);
+	do
+	{
+		operation->m_next = head;
+	} while (!m_runQueueIncoming.compare_exchange_weak(
+		head,
+		operation,
+		std::memory_order_seq_cst,
+		std::memory_order_relaxed));
+
+	wake_parked_thread();
+#else
 	const bool ok = m_mq.enqueue_message(
 		{
 			detail::message_type::RESUME_TYPE,
@@ -440,8 +564,71 @@ void cppcoro::io_service::schedule_impl(schedule_operation* operation) noexcept
 			std::memory_order_release,
 			std::memory_order_acquire));
 	}
+#endif
+}
+
+#if CPPCORO_OS_LINUX
+cppcoro::io_service::schedule_operation*
+cppcoro::io_service::try_pop_run_queue() noexcept
+{
+	schedule_operation* operation;
+	bool hasMore;
+	{
+		std::lock_guard<std::mutex> lock{ m_runQueueMutex };
+		if (m_runQueueHead == nullptr)
+		{
+			// Take everything pushed since we last looked and reverse it
+			// so that operations are resumed in the order they were scheduled.
+			auto* incoming = m_runQueueIncoming.exchange(nullptr, std::memory_order_acquire);
+			while (incoming != nullptr)
+			{
+				auto* next = incoming->m_next;
+				incoming->m_next = m_runQueueHead;
+				m_runQueueHead = incoming;
+				incoming = next;
+			}
+		}
+
+		operation = m_runQueueHead;
+		if (operation == nullptr)
+		{
+			return nullptr;
+		}
+
+		m_runQueueHead = operation->m_next;
+		hasMore = m_runQueueHead != nullptr;
+	}
+
+	// We only take one operation at a time, so pass the remainder on to
+	// another thread rather than leaving it queued behind this one.
+	if (hasMore || m_runQueueIncoming.load(std::memory_order_relaxed) != nullptr)
+	{
+		wake_parked_thread();
+	}
+
+	return operation;
+}
+
+bool cppcoro::io_service::is_run_queue_empty() noexcept
+{
+	if (m_runQueueIncoming.load(std::memory_order_seq_cst) != nullptr)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock{ m_runQueueMutex };
+	return m_runQueueHead == nullptr;
 }
 
+void cppcoro::io_service::wake_parked_thread() noexcept
+{
+	if (m_parkedThreadCount.load(std::memory_order_seq_cst) != 0)
+	{
+		m_mq.notify();
+	}
+}
+#endif
+
 void cppcoro::io_service::try_reschedule_overflow_operations() noexcept
 {
 	auto* operation = m_scheduleOperations.exchange(nullptr, std::memory_order_acquire);
@@ -509,9 +696,60 @@ bool cppcoro::io_service::try_process_one_event(bool waitForEvent)
 	}
  	while (true)
  	{
+#if CPPCORO_OS_LINUX
+		// Whatever we dispatch next starts a new run of inline completions.
+		if (local::inlineCompletions.m_service == this)
+		{
+			local::inlineCompletions.m_count = 0;
+		}
+
+		if (auto* operation = try_pop_run_queue())
+		{
+			operation->m_awaiter.resume();
+			return true;
+		}
+
+		detail::message message;
+		bool ok;
+		if (waitForEvent)
+		{
+			// Announce that we are about to block before checking the run
+			// queue one last time. See schedule_impl().
+			m_parkedThreadCount.fetch_add(1, std::memory_order_seq_cst);
+			auto unpark = on_scope_exit([this] {
+				m_parkedThreadCount.fetch_sub(1, std::memory_order_relaxed);
+			});
+
+			if (!is_run_queue_empty())
+			{
+				continue;
+			}
+
+			ok = m_mq.dequeue_message(message, waitForEvent);
+		}
+		else
+		{
+			ok = m_mq.dequeue_message(message, waitForEvent);
+		}
+
+#if !CPPCORO_USE_IO_URING
+		// The rest of a harvested batch, and any posted completions, wait in
+		// the message queue. Make sure a parked thread picks them up rather
+		// than leaving it all to this one, which may be about to leave the
+		// event loop. The parked count is read after the batch was queued,
+		// so a thread that parks later sees the batch before blocking.
+		if (ok &&
+			m_parkedThreadCount.load(std::memory_order_seq_cst) != 0 &&
+			m_mq.has_ready_messages())
+		{
+			m_mq.notify();
+		}
+#endif
+#else
  		try_reschedule_overflow_operations();
 		detail::message message;
  		bool ok = m_mq.dequeue_message(message, waitForEvent);
+#endif
 
  		if (!ok)
  		{
@@ -903,35 +1141,41 @@ cppcoro::io_service::timed_schedule_operation::timed_schedule_operation(
 	: cppcoro::detail::async_operation_cancellable<timed_schedule_operation>(
  				&service, std::move(ct))
 	, m_resumeTime(resumeTime)
- 	, m_timerfd(detail::linux::create_timer_fd())
 {}
 
+#if CPPCORO_USE_IO_URING
 bool cppcoro::io_service::timed_schedule_operation::try_start() noexcept {
-	m_fd = m_timerfd.fd();
-	std::chrono::high_resolution_clock::time_point currentTime = std::chrono::high_resolution_clock::now();
-	auto waitTime = m_resumeTime - currentTime;
-	itimerspec alarm_time = { 0 };
-	if (waitTime.count() <= 0) {
-		//linux timer of 0 time will not generate events
-		//so let's set it to 1 nsec
-		alarm_time.it_value.tv_nsec = 1;
-	} else {
-		auto seconds = std::chrono::duration_cast<std::chrono::seconds>(waitTime);
-		auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(waitTime - seconds);
-		alarm_time.it_value.tv_sec = seconds.count();
-		alarm_time.it_value.tv_nsec = nanoseconds.count();
-	}
-	const bool ok = timerfd_settime(m_timerfd.fd(), 0, &alarm_time, NULL) != -1;
-	if (!ok) {
-		m_res = -errno;
-		return false;
+	auto waitTime = m_resumeTime - std::chrono::high_resolution_clock::now();
+	if (waitTime.count() < 0) {
+		waitTime = waitTime.zero();
 	}
-	m_completeFunc = [&]() {
-		return 0;
-	};
-	m_ioService->get_io_context().watch_handle(m_timerfd.fd(), reinterpret_cast<void*>(this), detail::watch_type::readable);
+	auto seconds = std::chrono::duration_cast<std::chrono::seconds>(waitTime);
+	auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(waitTime - seconds);
+	m_timeout.tv_sec = seconds.count();
+	m_timeout.tv_nsec = nanoseconds.count();
+	return try_submit({ IORING_OP_TIMEOUT, -1, &m_timeout, 1, 0, 0 });
+}
+
+std::size_t cppcoro::io_service::timed_schedule_operation::get_result()
+{
+	// An expired timeout completes with -ETIME.
+	if (m_res == -ETIME) {
+		m_res = 0;
+	}
+	return io_state::get_result();
+}
+#else
+bool cppcoro::io_service::timed_schedule_operation::try_start() noexcept {
+	m_res = 0;
+	m_completeFunc = nullptr;
+	m_ioService->get_io_context().schedule_timer(m_timer, static_cast<void*>(this), m_resumeTime);
 	return true;
 }
+
+void cppcoro::io_service::timed_schedule_operation::cancel() noexcept {
+	m_ioService->get_io_context().cancel_timer(m_timer);
+}
+#endif
 #elif CPPCORO_OS_DARWIN
 void cppcoro::io_service::schedule_operation::await_suspend(
 	cppcoro::coroutine_handle<> awaiter) noexcept 
@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cppcoro/io_service_pool.hpp>
+#include <cppcoro/net/socket.hpp>
+
+#include "cpu_topology.hpp"
+
+#include <algorithm>
+
+#if CPPCORO_OS_LINUX
+# include <sys/socket.h>
+#endif
+
+namespace
+{
+	namespace local
+	{
+		thread_local const cppcoro::io_service_pool* current_pool = nullptr;
+		thread_local cppcoro::io_service* current_service = nullptr;
+	}
+}
+
+namespace cppcoro
+{
+	io_service_pool::io_service_pool()
+		: io_service_pool(std::max(std::thread::hardware_concurrency(), 1u))
+	{
+	}
+
+	io_service_pool::io_service_pool(std::uint32_t threadCount, bool pinThreads)
+		: io_service_pool(io_service_pool_options{ std::max(threadCount, 1u), pinThreads })
+	{
+	}
+
+	io_service_pool::io_service_pool(const io_service_pool_options& options)
+		: m_nextIndex(0)
+	{
+		const std::uint32_t threadCount = options.thread_count > 0 ?
+			options.thread_count : std::max(std::thread::hardware_concurrency(), 1u);
+
+		m_services.reserve(threadCount);
+		for (std::uint32_t i = 0; i < threadCount; ++i)
+		{
+			// Each loop is only run by its own thread.
+			m_services.push_back(std::make_unique<io_service>(1));
+		}
+
+		if (options.pin_threads)
+		{
+			const auto& cpus = cpu_topology::get().available_cpus();
+			if (!cpus.empty())
+			{
+				m_cpus.reserve(threadCount);
+				for (std::uint32_t i = 0; i < threadCount; ++i)
+				{
+					m_cpus.push_back(cpus[i % cpus.size()]);
+				}
+			}
+		}
+
+		if (options.recycle_frames)
+		{
+			m_frameAllocators = std::make_unique<recycling_frame_allocator[]>(threadCount);
+		}
+
+		m_threads.reserve(threadCount);
+		try
+		{
+			for (std::uint32_t i = 0; i < threadCount; ++i)
+			{
+				m_threads.emplace_back([this, i] { this->run_event_loop(i); });
+			}
+		}
+		catch (...)
+		{
+			shutdown();
+			throw;
+		}
+	}
+
+	io_service_pool::~io_service_pool()
+	{
+		shutdown();
+	}
+
+	io_service& io_service_pool::next() noexcept
+	{
+		const auto index = m_nextIndex.fetch_add(1, std::memory_order_relaxed);
+		return *m_services[index % m_services.size()];
+	}
+
+	io_service& io_service_pool::service_for([[maybe_unused]] net::socket& socket) noexcept
+	{
+#if CPPCORO_OS_LINUX && defined(SO_INCOMING_CPU)
+		int cpu = -1;
+		socklen_t length = sizeof(cpu);
+		if (::getsockopt(socket.native_handle(), SOL_SOCKET, SO_INCOMING_CPU, &cpu, &length) == 0 &&
+			cpu >= 0)
+		{
+			if (m_cpus.empty())
+			{
+				return *m_services[static_cast<std::uint32_t>(cpu) % m_services.size()];
+			}
+
+			const auto it = std::find(m_cpus.begin(), m_cpus.end(), static_cast<std::uint32_t>(cpu));
+			if (it != m_cpus.end())
+			{
+				return *m_services[static_cast<std::size_t>(it - m_cpus.begin())];
+			}
+		}
+#endif
+
+		return next();
+	}
+
+	io_service* io_service_pool::current() const noexcept
+	{
+		return local::current_pool == this ? local::current_service : nullptr;
+	}
+
+	recycling_frame_allocator_stats io_service_pool::frame_stats() const noexcept
+	{
+		recycling_frame_allocator_stats stats;
+		if (m_frameAllocators)
+		{
+			for (std::size_t i = 0; i < m_services.size(); ++i)
+			{
+				const auto loopStats = m_frameAllocators[i].stats();
+				stats.hits += loopStats.hits;
+				stats.misses += loopStats.misses;
+			}
+		}
+		return stats;
+	}
+
+	void io_service_pool::run_event_loop(std::uint32_t index) noexcept
+	{
+		auto& service = *m_services[index];
+		local::current_pool = this;
+		local::current_service = &service;
+
+		if (!m_cpus.empty())
+		{
+			// Best effort; an unpinned loop still works.
+			cpu_topology::set_current_thread_affinity({ m_cpus[index] });
+		}
+
+		if (m_frameAllocators)
+		{
+			set_default_frame_allocator(&m_frameAllocators[index]);
+		}
+
+		service.process_events();
+	}
+
+	void io_service_pool::shutdown() noexcept
+	{
+		for (auto& service : m_services)
+		{
+			service->stop();
+		}
+
+		for (auto& thread : m_threads)
+		{
+			thread.join();
+		}
+	}
+}
@@ -5,7 +5,46 @@
 
 #include <cppcoro/detail/lightweight_manual_reset_event.hpp>
 
+#include "spin_wait.hpp"
+
 #include <system_error>
+#include <thread>
+
+namespace
+{
+	namespace local
+	{
+		// The number of times wait() checks the event before blocking, long
+		// enough to catch a set() from another thread that is about to
+		// complete without paying for a sleep and a wake-up.
+		constexpr std::uint32_t spin_count = 1000;
+
+		// Spinning is pointless on single-processor machines, where the
+		// thread that would set the event can't run while we spin. Looked up
+		// at startup rather than on the first wait() as it can block.
+		const bool is_multi_processor = std::thread::hardware_concurrency() > 1;
+
+		// Spin until \p isSet returns true or spin_count is reached.
+		template<typename IS_SET>
+		bool spin_until_set(IS_SET isSet) noexcept
+		{
+			if (is_multi_processor)
+			{
+				for (std::uint32_t i = 0; i < spin_count; ++i)
+				{
+					if (isSet())
+					{
+						return true;
+					}
+
+					cppcoro::spin_wait::pause();
+				}
+			}
+
+			return isSet();
+		}
+	}
+}
 
 #if CPPCORO_OS_WINNT
 # ifndef WIN32_LEAN_AND_MEAN
@@ -36,6 +75,11 @@ void cppcoro::detail::lightweight_manual_reset_event::reset() noexcept
 
 void cppcoro::detail::lightweight_manual_reset_event::wait() noexcept
 {
+	if (local::spin_until_set([this] { return m_value.load(std::memory_order_acquire) != 0; }))
+	{
+		return;
+	}
+
 	// Wait in a loop as WaitOnAddress() can have spurious wake-ups.
 	int value = m_value.load(std::memory_order_acquire);
 	BOOL ok = TRUE;
@@ -118,6 +162,11 @@ namespace
 {
 	namespace local
 	{
+		// Values of m_value.
+		constexpr int not_set = 0;
+		constexpr int set = 1;
+		constexpr int not_set_with_waiters = 2;
+
 		// No futex() function provided by libc.
 		// Wrap the syscall ourselves here.
 		int futex(
@@ -141,7 +190,7 @@ namespace
 }
 
 cppcoro::detail::lightweight_manual_reset_event::lightweight_manual_reset_event(bool initiallySet)
-	: m_value(initiallySet ? 1 : 0)
+	: m_value(initiallySet ? local::set : local::not_set)
 {}
 
 cppcoro::detail::lightweight_manual_reset_event::~lightweight_manual_reset_event()
@@ -150,7 +199,11 @@ cppcoro::detail::lightweight_manual_reset_event::~lightweight_manual_reset_event
 
 void cppcoro::detail::lightweight_manual_reset_event::set() noexcept
 {
-	m_value.store(1, std::memory_order_release);
+	// Only make the syscall if a thread may be blocked in wait().
+	if (m_value.exchange(local::set, std::memory_order_release) != local::not_set_with_waiters)
+	{
+		return;
+	}
 
 	constexpr int numberOfWaitersToWakeUp = INT_MAX;
 
@@ -169,34 +222,41 @@ void cppcoro::detail::lightweight_manual_reset_event::set() noexcept
 
 void cppcoro::detail::lightweight_manual_reset_event::reset() noexcept
 {
-	m_value.store(0, std::memory_order_relaxed);
+	// Leave the event alone if it isn't set, so that blocked waiters are
+	// still woken by the next set().
+	int oldValue = local::set;
+	m_value.compare_exchange_strong(oldValue, local::not_set, std::memory_order_relaxed);
 }
 
 void cppcoro::detail::lightweight_manual_reset_event::wait() noexcept
 {
+	if (local::spin_until_set([this] { return m_value.load(std::memory_order_acquire) == local::set; }))
+	{
+		return;
+	}
+
 	// Wait in a loop as futex() can have spurious wake-ups.
 	int oldValue = m_value.load(std::memory_order_acquire);
-	while (oldValue == 0)
+	while (oldValue != local::set)
 	{
-		int result = local::futex(
+		// Tell set() that it needs to wake us before going to sleep.
+		if (oldValue == local::not_set &&
+			!m_value.compare_exchange_weak(
+				oldValue, local::not_set_with_waiters, std::memory_order_acquire))
+		{
+			continue;
+		}
+
+		// Fails with EAGAIN if the event was set before we could wait.
+		// Other errors we'll treat as transient. Either way, read the value
+		// and go around the loop again.
+		(void)local::futex(
 			reinterpret_cast<int*>(&m_value),
 			FUTEX_WAIT_PRIVATE,
-			oldValue,
+			local::not_set_with_waiters,
 			nullptr,
 			nullptr,
 			0);
-		if (result == -1)
-		{
-			if (errno == EAGAIN)
-			{
-				// The state was changed from zero before we could wait.
-				// Must have been changed to 1.
-				return;
-			}
-
-			// Other errors we'll treat as transient and just read the
-			// value and go around the loop again.
-		}
 
 		oldValue = m_value.load(std::memory_order_acquire);
 	}
@@ -125,7 +125,25 @@ namespace cppcoro
 
 			void io_state::on_operation_completed_base()
 			{
+#if CPPCORO_USE_IO_URING
+				// Natively submitted operations already have their result in
+				// m_res. Polled operations still need to perform their I/O now
+				// that the handle is ready, unless the poll itself failed.
+				if (m_res < 0 || !m_completeFunc)
+				{
+					return;
+				}
+#else
+				// Operations on a persistent registration have already
+				// performed their I/O when the handle became ready, and
+				// operations without an m_completeFunc, such as timers and
+				// blocking I/O, already hold their result.
+				if (m_registration != nullptr || !m_completeFunc)
+				{
+					return;
+				}
 				m_ioService->get_io_context().unwatch_handle(m_fd);
+#endif
 				m_res = m_completeFunc();
 				if (m_res < 0) {
 					m_res = -errno;
@@ -134,13 +152,38 @@ namespace cppcoro
 
 			void io_state::cancel() noexcept
 			{
+#if CPPCORO_USE_IO_URING
+				// The operation's own completion is still delivered, carrying
+				// -ECANCELED if the cancellation won the race.
+				m_ioService->get_io_context().cancel_io(static_cast<void*>(this));
+#else
+				if (m_registration != nullptr)
+				{
+					m_ioService->get_io_context().unwatch_handle(*m_registration, static_cast<void*>(this));
+					return;
+				}
 				m_ioService->get_io_context().unwatch_handle(m_fd);
 				m_res = -ECANCELED;
 				m_ioService->get_io_context().enqueue_message({
 					message_type::CALLBACK_TYPE,
 					static_cast<void*>(this)
 				});
+#endif
+			}
+
+#if CPPCORO_USE_IO_URING
+			bool io_state::try_submit(const io_uring_request& request) noexcept
+			{
+				m_completeFunc = nullptr;
+				if (m_ioService->get_io_context().submit_io(request, static_cast<void*>(this)))
+				{
+					return true;
+				}
+
+				m_res = -EAGAIN;
+				return false;
 			}
+#endif
 		}
 	}
 }
@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "linux_blocking_io_pool.hpp"
+
+#include <cppcoro/detail/async_operation.hpp>
+
+#include <algorithm>
+#include <cerrno>
+
+namespace cppcoro
+{
+	namespace detail
+	{
+		namespace linux
+		{
+			blocking_io_pool::blocking_io_pool(message_queue& queue, std::uint32_t maxThreadCount) noexcept
+				: m_queue(queue)
+				, m_maxThreadCount(maxThreadCount)
+				, m_idleThreadCount(0)
+				, m_stopRequested(false)
+			{
+			}
+
+			blocking_io_pool::~blocking_io_pool()
+			{
+				{
+					std::lock_guard<std::mutex> lock{ m_mutex };
+					m_stopRequested = true;
+				}
+				m_wakeUp.notify_all();
+
+				for (auto& thread : m_threads)
+				{
+					thread.join();
+				}
+			}
+
+			bool blocking_io_pool::submit(void* cb) noexcept
+			{
+				{
+					std::lock_guard<std::mutex> lock{ m_mutex };
+					try
+					{
+						m_pending.push_back(cb);
+					}
+					catch (...)
+					{
+						return false;
+					}
+
+					if (m_idleThreadCount == 0 && m_threads.size() < m_maxThreadCount)
+					{
+						try
+						{
+							m_threads.emplace_back([this] { run(); });
+						}
+						catch (...)
+						{
+							if (m_threads.empty())
+							{
+								// No thread will ever run it.
+								m_pending.pop_back();
+								return false;
+							}
+						}
+					}
+				}
+
+				m_wakeUp.notify_one();
+				return true;
+			}
+
+			bool blocking_io_pool::cancel(void* cb) noexcept
+			{
+				std::lock_guard<std::mutex> lock{ m_mutex };
+				auto it = std::find(m_pending.begin(), m_pending.end(), cb);
+				if (it == m_pending.end())
+				{
+					return false;
+				}
+
+				m_pending.erase(it);
+				return true;
+			}
+
+			void blocking_io_pool::run() noexcept
+			{
+				std::unique_lock<std::mutex> lock{ m_mutex };
+				while (true)
+				{
+					++m_idleThreadCount;
+					m_wakeUp.wait(lock, [this] { return m_stopRequested || !m_pending.empty(); });
+					--m_idleThreadCount;
+
+					if (m_stopRequested)
+					{
+						return;
+					}
+
+					void* cb = m_pending.front();
+					m_pending.pop_front();
+					lock.unlock();
+
+					auto* operation = static_cast<async_operation_base*>(cb);
+					const int result = operation->m_completeFunc();
+					operation->m_res = result < 0 ? -errno : result;
+
+					// Tell on_operation_completed_base() the result is ready.
+					operation->m_completeFunc = nullptr;
+					m_queue.post_completion(cb);
+
+					lock.lock();
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPCORO_LINUX_BLOCKING_IO_POOL_HPP_INCLUDED
+#define CPPCORO_LINUX_BLOCKING_IO_POOL_HPP_INCLUDED
+
+#include <cppcoro/detail/message_queue.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cppcoro
+{
+	namespace detail
+	{
+		namespace linux
+		{
+			/// A bounded pool of threads that run I/O operations that would
+			/// block, such as regular file I/O, and then dispatch them to a
+			/// message_queue.
+			///
+			/// Threads are started on demand, up to the maximum.
+			class blocking_io_pool
+			{
+			public:
+
+				blocking_io_pool(message_queue& queue, std::uint32_t maxThreadCount) noexcept;
+
+				/// Waits for the threads to finish the operations they are
+				/// running. Operations that have not started are dropped.
+				~blocking_io_pool();
+
+				blocking_io_pool(const blocking_io_pool& other) = delete;
+				blocking_io_pool& operator=(const blocking_io_pool& other) = delete;
+
+				/// Queue an operation to have its m_completeFunc run on a pool
+				/// thread.
+				///
+				/// \return
+				/// false if the operation could not be queued.
+				bool submit(void* cb) noexcept;
+
+				/// Remove an operation that has not started running yet.
+				///
+				/// \return
+				/// true if the operation was removed, false if it is running
+				/// or has already completed.
+				bool cancel(void* cb) noexcept;
+
+			private:
+
+				void run() noexcept;
+
+				message_queue& m_queue;
+				const std::uint32_t m_maxThreadCount;
+
+				std::mutex m_mutex;
+				std::condition_variable m_wakeUp;
+				std::deque<void*> m_pending;
+				std::vector<std::thread> m_threads;
+				std::uint32_t m_idleThreadCount;
+				bool m_stopRequested;
+
+			};
+		}
+	}
+}
+
+#endif
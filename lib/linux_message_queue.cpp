@@ -3,21 +3,267 @@
 // Licenced under MIT license. See LICENSE.txt for details.
 ///////////////////////////////////////////////////////////////////////////////
 #include <cppcoro/detail/message_queue.hpp>
+#include <cppcoro/detail/async_operation.hpp>
+#include "linux_blocking_io_pool.hpp"
+#include "linux_timer_wheel.hpp"
 #include <cassert>
 #include <cstring>
+#include <iterator>
 #include <system_error>
+#include <utility>
+#include <vector>
 #include <unistd.h>
 #include <sys/epoll.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
 #include <fcntl.h>
 
+#ifndef CPPCORO_BLOCKING_IO_THREAD_COUNT
+# define CPPCORO_BLOCKING_IO_THREAD_COUNT 4
+#endif
 
 namespace cppcoro
 {
 	namespace detail
 	{
-		message_queue::message_queue(std::uint32_t concurrencyHint)
-			: m_pollfd(safe_file_handle_t{ linux::create_epoll_fd() })
+		namespace linux
+		{
+			struct fd_registration
+			{
+				struct direction
+				{
+					direction() noexcept
+						: m_waiter(nullptr)
+						, m_running(nullptr)
+						, m_ready(false)
+						, m_cancelRequested(false)
+					{}
+
+					// Operation waiting for the next readiness edge.
+					io_state* m_waiter;
+					// Operation whose m_completeFunc some thread is running.
+					io_state* m_running;
+					// An edge arrived while no operation was waiting for it.
+					bool m_ready;
+					// Cancellation was requested while m_running was running.
+					bool m_cancelRequested;
+				};
+
+				fd_registration() noexcept
+					: m_fd(-1)
+					, m_next(nullptr)
+				{}
+
+				fd_t m_fd;
+				std::mutex m_mutex;
+				direction m_read;
+				direction m_write;
+				fd_registration* m_next;
+			};
+		}
+	}
+}
+
+namespace
+{
+	namespace local
+	{
+		using cppcoro::detail::linux::fd_registration;
+		using cppcoro::detail::linux::io_state;
+
+		// Maximum number of threads each io_service starts for blocking I/O.
+		// Override by defining CPPCORO_BLOCKING_IO_THREAD_COUNT when building the library.
+		constexpr std::uint32_t blocking_io_thread_count = CPPCORO_BLOCKING_IO_THREAD_COUNT;
+		static_assert(blocking_io_thread_count > 0);
+
+		// Set in epoll_event::data for events on a fd_registration.
+		constexpr std::uintptr_t registration_tag = 1;
+		static_assert(alignof(fd_registration) > registration_tag);
+
+		bool would_block(int error) noexcept
+		{
+			// connect() reports EALREADY while a connection is in progress.
+			return error == EAGAIN || error == EWOULDBLOCK || error == EALREADY || error == EINPROGRESS;
+		}
+
+		// Run m_completeFunc for the operation in direction.m_running, retrying
+		// while further edges arrive.
+		//
+		// Returns the operation if it has completed, with the result in m_res,
+		// or nullptr if it would still block and is waiting again.
+		io_state* run_operation(fd_registration& registration, fd_registration::direction& direction)
+		{
+			auto* operation = direction.m_running;
+			while (true)
+			{
+				const int result = operation->m_completeFunc();
+				const int error = errno;
+
+				std::lock_guard<std::mutex> lock{ registration.m_mutex };
+				if (result >= 0 || !would_block(error))
+				{
+					operation->m_res = result >= 0 ? result : -error;
+				}
+				else if (direction.m_cancelRequested)
+				{
+					operation->m_res = -ECANCELED;
+				}
+				else if (direction.m_ready)
+				{
+					direction.m_ready = false;
+					continue;
+				}
+				else
+				{
+					direction.m_waiter = operation;
+					direction.m_running = nullptr;
+					return nullptr;
+				}
+
+				// Only a would-block result shows that the handle has been
+				// drained, so the next operation should try its syscall first.
+				direction.m_ready = true;
+				direction.m_running = nullptr;
+				direction.m_cancelRequested = false;
+				return operation;
+			}
+		}
+
+		// Handle a readiness edge in one direction.
+		io_state* on_ready(fd_registration& registration, fd_registration::direction& direction)
+		{
+			{
+				std::lock_guard<std::mutex> lock{ registration.m_mutex };
+				if (direction.m_waiter == nullptr)
+				{
+					direction.m_ready = true;
+					return nullptr;
+				}
+
+				direction.m_running = std::exchange(direction.m_waiter, nullptr);
+			}
+
+			return run_operation(registration, direction);
+		}
+
+		cppcoro::detail::message completion_message(io_state* operation) noexcept
+		{
+			return {
+				cppcoro::detail::message_type::CALLBACK_TYPE,
+				static_cast<cppcoro::detail::async_operation_base*>(operation)
+			};
+		}
+
+		io_state* to_operation(void* cb) noexcept
+		{
+			return static_cast<cppcoro::detail::async_operation_base*>(cb);
+		}
+
+		// Storage for the events harvested by one epoll_wait() and the
+		// messages they translate into. Each thread reuses its own, grown to
+		// the largest batch size of any queue it has polled.
+		struct harvest_buffers
+		{
+			std::vector<epoll_event> m_events;
+			std::vector<cppcoro::detail::message> m_messages;
+		};
+
+		harvest_buffers& get_harvest_buffers(std::uint32_t batchSize)
+		{
+			thread_local harvest_buffers buffers;
+			if (buffers.m_events.size() < batchSize)
+			{
+				buffers.m_events.resize(batchSize);
+				// Each event yields up to two messages, plus whatever is
+				// read from the pipe.
+				buffers.m_messages.resize(std::size_t(batchSize) * 3);
+			}
+			return buffers;
+		}
+
+		// Resolution of the timer wheel.
+		using timer_tick = std::chrono::milliseconds;
+	}
+}
+
+namespace cppcoro
+{
+	namespace detail
+	{
+		struct message_queue::timer_state
+		{
+			timer_state()
+				: m_timerfd(linux::create_timer_fd())
+				, m_epoch(std::chrono::steady_clock::now())
+				, m_armedTick(linux::timer_wheel::no_expiry)
+			{}
+
+			std::uint64_t now_tick() const noexcept
+			{
+				return static_cast<std::uint64_t>(std::chrono::floor<local::timer_tick>(
+					std::chrono::steady_clock::now() - m_epoch).count());
+			}
+
+			// The first tick at or after dueTime, so that timers never
+			// expire early.
+			std::uint64_t to_tick(std::chrono::high_resolution_clock::time_point dueTime) const noexcept
+			{
+				// The wheel runs off the monotonic clock, which the timer fd
+				// also uses.
+				const auto remaining = dueTime - std::chrono::high_resolution_clock::now();
+				const auto sinceEpoch = std::chrono::steady_clock::now() + remaining - m_epoch;
+				if (sinceEpoch.count() <= 0)
+				{
+					return 0;
+				}
+				return static_cast<std::uint64_t>(
+					std::chrono::ceil<local::timer_tick>(sinceEpoch).count());
+			}
+
+			// Arm the timer fd for the wheel's next expiry.
+			// Must be called with m_mutex held.
+			void rearm() noexcept
+			{
+				const std::uint64_t nextTick = m_wheel.next_expiry();
+				if (nextTick == m_armedTick)
+				{
+					return;
+				}
+				m_armedTick = nextTick;
+
+				itimerspec alarm_time = { 0 };
+				if (nextTick != linux::timer_wheel::no_expiry)
+				{
+					const auto deadline = (m_epoch + local::timer_tick{ nextTick }).time_since_epoch();
+					const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(deadline);
+					alarm_time.it_value.tv_sec = seconds.count();
+					alarm_time.it_value.tv_nsec =
+						std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - seconds).count();
+				}
+				(void)timerfd_settime(m_timerfd.fd(), TFD_TIMER_ABSTIME, &alarm_time, nullptr);
+			}
+
+			std::mutex m_mutex;
+			linux::timer_wheel m_wheel;
+			linux::safe_fd m_timerfd;
+			const std::chrono::steady_clock::time_point m_epoch;
+			std::uint64_t m_armedTick;
+		};
+
+		message_queue::message_queue(std::uint32_t concurrencyHint, std::uint32_t eventBatchSize)
+			: m_eventBatchSize(eventBatchSize)
+			, m_batchCount(0)
+			, m_batchEventCount(0)
+			, m_largestBatch(0)
+			, m_readyIndex(0)
+			, m_postedIncoming(nullptr)
+			, m_postedHead(nullptr)
+			, m_eventfd(linux::create_event_fd())
+			, m_freeRegistrations(nullptr)
+			, m_timers(std::make_unique<timer_state>())
+			, m_blockingPool(std::make_unique<linux::blocking_io_pool>(*this, local::blocking_io_thread_count))
+			, m_notifyPending(false)
+			, m_pollfd(safe_file_handle_t{ linux::create_epoll_fd() })
 		{
 			if (pipe2(m_pipefd, O_NONBLOCK) == -1)
 			{
@@ -25,11 +271,44 @@ namespace cppcoro
 										 std::system_category(),
 										 "Error creating io_service: failed creating pipe" };
 			}
-			watch_handle(m_pipefd[0], reinterpret_cast<void*>(m_pipefd[0]), watch_type::readable);
+			assert(m_eventBatchSize > 0);
+			m_ready.reserve(m_eventBatchSize);
+
+			struct epoll_event ev = { 0 };
+			ev.events = EPOLLIN;
+			ev.data.ptr = m_pipefd;
+			if (epoll_ctl(m_pollfd.fd(), EPOLL_CTL_ADD, m_pipefd[0], &ev) == -1)
+			{
+				throw std::system_error{ static_cast<int>(errno),
+										 std::system_category(),
+										 "Error creating io_service: failed watching pipe" };
+			}
+
+			// Edge-triggered so that each notification wakes a single waiter.
+			ev.events = EPOLLIN | EPOLLET;
+			ev.data.ptr = &m_eventfd;
+			if (epoll_ctl(m_pollfd.fd(), EPOLL_CTL_ADD, m_eventfd.fd(), &ev) == -1)
+			{
+				throw std::system_error{ static_cast<int>(errno),
+										 std::system_category(),
+										 "Error creating io_service: failed watching event fd" };
+			}
+
+			ev.events = EPOLLIN | EPOLLET;
+			ev.data.ptr = m_timers.get();
+			if (epoll_ctl(m_pollfd.fd(), EPOLL_CTL_ADD, m_timers->m_timerfd.fd(), &ev) == -1)
+			{
+				throw std::system_error{ static_cast<int>(errno),
+										 std::system_category(),
+										 "Error creating io_service: failed watching timer fd" };
+			}
 		}
 
 		message_queue::~message_queue()
 		{
+			// The pool's threads post completions to this queue.
+			m_blockingPool.reset();
+
 			try {
 			unwatch_handle(m_pipefd[0]);
 			} catch (...) {/* intentionally left empty */}
@@ -55,6 +334,9 @@ namespace cppcoro
 				ev.events = EPOLLIN | EPOLLOUT;
 				break;
 			}
+			// One-shot, so that once an event has been harvested no other
+			// thread can see it again before the operation unwatches the handle.
+			ev.events |= EPOLLONESHOT;
 			ev.data.ptr = cb;
 			if (epoll_ctl(m_pollfd.fd(), EPOLL_CTL_ADD, handle, &ev) == -1)
 			{
@@ -73,6 +355,186 @@ namespace cppcoro
 			}
 		}
 
+		linux::fd_registration* message_queue::register_handle(file_handle_t handle) noexcept
+		{
+			linux::fd_registration* registration;
+			{
+				std::lock_guard<std::mutex> lock{ m_registrationMutex };
+				registration = m_freeRegistrations;
+				if (registration != nullptr)
+				{
+					m_freeRegistrations = registration->m_next;
+				}
+				else
+				{
+					try
+					{
+						m_registrations.push_back(std::make_unique<linux::fd_registration>());
+					}
+					catch (...)
+					{
+						return nullptr;
+					}
+					registration = m_registrations.back().get();
+				}
+			}
+
+			registration->m_fd = handle;
+
+			struct epoll_event ev = { 0 };
+			ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+			ev.data.ptr = reinterpret_cast<void*>(
+				reinterpret_cast<std::uintptr_t>(registration) | local::registration_tag);
+			if (epoll_ctl(m_pollfd.fd(), EPOLL_CTL_ADD, handle, &ev) == -1)
+			{
+				deregister_handle(registration);
+				return nullptr;
+			}
+
+			return registration;
+		}
+
+		void message_queue::deregister_handle(linux::fd_registration* registration) noexcept
+		{
+			(void)epoll_ctl(m_pollfd.fd(), EPOLL_CTL_DEL, registration->m_fd, NULL);
+
+			{
+				std::lock_guard<std::mutex> lock{ registration->m_mutex };
+				assert(registration->m_read.m_waiter == nullptr);
+				assert(registration->m_write.m_waiter == nullptr);
+				registration->m_fd = -1;
+				registration->m_read = linux::fd_registration::direction{};
+				registration->m_write = linux::fd_registration::direction{};
+			}
+
+			std::lock_guard<std::mutex> lock{ m_registrationMutex };
+			registration->m_next = m_freeRegistrations;
+			m_freeRegistrations = registration;
+		}
+
+		void message_queue::watch_handle(linux::fd_registration& registration, void* cb, watch_type events)
+		{
+			auto* operation = local::to_operation(cb);
+			operation->m_registration = &registration;
+
+			auto& direction = events == watch_type::readable ? registration.m_read : registration.m_write;
+			{
+				std::lock_guard<std::mutex> lock{ registration.m_mutex };
+				assert(direction.m_waiter == nullptr && direction.m_running == nullptr);
+				if (!direction.m_ready)
+				{
+					direction.m_waiter = operation;
+					return;
+				}
+
+				// The handle became ready since the last operation in this
+				// direction stopped waiting. Try it now.
+				direction.m_ready = false;
+				direction.m_running = operation;
+			}
+
+			if (local::run_operation(registration, direction) != nullptr)
+			{
+				post_completion(cb);
+			}
+		}
+
+		void message_queue::unwatch_handle(linux::fd_registration& registration, void* cb) noexcept
+		{
+			auto* operation = local::to_operation(cb);
+			bool cancelled = false;
+			{
+				std::lock_guard<std::mutex> lock{ registration.m_mutex };
+				for (auto* direction : { &registration.m_read, &registration.m_write })
+				{
+					if (direction->m_waiter == operation)
+					{
+						direction->m_waiter = nullptr;
+						cancelled = true;
+						break;
+					}
+					if (direction->m_running == operation)
+					{
+						direction->m_cancelRequested = true;
+						break;
+					}
+				}
+			}
+
+			if (cancelled)
+			{
+				operation->m_res = -ECANCELED;
+				post_completion(cb);
+			}
+		}
+
+		void message_queue::schedule_timer(
+			linux::timer_node& node,
+			void* cb,
+			std::chrono::high_resolution_clock::time_point dueTime)
+		{
+			node.m_cb = cb;
+			node.m_when = m_timers->to_tick(dueTime);
+			{
+				std::lock_guard<std::mutex> lock{ m_timers->m_mutex };
+				if (node.m_when > m_timers->now_tick())
+				{
+					m_timers->m_wheel.insert(node);
+					if (node.m_when < m_timers->m_armedTick)
+					{
+						m_timers->rearm();
+					}
+					return;
+				}
+			}
+
+			// Already due.
+			post_completion(cb);
+		}
+
+		void message_queue::cancel_timer(linux::timer_node& node) noexcept
+		{
+			bool removed;
+			{
+				std::lock_guard<std::mutex> lock{ m_timers->m_mutex };
+				removed = m_timers->m_wheel.remove(node);
+			}
+
+			if (removed)
+			{
+				local::to_operation(node.m_cb)->m_res = -ECANCELED;
+				post_completion(node.m_cb);
+			}
+		}
+
+		linux::timer_node* message_queue::expire_timers()
+		{
+			std::uint64_t expirations;
+			(void)read(m_timers->m_timerfd.fd(), &expirations, sizeof(expirations));
+
+			std::lock_guard<std::mutex> lock{ m_timers->m_mutex };
+			auto* expired = m_timers->m_wheel.advance(m_timers->now_tick());
+
+			// The timer fd has fired, so it is no longer armed.
+			m_timers->m_armedTick = linux::timer_wheel::no_expiry;
+			m_timers->rearm();
+			return expired;
+		}
+
+		bool message_queue::submit_blocking(void* cb) noexcept
+		{
+			return m_blockingPool->submit(cb);
+		}
+
+		void message_queue::cancel_blocking(void* cb) noexcept
+		{
+			if (m_blockingPool->cancel(cb))
+			{
+				local::to_operation(cb)->m_res = -ECANCELED;
+				post_completion(cb);
+			}
+		}
+
 		void message_queue::unwatch_handle(file_handle_t handle)
 		{
 			if (epoll_ctl(m_pollfd.fd(), EPOLL_CTL_DEL, handle, NULL) == -1)
@@ -92,39 +554,53 @@ namespace cppcoro
 			return status == -1 ? false : true;
 		}
 
-		bool message_queue::dequeue_message(message& msg, bool wait)
+		void message_queue::post_completion(void* cb) noexcept
 		{
-			struct epoll_event ev = { 0 };
-			int nfds = epoll_wait(m_pollfd.fd(), &ev, 1, wait ? -1 : 0);
+			auto* operation = local::to_operation(cb);
+			auto* head = m_postedIncoming.load(std::memory_order_relaxed);
+			do
+			{
+				operation->m_next = head;
+			} while (!m_postedIncoming.compare_exchange_weak(
+				head,
+				operation,
+				std::memory_order_release,
+				std::memory_order_relaxed));
+
+			// A thread blocked in epoll_wait() will not look for it otherwise.
+			notify();
+		}
 
-			if (nfds == -1)
+		void message_queue::notify() noexcept
+		{
+			if (!m_notifyPending.exchange(true, std::memory_order_acq_rel))
 			{
-				if (errno == EINTR || errno == EAGAIN)
+				const std::uint64_t count = 1;
+				if (write(m_eventfd.fd(), &count, sizeof(count)) == -1)
 				{
-					return false;
+					m_notifyPending.store(false, std::memory_order_relaxed);
 				}
-				throw std::system_error{ static_cast<int>(errno),
-										 std::system_category(),
-										 "Error in epoll_wait run loop" };
-			}
-
-			if (nfds == 0 && !wait)
-			{
-				return false;
 			}
+		}
 
-			if (nfds == 0 && wait)
+		bool message_queue::dequeue_message(message& msg, bool wait)
+		{
+			while (true)
 			{
-				throw std::system_error{ static_cast<int>(errno),
-										 std::system_category(),
-										 "Error in epoll_wait run loop" };
-			}
+				if (try_pop_ready(msg))
+				{
+					return true;
+				}
 
-			if (ev.data.fd == m_pipefd[0])
-			{
-				ssize_t status = read(m_pipefd[0], (char*)&msg, sizeof(msg));
+				// Harvest a batch of events and translate them into messages.
+				// The first is returned to the caller and the rest are queued
+				// for this or other threads to dispatch before polling again.
+				auto& buffers = local::get_harvest_buffers(m_eventBatchSize);
+				epoll_event* events = buffers.m_events.data();
+				int nfds = epoll_wait(
+					m_pollfd.fd(), events, static_cast<int>(m_eventBatchSize), wait ? -1 : 0);
 
-				if (status == -1)
+				if (nfds == -1)
 				{
 					if (errno == EINTR || errno == EAGAIN)
 					{
@@ -132,17 +608,185 @@ namespace cppcoro
 					}
 					throw std::system_error{ static_cast<int>(errno),
 											 std::system_category(),
-											 "Error retrieving message from message queue" };
+											 "Error in epoll_wait run loop" };
 				}
 
+				if (nfds == 0 && !wait)
+				{
+					return false;
+				}
+
+				if (nfds == 0 && wait)
+				{
+					throw std::system_error{ static_cast<int>(errno),
+											 std::system_category(),
+											 "Error in epoll_wait run loop" };
+				}
+
+				m_batchCount.fetch_add(1, std::memory_order_relaxed);
+				m_batchEventCount.fetch_add(static_cast<std::uint64_t>(nfds), std::memory_order_relaxed);
+				auto largestBatch = m_largestBatch.load(std::memory_order_relaxed);
+				while (static_cast<std::uint64_t>(nfds) > largestBatch &&
+					!m_largestBatch.compare_exchange_weak(
+						largestBatch, static_cast<std::uint64_t>(nfds), std::memory_order_relaxed))
+				{
+				}
+
+				message* harvested = buffers.m_messages.data();
+				std::size_t count = 0;
+				linux::timer_node* expiredTimers = nullptr;
+				for (int i = 0; i < nfds; ++i)
+				{
+					const auto& ev = events[i];
+					if (ev.data.ptr == &m_eventfd)
+					{
+						// Clear the flag before consuming the event so that a notify()
+						// racing with this thread posts a new one. The caller re-checks
+						// its queues on receiving the wake-up.
+						m_notifyPending.store(false, std::memory_order_release);
+						std::uint64_t value;
+						(void)read(m_eventfd.fd(), &value, sizeof(value));
+						harvested[count++] = { message_type::WAKEUP_TYPE, nullptr };
+					}
+					else if (ev.data.ptr == m_timers.get())
+					{
+						expiredTimers = expire_timers();
+					}
+					else if (ev.data.ptr == m_pipefd)
+					{
+						// Each message is written atomically, so the pipe only
+						// ever holds whole messages.
+						const std::size_t space =
+							buffers.m_messages.size() - count - 2 * static_cast<std::size_t>(nfds - i - 1);
+						ssize_t status = read(m_pipefd[0], &harvested[count], space * sizeof(message));
+						if (status == -1)
+						{
+							// Another thread may have drained the pipe first.
+							if (errno != EINTR && errno != EAGAIN)
+							{
+								throw std::system_error{ static_cast<int>(errno),
+														 std::system_category(),
+														 "Error retrieving message from message queue" };
+							}
+						}
+						else
+						{
+							count += static_cast<std::size_t>(status) / sizeof(message);
+						}
+					}
+					else if ((reinterpret_cast<std::uintptr_t>(ev.data.ptr) & local::registration_tag) != 0)
+					{
+						auto& registration = *reinterpret_cast<linux::fd_registration*>(
+							reinterpret_cast<std::uintptr_t>(ev.data.ptr) & ~local::registration_tag);
+						const bool failed = (ev.events & (EPOLLERR | EPOLLHUP)) != 0;
+						if (failed || (ev.events & (EPOLLIN | EPOLLRDHUP)) != 0)
+						{
+							if (auto* operation = local::on_ready(registration, registration.m_read))
+							{
+								harvested[count++] = local::completion_message(operation);
+							}
+						}
+						if (failed || (ev.events & EPOLLOUT) != 0)
+						{
+							if (auto* operation = local::on_ready(registration, registration.m_write))
+							{
+								harvested[count++] = local::completion_message(operation);
+							}
+						}
+					}
+					else
+					{
+						harvested[count++] = { message_type::CALLBACK_TYPE, ev.data.ptr };
+					}
+				}
+
+				if (count == 0 && expiredTimers == nullptr)
+				{
+					continue;
+				}
+
+				if (count > 0)
+				{
+					msg = harvested[0];
+				}
+				else
+				{
+					msg = { message_type::CALLBACK_TYPE, expiredTimers->m_cb };
+					expiredTimers = expiredTimers->m_next;
+				}
+
+				if (count > 1 || expiredTimers != nullptr)
+				{
+					std::lock_guard<std::mutex> lock{ m_readyMutex };
+					if (count > 1)
+					{
+						m_ready.insert(m_ready.end(), harvested + 1, harvested + count);
+					}
+					while (expiredTimers != nullptr)
+					{
+						auto* next = expiredTimers->m_next;
+						m_ready.push_back({ message_type::CALLBACK_TYPE, expiredTimers->m_cb });
+						expiredTimers = next;
+					}
+				}
 				return true;
 			}
-			else
+		}
+
+		event_batch_stats message_queue::batch_stats() const noexcept
+		{
+			event_batch_stats stats;
+			stats.batch_count = m_batchCount.load(std::memory_order_relaxed);
+			stats.event_count = m_batchEventCount.load(std::memory_order_relaxed);
+			stats.largest_batch = m_largestBatch.load(std::memory_order_relaxed);
+			return stats;
+		}
+
+		bool message_queue::has_ready_messages() noexcept
+		{
+			std::lock_guard<std::mutex> lock{ m_readyMutex };
+			return m_readyIndex != m_ready.size() ||
+				m_postedHead != nullptr ||
+				m_postedIncoming.load(std::memory_order_relaxed) != nullptr;
+		}
+
+		bool message_queue::try_pop_ready(message& msg)
+		{
+			std::lock_guard<std::mutex> lock{ m_readyMutex };
+			if (m_readyIndex != m_ready.size())
 			{
-				msg.data = ev.data.ptr;
-				msg.type = message_type::CALLBACK_TYPE;
+				msg = m_ready[m_readyIndex++];
+				if (m_readyIndex == m_ready.size())
+				{
+					m_ready.clear();
+					m_readyIndex = 0;
+				}
 				return true;
 			}
+
+			if (m_postedHead == nullptr)
+			{
+				// Take everything posted since we last looked and reverse it
+				// so that completions are dispatched in the order they were posted.
+				auto* incoming = m_postedIncoming.exchange(nullptr, std::memory_order_acquire);
+				while (incoming != nullptr)
+				{
+					auto* next = incoming->m_next;
+					incoming->m_next = m_postedHead;
+					m_postedHead = incoming;
+					incoming = next;
+				}
+
+				if (m_postedHead == nullptr)
+				{
+					return false;
+				}
+			}
+
+			auto* operation = m_postedHead;
+			m_postedHead = operation->m_next;
+			msg = local::completion_message(operation);
+			return true;
 		}
 	}  // namespace detail
 }  // namespace cppcoro
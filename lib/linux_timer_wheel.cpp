@@ -0,0 +1,209 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "linux_timer_wheel.hpp"
+
+#include <cassert>
+
+namespace
+{
+	namespace local
+	{
+		constexpr std::uint64_t slot_range(unsigned level, unsigned bitsPerLevel) noexcept
+		{
+			return std::uint64_t(1) << (level * bitsPerLevel);
+		}
+
+		unsigned count_trailing_zeros(std::uint64_t value) noexcept
+		{
+			assert(value != 0);
+			return static_cast<unsigned>(__builtin_ctzll(value));
+		}
+
+		unsigned count_leading_zeros(std::uint64_t value) noexcept
+		{
+			assert(value != 0);
+			return static_cast<unsigned>(__builtin_clzll(value));
+		}
+
+		std::uint64_t rotate_right(std::uint64_t value, unsigned shift) noexcept
+		{
+			shift %= 64;
+			return shift == 0 ? value : (value >> shift) | (value << (64 - shift));
+		}
+	}
+}
+
+namespace cppcoro
+{
+	namespace detail
+	{
+		namespace linux
+		{
+			timer_wheel::timer_wheel() noexcept
+				: m_slots{}
+				, m_occupied{}
+				, m_elapsed(0)
+			{
+			}
+
+			void timer_wheel::insert(timer_node& node) noexcept
+			{
+				assert(node.m_when > m_elapsed);
+
+				// File the timer at the highest level at which its tick differs
+				// from the current one. Timers beyond the top level go in the top
+				// level and are re-filed when their slot comes round.
+				constexpr std::uint64_t maxDuration = local::slot_range(level_count, bits_per_level);
+				std::uint64_t masked = (m_elapsed ^ node.m_when) | (slots_per_level - 1);
+				if (masked >= maxDuration)
+				{
+					masked = maxDuration - 1;
+				}
+
+				const unsigned significantBit = 63 - local::count_leading_zeros(masked);
+				push(node, significantBit / bits_per_level);
+			}
+
+			bool timer_wheel::remove(timer_node& node) noexcept
+			{
+				if (node.m_level == timer_node::not_queued)
+				{
+					return false;
+				}
+
+				auto& head = m_slots[node.m_level][node.m_slot];
+				if (node.m_prev != nullptr)
+				{
+					node.m_prev->m_next = node.m_next;
+				}
+				else
+				{
+					assert(head == &node);
+					head = node.m_next;
+				}
+				if (node.m_next != nullptr)
+				{
+					node.m_next->m_prev = node.m_prev;
+				}
+
+				if (head == nullptr)
+				{
+					m_occupied[node.m_level] &= ~(std::uint64_t(1) << node.m_slot);
+				}
+
+				node.m_next = nullptr;
+				node.m_prev = nullptr;
+				node.m_level = timer_node::not_queued;
+				return true;
+			}
+
+			timer_node* timer_wheel::advance(std::uint64_t now) noexcept
+			{
+				timer_node* expired = nullptr;
+				timer_node** expiredTail = &expired;
+
+				expiration next;
+				while (next_expiration(next) && next.m_deadline <= now)
+				{
+					timer_node* node = m_slots[next.m_level][next.m_slot];
+					m_slots[next.m_level][next.m_slot] = nullptr;
+					m_occupied[next.m_level] &= ~(std::uint64_t(1) << next.m_slot);
+
+					assert(next.m_deadline > m_elapsed);
+					m_elapsed = next.m_deadline;
+
+					while (node != nullptr)
+					{
+						timer_node* nextNode = node->m_next;
+						if (node->m_when <= m_elapsed)
+						{
+							node->m_level = timer_node::not_queued;
+							node->m_prev = nullptr;
+							node->m_next = nullptr;
+							*expiredTail = node;
+							expiredTail = &node->m_next;
+						}
+						else
+						{
+							// Cascade down to a finer-grained level.
+							insert(*node);
+						}
+						node = nextNode;
+					}
+				}
+
+				if (now > m_elapsed)
+				{
+					m_elapsed = now;
+				}
+
+				return expired;
+			}
+
+			std::uint64_t timer_wheel::next_expiry() const noexcept
+			{
+				expiration next;
+				return next_expiration(next) ? next.m_deadline : no_expiry;
+			}
+
+			bool timer_wheel::next_expiration(expiration& result) const noexcept
+			{
+				// A level only holds timers that are due after every timer in the
+				// levels below it, so the lowest non-empty level has the answer.
+				for (unsigned level = 0; level < level_count; ++level)
+				{
+					const std::uint64_t occupied = m_occupied[level];
+					if (occupied == 0)
+					{
+						continue;
+					}
+
+					const std::uint64_t slotRange = local::slot_range(level, bits_per_level);
+					const std::uint64_t levelRange = local::slot_range(level + 1, bits_per_level);
+
+					// Find the first non-empty slot after the current one. The
+					// current slot and those before it can only hold top-level
+					// timers beyond the end of the wheel, which are due on the
+					// next rotation.
+					const unsigned firstSlot = static_cast<unsigned>((m_elapsed / slotRange + 1) % slots_per_level);
+					const unsigned slot =
+						(local::count_trailing_zeros(local::rotate_right(occupied, firstSlot)) + firstSlot)
+						% slots_per_level;
+
+					std::uint64_t deadline = (m_elapsed & ~(levelRange - 1)) + slot * slotRange;
+					if (deadline <= m_elapsed)
+					{
+						deadline += levelRange;
+					}
+
+					result = expiration{ level, slot, deadline };
+					return true;
+				}
+
+				return false;
+			}
+
+			void timer_wheel::push(timer_node& node, unsigned level) noexcept
+			{
+				const unsigned slot = static_cast<unsigned>(
+					(node.m_when >> (level * bits_per_level)) % slots_per_level);
+
+				auto& head = m_slots[level][slot];
+				node.m_level = static_cast<std::uint8_t>(level);
+				node.m_slot = static_cast<std::uint8_t>(slot);
+				node.m_prev = nullptr;
+				node.m_next = head;
+				if (head != nullptr)
+				{
+					head->m_prev = &node;
+				}
+				head = &node;
+
+				m_occupied[level] |= std::uint64_t(1) << slot;
+			}
+		}
+	}
+}
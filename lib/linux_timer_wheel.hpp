@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CPPCORO_LINUX_TIMER_WHEEL_HPP_INCLUDED
+#define CPPCORO_LINUX_TIMER_WHEEL_HPP_INCLUDED
+
+#include <cppcoro/detail/linux.hpp>
+
+#include <cstdint>
+
+namespace cppcoro
+{
+	namespace detail
+	{
+		namespace linux
+		{
+			/// A hierarchical timer wheel of intrusive timer_nodes.
+			///
+			/// Time is measured in ticks. Each of the levels has 64 slots, and
+			/// a slot at level N covers 64^N ticks, so insertion and removal are
+			/// O(1) and timers further than 64^6 ticks away are re-filed as the
+			/// wheel advances.
+			///
+			/// Not thread-safe; the caller must synchronise access.
+			class timer_wheel
+			{
+			public:
+
+				static constexpr std::uint64_t no_expiry = ~std::uint64_t(0);
+
+				timer_wheel() noexcept;
+
+				timer_wheel(const timer_wheel& other) = delete;
+				timer_wheel& operator=(const timer_wheel& other) = delete;
+
+				/// The tick up to which the wheel has been advanced.
+				std::uint64_t elapsed() const noexcept { return m_elapsed; }
+
+				/// Queue a timer.
+				///
+				/// node.m_when must be later than elapsed().
+				void insert(timer_node& node) noexcept;
+
+				/// Remove a timer if it is still queued.
+				///
+				/// \return
+				/// true if the timer was removed, false if it was not queued.
+				bool remove(timer_node& node) noexcept;
+
+				/// Advance the wheel to \p now and remove the timers that have
+				/// expired.
+				///
+				/// \return
+				/// The expired timers, linked through m_next.
+				timer_node* advance(std::uint64_t now) noexcept;
+
+				/// The earliest tick at which advance() may expire a timer,
+				/// or no_expiry if there are no timers.
+				std::uint64_t next_expiry() const noexcept;
+
+			private:
+
+				static constexpr unsigned bits_per_level = 6;
+				static constexpr unsigned slots_per_level = 1u << bits_per_level;
+				static constexpr unsigned level_count = 6;
+
+				struct expiration
+				{
+					unsigned m_level;
+					unsigned m_slot;
+					std::uint64_t m_deadline;
+				};
+
+				bool next_expiration(expiration& result) const noexcept;
+
+				void push(timer_node& node, unsigned level) noexcept;
+
+				timer_node* m_slots[level_count][slots_per_level];
+
+				// Bit N is set if slot N of the level is non-empty.
+				std::uint64_t m_occupied[level_count];
+
+				std::uint64_t m_elapsed;
+
+			};
+		}
+	}
+}
+
+#endif
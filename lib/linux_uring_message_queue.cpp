@@ -0,0 +1,451 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Microsoft
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#include <cppcoro/detail/message_queue.hpp>
+#include <cppcoro/detail/async_operation.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <mutex>
+#include <system_error>
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+	namespace local
+	{
+		// No io_uring functions are provided by libc.
+		// Wrap the syscalls ourselves here.
+		int io_uring_setup(std::uint32_t entries, io_uring_params* params)
+		{
+			return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+		}
+
+		int io_uring_enter(
+			int fd,
+			std::uint32_t toSubmit,
+			std::uint32_t minComplete,
+			std::uint32_t flags)
+		{
+			return static_cast<int>(syscall(
+				__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+		}
+
+		constexpr std::uint32_t submission_queue_size = 1024;
+		constexpr std::uint32_t completion_queue_size = 16 * 1024;
+
+		// The low bits of an SQE's user_data say what its completion means.
+		// Operations and coroutine frames are always at least 8-byte aligned.
+		constexpr std::uint64_t tag_mask = 3;
+		constexpr std::uint64_t operation_tag = 0;
+		constexpr std::uint64_t callback_tag = 1;
+		constexpr std::uint64_t resume_tag = 2;
+		constexpr std::uint64_t wakeup_tag = 3;
+
+		// user_data for SQEs whose completions carry no message,
+		// eg. cancellation requests.
+		constexpr std::uint64_t ignored_user_data = 0;
+
+		using ring_index = std::atomic<std::uint32_t>;
+		static_assert(sizeof(ring_index) == sizeof(std::uint32_t));
+		static_assert(ring_index::is_always_lock_free);
+
+		static_assert(sizeof(cppcoro::detail::linux::io_uring_timespec) == sizeof(__kernel_timespec));
+
+		io_uring_sqe make_sqe(std::uint8_t opcode, int fd, std::uint64_t userData) noexcept
+		{
+			io_uring_sqe sqe;
+			std::memset(&sqe, 0, sizeof(sqe));
+			sqe.opcode = opcode;
+			sqe.fd = fd;
+			sqe.user_data = userData;
+			return sqe;
+		}
+
+		std::uint64_t make_user_data(void* data, std::uint64_t tag) noexcept
+		{
+			const auto value = reinterpret_cast<std::uintptr_t>(data);
+			assert((value & tag_mask) == 0);
+			return static_cast<std::uint64_t>(value) | tag;
+		}
+	}
+}
+
+namespace cppcoro
+{
+	namespace detail
+	{
+		/// The shared memory regions of the io_uring instance.
+		struct message_queue::ring_state
+		{
+			ring_state() noexcept
+				: m_sqRing(MAP_FAILED)
+				, m_sqRingSize(0)
+				, m_cqRing(MAP_FAILED)
+				, m_cqRingSize(0)
+				, m_sqes(MAP_FAILED)
+				, m_sqesSize(0)
+			{}
+
+			~ring_state()
+			{
+				if (m_sqes != MAP_FAILED) ::munmap(m_sqes, m_sqesSize);
+				if (m_cqRing != MAP_FAILED) ::munmap(m_cqRing, m_cqRingSize);
+				if (m_sqRing != MAP_FAILED) ::munmap(m_sqRing, m_sqRingSize);
+			}
+
+			template<typename T>
+			static T* at(void* region, std::uint32_t offset) noexcept
+			{
+				return reinterpret_cast<T*>(static_cast<char*>(region) + offset);
+			}
+
+			// Publish \p sqe in the submission queue.
+			//
+			// Entries are normally left for the kernel to pick up when an
+			// event loop thread next calls io_uring_enter() from
+			// dequeue_message(), so that each loop iteration submits a batch
+			// with one syscall. They are submitted straight away if the
+			// submission queue is full or if a thread is already blocked
+			// waiting for completions and would not see them.
+			//
+			// Returns false only if the queue is full and the kernel would not
+			// take any of its entries.
+			bool try_push(int fd, const io_uring_sqe& sqe) noexcept
+			{
+				while (true)
+				{
+					{
+						std::scoped_lock lock{ m_sqMutex };
+						const auto tail = m_sqTail->load(std::memory_order_relaxed);
+						const auto head = m_sqHead->load(std::memory_order_acquire);
+						if (tail - head < m_sqEntries)
+						{
+							const auto index = tail & m_sqMask;
+							static_cast<io_uring_sqe*>(m_sqes)[index] = sqe;
+							m_sqArray[index] = index;
+							m_sqTail->store(tail + 1, std::memory_order_release);
+							break;
+						}
+					}
+
+					if (submit_pending(fd) <= 0)
+					{
+						return false;
+					}
+				}
+
+				// Pairs with the fence in dequeue_message(). Either a thread about
+				// to block sees our entry when it counts what to submit, or we see
+				// that it is waiting.
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (m_waitingThreadCount.load(std::memory_order_relaxed) != 0)
+				{
+					// Ignore failures here. Anything the kernel did not consume
+					// stays in the ring and is resubmitted by the next call to
+					// io_uring_enter().
+					(void)submit_pending(fd);
+				}
+
+				return true;
+			}
+
+			std::uint32_t pending_count() const noexcept
+			{
+				return m_sqTail->load(std::memory_order_acquire) -
+					m_sqHead->load(std::memory_order_acquire);
+			}
+
+			// Submit everything published so far without waiting for
+			// completions. Returns the number of entries the kernel took, or -1.
+			int submit_pending(int fd) noexcept
+			{
+				const auto pending = pending_count();
+				if (pending == 0)
+				{
+					return 0;
+				}
+
+				return local::io_uring_enter(fd, pending, 0, 0);
+			}
+
+			void* m_sqRing;
+			std::size_t m_sqRingSize;
+			void* m_cqRing;
+			std::size_t m_cqRingSize;
+			void* m_sqes;
+			std::size_t m_sqesSize;
+
+			local::ring_index* m_sqHead;
+			local::ring_index* m_sqTail;
+			local::ring_index* m_sqFlags;
+			std::uint32_t m_sqMask;
+			std::uint32_t m_sqEntries;
+			std::uint32_t* m_sqArray;
+
+			local::ring_index* m_cqHead;
+			local::ring_index* m_cqTail;
+			std::uint32_t m_cqMask;
+			io_uring_cqe* m_cqes;
+
+			// Submissions may come from any thread. Completions may be reaped
+			// by any of the threads running the event loop.
+			std::mutex m_sqMutex;
+			std::mutex m_cqMutex;
+
+			// The number of threads blocked in io_uring_enter() waiting for
+			// completions.
+			std::atomic<std::uint32_t> m_waitingThreadCount{ 0 };
+		};
+
+		namespace
+		{
+			void* map_ring_region(int fd, std::size_t size, off_t offset)
+			{
+				void* region = ::mmap(
+					nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+				if (region == MAP_FAILED)
+				{
+					throw std::system_error{ static_cast<int>(errno),
+											 std::system_category(),
+											 "Error creating io_service: failed mapping io_uring" };
+				}
+				return region;
+			}
+		}
+
+		message_queue::message_queue(std::uint32_t concurrencyHint)
+			: m_ring(std::make_unique<ring_state>())
+			, m_notifyPending(false)
+		{
+			io_uring_params params;
+			std::memset(&params, 0, sizeof(params));
+			params.flags = IORING_SETUP_CQSIZE;
+			params.cq_entries = local::completion_queue_size;
+
+			const int fd = local::io_uring_setup(local::submission_queue_size, &params);
+			if (fd == -1)
+			{
+				throw std::system_error{ static_cast<int>(errno),
+										 std::system_category(),
+										 "Error creating io_service: io_uring_setup" };
+			}
+			m_pollfd = safe_file_handle_t{ fd };
+
+			auto& ring = *m_ring;
+			ring.m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+			ring.m_sqRing = map_ring_region(fd, ring.m_sqRingSize, IORING_OFF_SQ_RING);
+			ring.m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			ring.m_cqRing = map_ring_region(fd, ring.m_cqRingSize, IORING_OFF_CQ_RING);
+			ring.m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+			ring.m_sqes = map_ring_region(fd, ring.m_sqesSize, IORING_OFF_SQES);
+
+			ring.m_sqHead = ring_state::at<local::ring_index>(ring.m_sqRing, params.sq_off.head);
+			ring.m_sqTail = ring_state::at<local::ring_index>(ring.m_sqRing, params.sq_off.tail);
+			ring.m_sqFlags = ring_state::at<local::ring_index>(ring.m_sqRing, params.sq_off.flags);
+			ring.m_sqMask = *ring_state::at<std::uint32_t>(ring.m_sqRing, params.sq_off.ring_mask);
+			ring.m_sqEntries = *ring_state::at<std::uint32_t>(ring.m_sqRing, params.sq_off.ring_entries);
+			ring.m_sqArray = ring_state::at<std::uint32_t>(ring.m_sqRing, params.sq_off.array);
+
+			ring.m_cqHead = ring_state::at<local::ring_index>(ring.m_cqRing, params.cq_off.head);
+			ring.m_cqTail = ring_state::at<local::ring_index>(ring.m_cqRing, params.cq_off.tail);
+			ring.m_cqMask = *ring_state::at<std::uint32_t>(ring.m_cqRing, params.cq_off.ring_mask);
+			ring.m_cqes = ring_state::at<io_uring_cqe>(ring.m_cqRing, params.cq_off.cqes);
+		}
+
+		message_queue::~message_queue()
+		{
+		}
+
+		void message_queue::add_handle(file_handle_t handle) {}
+		void message_queue::remove_handle(file_handle_t handle) {}
+
+		void message_queue::watch_handle(file_handle_t handle, void* cb, watch_type events)
+		{
+			// Operations without a native io_uring opcode are driven by a one-shot
+			// poll. The completion reports readiness and the operation then runs
+			// its m_completeFunc, just as with the epoll backend.
+			auto sqe = local::make_sqe(
+				IORING_OP_POLL_ADD, handle, local::make_user_data(cb, local::operation_tag));
+			switch (events)
+			{
+			case watch_type::readable:
+				sqe.poll32_events = EPOLLIN;
+				break;
+			case watch_type::writable:
+				sqe.poll32_events = EPOLLOUT;
+				break;
+			case watch_type::readablewritable:
+				sqe.poll32_events = EPOLLIN | EPOLLOUT;
+				break;
+			}
+
+			if (!m_ring->try_push(m_pollfd.fd(), sqe))
+			{
+				throw std::system_error{ EBUSY,
+										 std::system_category(),
+										 "message_queue: watch_handle failed" };
+			}
+		}
+
+		void message_queue::unwatch_handle(file_handle_t handle)
+		{
+			// Polls are one-shot so there is nothing left to remove once the
+			// operation has completed. Pending polls are removed by cancel_io().
+		}
+
+		bool message_queue::submit_io(const linux::io_uring_request& request, void* cb) noexcept
+		{
+			auto sqe = local::make_sqe(
+				request.opcode, request.fd, local::make_user_data(cb, local::operation_tag));
+			sqe.addr = reinterpret_cast<std::uintptr_t>(request.addr);
+			sqe.len = request.len;
+			sqe.off = request.off;
+			sqe.msg_flags = request.flags;
+			return m_ring->try_push(m_pollfd.fd(), sqe);
+		}
+
+		void message_queue::cancel_io(void* cb) noexcept
+		{
+			auto sqe = local::make_sqe(IORING_OP_ASYNC_CANCEL, -1, local::ignored_user_data);
+			sqe.addr = local::make_user_data(cb, local::operation_tag);
+
+			// Cancellation is best-effort. If the request cannot be queued then
+			// the operation simply runs to completion.
+			(void)m_ring->try_push(m_pollfd.fd(), sqe);
+		}
+
+		bool message_queue::enqueue_message(message msg)
+		{
+			std::uint64_t userData = 0;
+			switch (msg.type)
+			{
+			case message_type::CALLBACK_TYPE:
+				userData = local::make_user_data(msg.data, local::callback_tag);
+				break;
+			case message_type::RESUME_TYPE:
+				userData = local::make_user_data(msg.data, local::resume_tag);
+				break;
+			case message_type::WAKEUP_TYPE:
+				userData = local::wakeup_tag;
+				break;
+			}
+
+			return m_ring->try_push(m_pollfd.fd(), local::make_sqe(IORING_OP_NOP, -1, userData));
+		}
+
+		void message_queue::notify() noexcept
+		{
+			if (!m_notifyPending.exchange(true, std::memory_order_acq_rel) &&
+				!enqueue_message({ message_type::WAKEUP_TYPE, nullptr }))
+			{
+				m_notifyPending.store(false, std::memory_order_relaxed);
+			}
+		}
+
+		bool message_queue::try_pop_completion(message& msg)
+		{
+			auto& ring = *m_ring;
+			std::scoped_lock lock{ ring.m_cqMutex };
+
+			while (true)
+			{
+				const auto head = ring.m_cqHead->load(std::memory_order_relaxed);
+				if (head == ring.m_cqTail->load(std::memory_order_acquire))
+				{
+					return false;
+				}
+
+				const io_uring_cqe& cqe = ring.m_cqes[head & ring.m_cqMask];
+				const std::uint64_t userData = cqe.user_data;
+				const std::int32_t res = cqe.res;
+				ring.m_cqHead->store(head + 1, std::memory_order_release);
+
+				if (userData == local::ignored_user_data)
+				{
+					continue;
+				}
+
+				void* data = reinterpret_cast<void*>(
+					static_cast<std::uintptr_t>(userData & ~local::tag_mask));
+				switch (userData & local::tag_mask)
+				{
+				case local::operation_tag:
+					static_cast<async_operation_base*>(data)->m_res = res;
+					msg = { message_type::CALLBACK_TYPE, data };
+					break;
+				case local::callback_tag:
+					msg = { message_type::CALLBACK_TYPE, data };
+					break;
+				case local::resume_tag:
+					msg = { message_type::RESUME_TYPE, data };
+					break;
+				case local::wakeup_tag:
+					m_notifyPending.store(false, std::memory_order_release);
+					msg = { message_type::WAKEUP_TYPE, nullptr };
+					break;
+				}
+				return true;
+			}
+		}
+
+		bool message_queue::dequeue_message(message& msg, bool wait)
+		{
+			auto& ring = *m_ring;
+			while (true)
+			{
+				if (try_pop_completion(msg))
+				{
+					return true;
+				}
+
+				const bool overflowed =
+					(ring.m_sqFlags->load(std::memory_order_relaxed) & IORING_SQ_CQ_OVERFLOW) != 0;
+				if (!wait && !overflowed && ring.pending_count() == 0)
+				{
+					return false;
+				}
+
+				if (wait)
+				{
+					// Pairs with the fence in ring_state::try_push().
+					ring.m_waitingThreadCount.fetch_add(1, std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+				}
+
+				// Submit everything queued since the last call, including
+				// anything left by an earlier io_uring_enter() call that failed.
+				const int result = local::io_uring_enter(
+					m_pollfd.fd(), ring.pending_count(), wait ? 1 : 0, IORING_ENTER_GETEVENTS);
+				if (wait)
+				{
+					ring.m_waitingThreadCount.fetch_sub(1, std::memory_order_relaxed);
+				}
+				if (result == -1)
+				{
+					if (errno == EINTR)
+					{
+						return false;
+					}
+					if (errno != EAGAIN && errno != EBUSY)
+					{
+						throw std::system_error{ static_cast<int>(errno),
+												 std::system_category(),
+												 "Error in io_uring_enter run loop" };
+					}
+				}
+
+				if (!wait)
+				{
+					return try_pop_completion(msg);
+				}
+			}
+		}
+	}  // namespace detail
+}  // namespace cppcoro
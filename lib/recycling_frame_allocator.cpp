@@ -0,0 +1,106 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cppcoro/recycling_frame_allocator.hpp>
+
+#include <new>
+#include <utility>
+
+namespace cppcoro
+{
+	recycling_frame_allocator::recycling_frame_allocator() noexcept
+		: m_hitCount(0)
+		, m_missCount(0)
+	{
+	}
+
+	recycling_frame_allocator::~recycling_frame_allocator()
+	{
+		for (auto& sizeClass : m_sizeClasses)
+		{
+			free_all(sizeClass.m_freeList);
+			free_all(sizeClass.m_remoteFreeList.load(std::memory_order_acquire));
+		}
+	}
+
+	recycling_frame_allocator_stats recycling_frame_allocator::stats() const noexcept
+	{
+		recycling_frame_allocator_stats stats;
+		stats.hits = m_hitCount.load(std::memory_order_relaxed);
+		stats.misses = m_missCount.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	void* recycling_frame_allocator::allocate(std::size_t size)
+	{
+		if (m_owner == std::thread::id{})
+		{
+			// Frames only reach other threads after this, so they see the
+			// owner when they free them.
+			m_owner = std::this_thread::get_id();
+		}
+
+		if (size > max_recycled_size)
+		{
+			add(m_missCount);
+			return ::operator new(size);
+		}
+
+		auto& sizeClass = m_sizeClasses[size_class_index(size)];
+		free_block* block = sizeClass.m_freeList;
+		if (block == nullptr)
+		{
+			// Take over the frames other threads have freed. Only this
+			// thread removes from the remote list, and it removes the whole
+			// list at once, so pushes can't suffer from ABA.
+			block = sizeClass.m_remoteFreeList.exchange(nullptr, std::memory_order_acquire);
+			if (block == nullptr)
+			{
+				add(m_missCount);
+				return ::operator new((size_class_index(size) + 1) * size_class_granularity);
+			}
+		}
+
+		add(m_hitCount);
+		sizeClass.m_freeList = block->m_next;
+		return block;
+	}
+
+	void recycling_frame_allocator::deallocate(void* pointer, std::size_t size) noexcept
+	{
+		if (size > max_recycled_size)
+		{
+			::operator delete(pointer);
+			return;
+		}
+
+		auto& sizeClass = m_sizeClasses[size_class_index(size)];
+		auto* block = static_cast<free_block*>(pointer);
+		if (std::this_thread::get_id() == m_owner)
+		{
+			block->m_next = sizeClass.m_freeList;
+			sizeClass.m_freeList = block;
+		}
+		else
+		{
+			block->m_next = sizeClass.m_remoteFreeList.load(std::memory_order_relaxed);
+			while (!sizeClass.m_remoteFreeList.compare_exchange_weak(
+				block->m_next,
+				block,
+				std::memory_order_release,
+				std::memory_order_relaxed))
+			{
+			}
+		}
+	}
+
+	void recycling_frame_allocator::free_all(free_block* list) noexcept
+	{
+		while (list != nullptr)
+		{
+			::operator delete(std::exchange(list, list->m_next));
+		}
+	}
+}
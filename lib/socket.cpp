@@ -16,6 +16,7 @@
 
 #include <cppcoro/io_service.hpp>
 #include <cppcoro/on_scope_exit.hpp>
+#include <cppcoro/readable_file.hpp>
 
 #include "socket_helpers.hpp"
 
@@ -383,6 +384,30 @@ cppcoro::net::socket::send(const void* buffer, std::size_t byteCount, cancellati
 	return socket_send_operation_cancellable{ *this, buffer, byteCount, m_ioService, std::move(ct) };
 }
 
+cppcoro::net::socket_send_operation
+cppcoro::net::socket::send(const const_buffer* buffers, std::size_t bufferCount) noexcept
+{
+	return socket_send_operation{ *this, buffers, bufferCount, m_ioService };
+}
+
+cppcoro::net::socket_send_operation_cancellable
+cppcoro::net::socket::send(const const_buffer* buffers, std::size_t bufferCount, cancellation_token ct) noexcept
+{
+	return socket_send_operation_cancellable{ *this, buffers, bufferCount, m_ioService, std::move(ct) };
+}
+
+cppcoro::net::socket_send_file_operation
+cppcoro::net::socket::send_file(const readable_file& file, std::uint64_t offset, std::size_t byteCount) noexcept
+{
+	return socket_send_file_operation{ *this, file.native_handle(), offset, byteCount, m_ioService };
+}
+
+cppcoro::net::socket_send_file_operation_cancellable
+cppcoro::net::socket::send_file(const readable_file& file, std::uint64_t offset, std::size_t byteCount, cancellation_token ct) noexcept
+{
+	return socket_send_file_operation_cancellable{ *this, file.native_handle(), offset, byteCount, m_ioService, std::move(ct) };
+}
+
 cppcoro::net::socket_recv_operation
 cppcoro::net::socket::recv(void* buffer, std::size_t byteCount) noexcept
 {
@@ -395,6 +420,18 @@ cppcoro::net::socket::recv(void* buffer, std::size_t byteCount, cancellation_tok
 	return socket_recv_operation_cancellable{ *this, buffer, byteCount, m_ioService, std::move(ct) };
 }
 
+cppcoro::net::socket_recv_operation
+cppcoro::net::socket::recv(const mutable_buffer* buffers, std::size_t bufferCount) noexcept
+{
+	return socket_recv_operation{ *this, buffers, bufferCount, m_ioService };
+}
+
+cppcoro::net::socket_recv_operation_cancellable
+cppcoro::net::socket::recv(const mutable_buffer* buffers, std::size_t bufferCount, cancellation_token ct) noexcept
+{
+	return socket_recv_operation_cancellable{ *this, buffers, bufferCount, m_ioService, std::move(ct) };
+}
+
 cppcoro::net::socket_recv_from_operation
 cppcoro::net::socket::recv_from(void* buffer, std::size_t byteCount) noexcept
 {
@@ -419,6 +456,30 @@ cppcoro::net::socket::send_to(const ip_endpoint& destination, const void* buffer
 	return socket_send_to_operation_cancellable{ *this, destination, buffer, byteCount, m_ioService, std::move(ct) };
 }
 
+cppcoro::net::socket_recv_many_from_operation
+cppcoro::net::socket::recv_many_from(incoming_datagram* datagrams, std::size_t datagramCount) noexcept
+{
+	return socket_recv_many_from_operation{ *this, datagrams, datagramCount, m_ioService };
+}
+
+cppcoro::net::socket_recv_many_from_operation_cancellable
+cppcoro::net::socket::recv_many_from(incoming_datagram* datagrams, std::size_t datagramCount, cancellation_token ct) noexcept
+{
+	return socket_recv_many_from_operation_cancellable{ *this, datagrams, datagramCount, m_ioService, std::move(ct) };
+}
+
+cppcoro::net::socket_send_many_to_operation
+cppcoro::net::socket::send_many_to(const outgoing_datagram* datagrams, std::size_t datagramCount) noexcept
+{
+	return socket_send_many_to_operation{ *this, datagrams, datagramCount, m_ioService };
+}
+
+cppcoro::net::socket_send_many_to_operation_cancellable
+cppcoro::net::socket::send_many_to(const outgoing_datagram* datagrams, std::size_t datagramCount, cancellation_token ct) noexcept
+{
+	return socket_send_many_to_operation_cancellable{ *this, datagrams, datagramCount, m_ioService, std::move(ct) };
+}
+
 void cppcoro::net::socket::close_send()
 {
 	int result = ::shutdown(m_handle, SD_SEND);
@@ -448,6 +509,9 @@ void cppcoro::net::socket::close_recv()
 cppcoro::net::socket::socket(socket&& other) noexcept
 	: m_handle(std::exchange(other.m_handle, INVALID_SOCKET))
 	, m_ioService(std::move(other.m_ioService))
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+	, m_registration(std::exchange(other.m_registration, nullptr))
+#endif
 	, m_localEndPoint(std::move(other.m_localEndPoint))
 	, m_remoteEndPoint(std::move(other.m_remoteEndPoint))
 {}
@@ -455,10 +519,17 @@ cppcoro::net::socket::socket(socket&& other) noexcept
 cppcoro::net::socket&
 cppcoro::net::socket::operator=(socket&& other) noexcept
 {
-	m_handle = std::exchange(other.m_handle, INVALID_SOCKET);
-	m_ioService = std::move(other.m_ioService);
-	m_localEndPoint = std::move(other.m_localEndPoint);
-	m_remoteEndPoint = std::move(other.m_remoteEndPoint);
+	if (this != &other)
+	{
+		close();
+		m_handle = std::exchange(other.m_handle, INVALID_SOCKET);
+		m_ioService = std::move(other.m_ioService);
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+		m_registration = std::exchange(other.m_registration, nullptr);
+#endif
+		m_localEndPoint = std::move(other.m_localEndPoint);
+		m_remoteEndPoint = std::move(other.m_remoteEndPoint);
+	}
 
 	return *this;
 }
@@ -474,19 +545,19 @@ cppcoro::detail::socket_handle_t duplicate_socket(const cppcoro::detail::socket_
 }
 
 cppcoro::net::socket::socket(const socket& other) noexcept
-	: m_handle(duplicate_socket(other.m_handle))
-	, m_ioService(other.m_ioService)
-	, m_localEndPoint(other.m_localEndPoint)
-	, m_remoteEndPoint(other.m_remoteEndPoint)
-{}
+	: socket(duplicate_socket(other.m_handle), other.m_ioService)
+{
+	m_localEndPoint = other.m_localEndPoint;
+	m_remoteEndPoint = other.m_remoteEndPoint;
+}
 
 cppcoro::net::socket&
 cppcoro::net::socket::operator=(const socket& other) noexcept
 {
-	m_handle = duplicate_socket(other.m_handle);
-	m_ioService = other.m_ioService;
-	m_localEndPoint = other.m_localEndPoint;
-	m_remoteEndPoint = other.m_remoteEndPoint;
+	if (this != &other)
+	{
+		*this = socket(other);
+	}
 
 	return *this;
 }
@@ -500,6 +571,13 @@ int cppcoro::net::socket::close()
 {
 	if (m_handle != INVALID_SOCKET)
 	{
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+		if (m_registration != nullptr)
+		{
+			m_ioService->get_io_context().deregister_handle(
+				std::exchange(m_registration, nullptr));
+		}
+#endif
 		int res = ::closesocket(m_handle);
 		m_handle = INVALID_SOCKET;
 		return res;
@@ -512,5 +590,49 @@ cppcoro::net::socket::socket(
 	cppcoro::io_service* ioService) noexcept
 	: m_handle(handle)
 	, m_ioService(ioService)
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+	, m_registration(
+		handle != INVALID_SOCKET && ioService != nullptr ?
+			ioService->get_io_context().register_handle(handle) : nullptr)
+#endif
 {
 }
+
+#if CPPCORO_OS_LINUX || CPPCORO_OS_DARWIN
+void cppcoro::net::socket::rebind(cppcoro::io_service& ioSvc) noexcept
+{
+	if (&ioSvc == m_ioService)
+	{
+		return;
+	}
+
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+	if (m_registration != nullptr)
+	{
+		m_ioService->get_io_context().deregister_handle(
+			std::exchange(m_registration, nullptr));
+	}
+	if (m_handle != INVALID_SOCKET)
+	{
+		m_registration = ioSvc.get_io_context().register_handle(m_handle);
+	}
+#endif
+	m_ioService = &ioSvc;
+}
+
+void cppcoro::net::socket::watch(
+	cppcoro::detail::async_operation_base& operation,
+	cppcoro::detail::watch_type events)
+{
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+	if (m_registration != nullptr)
+	{
+		m_ioService->get_io_context().watch_handle(
+			*m_registration, static_cast<void*>(&operation), events);
+		return;
+	}
+#endif
+	m_ioService->get_io_context().watch_handle(
+		m_handle, static_cast<void*>(&operation), events);
+}
+#endif
@@ -132,6 +132,10 @@ void cppcoro::net::socket_accept_operation_impl::get_result(
 # include <netinet/in.h>
 # include <netinet/tcp.h>
 # include <netinet/udp.h>
+# if CPPCORO_USE_IO_URING
+#  include <linux/io_uring.h>
+# endif
+
 bool cppcoro::net::socket_accept_operation_impl::try_start(
 	cppcoro::detail::async_operation_base& operation) noexcept
 {
@@ -141,12 +145,32 @@ bool cppcoro::net::socket_accept_operation_impl::try_start(
 		(sizeof(m_addressBuffer) / 2) >= (16 + sizeof(sockaddr_in6)),
 		"AcceptEx requires address buffer to be at least 16 bytes more than largest address.");
 
+#if CPPCORO_USE_IO_URING
+	static_assert(sizeof(m_addressLength) == sizeof(socklen_t));
+	m_addressLength = sizeof(m_addressBuffer) / 2;
+	// Accepted sockets are non-blocking like those we create, so that
+	// operations that try the syscall before waiting never block.
+	return operation.try_submit({
+		IORING_OP_ACCEPT,
+		m_listeningSocket.native_handle(),
+		m_addressBuffer,
+		0,
+		reinterpret_cast<std::uintptr_t>(&m_addressLength),
+		SOCK_NONBLOCK });
+#else
 	operation.m_completeFunc = [&]() {
 		socklen_t len = sizeof(m_addressBuffer) / 2;
+#if CPPCORO_OS_LINUX
+		// The accepted socket is registered edge-triggered, which requires
+		// it to be non-blocking.
+		return accept4(m_listeningSocket.native_handle(), reinterpret_cast<sockaddr*>(m_addressBuffer), &len, SOCK_NONBLOCK);
+#else
 		return accept(m_listeningSocket.native_handle(), reinterpret_cast<sockaddr*>(m_addressBuffer), &len);
+#endif
 	};
-	operation.m_ioService->get_io_context().watch_handle(m_listeningSocket.native_handle(), reinterpret_cast<void*>(&operation), cppcoro::detail::watch_type::readable);
+	m_listeningSocket.watch(operation, cppcoro::detail::watch_type::readable);
 	return true;
+#endif
 }
 
 void cppcoro::net::socket_accept_operation_impl::get_result(
@@ -208,9 +208,9 @@ bool cppcoro::net::socket_connect_operation_impl::try_start(
 #endif
 	};
 #if CPPCORO_OS_LINUX
-	operation.m_ioService->get_io_context().watch_handle(m_socket.native_handle(), reinterpret_cast<void*>(&operation), cppcoro::detail::watch_type::writable);
+	m_socket.watch(operation, cppcoro::detail::watch_type::writable);
 #elif CPPCORO_OS_DARWIN
-	operation.m_ioService->get_io_context().watch_handle(m_socket.native_handle(), reinterpret_cast<void*>(&operation), cppcoro::detail::watch_type::readablewritable);
+	m_socket.watch(operation, cppcoro::detail::watch_type::readablewritable);
 #endif
 	return true;
 }
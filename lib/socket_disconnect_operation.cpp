@@ -112,10 +112,19 @@ bool cppcoro::net::socket_disconnect_operation_impl::try_start(
 	cppcoro::detail::async_operation_base& operation) noexcept
 {
 	operation.m_fd = m_socket.native_handle();
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+	if (m_socket.m_registration != nullptr)
+	{
+		// Closing never waits for readiness, and close() must deregister
+		// the socket before the handle goes away, so complete synchronously.
+		operation.m_res = m_socket.close() < 0 ? -errno : 0;
+		return false;
+	}
+#endif
 	operation.m_completeFunc = [&]() {
 		return m_socket.close();
 	};
-	operation.m_ioService->get_io_context().watch_handle(m_socket.native_handle(), reinterpret_cast<void*>(&operation), cppcoro::detail::watch_type::writable);
+	m_socket.watch(operation, cppcoro::detail::watch_type::writable);
 	return true;
 }
 
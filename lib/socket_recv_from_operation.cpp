@@ -140,10 +140,7 @@ bool cppcoro::net::socket_recv_from_operation_impl::try_start(
 #endif
 		return res;
 	};
-	operation.m_ioService->get_io_context().watch_handle(
-		m_socket.native_handle(),
-		reinterpret_cast<void*>(&operation),
-		cppcoro::detail::watch_type::readable);
+	m_socket.watch(operation, cppcoro::detail::watch_type::readable);
 	return true;
 }
 
@@ -0,0 +1,265 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#include <system_error>
+
+#include <cppcoro/net/socket_recv_many_from_operation.hpp>
+#include <cppcoro/net/socket.hpp>
+#include <cppcoro/io_service.hpp>
+
+#include "socket_helpers.hpp"
+
+#if CPPCORO_OS_WINNT
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <winsock2.h>
+# include <ws2tcpip.h>
+# include <windows.h>
+
+// Winsock has no batched receive, so each operation fills at most one slot.
+bool cppcoro::net::socket_recv_many_from_operation_impl::try_start(
+	cppcoro::detail::async_operation_base& operation) noexcept
+{
+	operation.m_handle = reinterpret_cast<HANDLE>(m_socket.native_handle());
+	static_assert(
+		sizeof(m_sourceSockaddrStorage) >= sizeof(SOCKADDR_IN) &&
+		sizeof(m_sourceSockaddrStorage) >= sizeof(SOCKADDR_IN6));
+	static_assert(
+		sockaddrStorageAlignment >= alignof(SOCKADDR_IN) &&
+		sockaddrStorageAlignment >= alignof(SOCKADDR_IN6));
+
+	if (m_datagramCount == 0)
+	{
+		operation.m_errorCode = ERROR_SUCCESS;
+		operation.m_numberOfBytesTransferred = 0;
+		return false;
+	}
+
+	m_sourceSockaddrLength = sizeof(m_sourceSockaddrStorage);
+
+	DWORD numberOfBytesReceived = 0;
+	DWORD flags = 0;
+	int result = ::WSARecvFrom(
+		m_socket.native_handle(),
+		reinterpret_cast<WSABUF*>(&m_datagrams[0].buffer),
+		1, // buffer count
+		&numberOfBytesReceived,
+		&flags,
+		reinterpret_cast<sockaddr*>(&m_sourceSockaddrStorage),
+		&m_sourceSockaddrLength,
+		operation.get_overlapped(),
+		nullptr);
+	if (result == SOCKET_ERROR)
+	{
+		int errorCode = ::WSAGetLastError();
+		if (errorCode != WSA_IO_PENDING)
+		{
+			// Failed synchronously.
+			operation.m_errorCode = static_cast<DWORD>(errorCode);
+			operation.m_numberOfBytesTransferred = numberOfBytesReceived;
+			return false;
+		}
+	}
+	operation.m_completeFunc = [&]() {
+		cppcoro::detail::win32::dword_t numberOfBytesTransferred = 0;
+		cppcoro::detail::win32::dword_t flags = 0;
+		cppcoro::detail::win32::bool_t ok = WSAGetOverlappedResult(
+			m_socket.native_handle(),
+			operation.get_overlapped(),
+			&numberOfBytesTransferred,
+			0,
+			&flags
+		);
+		if (ok) {
+			return std::make_tuple(static_cast<cppcoro::detail::win32::dword_t>(ERROR_SUCCESS), numberOfBytesTransferred);
+		} else {
+			return std::make_tuple(static_cast<cppcoro::detail::win32::dword_t>(WSAGetLastError()), numberOfBytesTransferred);
+		}
+	};
+
+	// Operation will complete asynchronously.
+	return true;
+}
+
+std::size_t cppcoro::net::socket_recv_many_from_operation_impl::get_result(
+	cppcoro::detail::async_operation_base& operation)
+{
+	if (operation.m_errorCode != ERROR_SUCCESS)
+	{
+		throw std::system_error(
+			static_cast<int>(operation.m_errorCode),
+			std::system_category(),
+			"Error receiving messages on socket: WSARecvFrom");
+	}
+
+	if (m_datagramCount == 0)
+	{
+		return 0;
+	}
+
+	m_datagrams[0].size = operation.m_numberOfBytesTransferred;
+	m_datagrams[0].source = detail::sockaddr_to_ip_endpoint(
+		*reinterpret_cast<SOCKADDR*>(&m_sourceSockaddrStorage));
+	return 1;
+}
+
+#elif CPPCORO_OS_LINUX || CPPCORO_OS_DARWIN
+# include <sys/socket.h>
+# include <sys/uio.h>
+# include <netinet/in.h>
+# include <algorithm>
+# include <climits>
+# include <cerrno>
+
+namespace
+{
+	namespace local
+	{
+		// The number of datagrams received per recvmmsg() call. The message
+		// headers and addresses for a batch live on the stack.
+		constexpr std::size_t batch_size = 64;
+
+		// Receive datagrams into as many slots as possible without blocking.
+		//
+		// Returns the number of slots filled, or -1 with errno set if none
+		// could be.
+		int recv_many(
+			int fd,
+			cppcoro::net::incoming_datagram* datagrams,
+			std::size_t datagramCount,
+			int flags) noexcept
+		{
+			datagramCount = std::min<std::size_t>(datagramCount, INT_MAX);
+
+			std::size_t total = 0;
+			while (total < datagramCount)
+			{
+				const std::size_t batchCount = std::min(datagramCount - total, batch_size);
+				::sockaddr_storage addresses[batch_size];
+#if CPPCORO_OS_LINUX
+				::mmsghdr messages[batch_size];
+				for (std::size_t i = 0; i < batchCount; ++i)
+				{
+					auto& header = messages[i].msg_hdr;
+					header = ::msghdr{};
+					header.msg_name = &addresses[i];
+					header.msg_namelen = sizeof(addresses[i]);
+					// The buffer has the layout of an iovec.
+					header.msg_iov = reinterpret_cast<::iovec*>(&datagrams[total + i].buffer);
+					header.msg_iovlen = 1;
+					messages[i].msg_len = 0;
+				}
+
+				// MSG_TRUNC makes msg_len the full size of a truncated datagram.
+				const int result = ::recvmmsg(
+					fd, messages, static_cast<unsigned>(batchCount), flags | MSG_TRUNC, nullptr);
+#else
+				// No recvmmsg(); receive one datagram per call until the socket
+				// runs dry.
+				std::size_t sizes[batch_size];
+				int result = 0;
+				while (static_cast<std::size_t>(result) < batchCount)
+				{
+					auto& datagram = datagrams[total + result];
+					socklen_t addressLength = sizeof(addresses[result]);
+					const auto size = ::recvfrom(
+						fd,
+						datagram.buffer.data(),
+						datagram.buffer.size(),
+						flags | MSG_DONTWAIT,
+						reinterpret_cast<sockaddr*>(&addresses[result]),
+						&addressLength);
+					if (size < 0)
+					{
+						break;
+					}
+					sizes[result++] = static_cast<std::size_t>(size);
+				}
+				if (result == 0)
+				{
+					result = -1;
+				}
+#endif
+				if (result < 0)
+				{
+					// Keep the datagrams already received; the error will be
+					// reported again by the next call.
+					return total > 0 ? static_cast<int>(total) : -1;
+				}
+
+				for (int i = 0; i < result; ++i)
+				{
+					auto& datagram = datagrams[total + i];
+#if CPPCORO_OS_LINUX
+					datagram.size = messages[i].msg_len;
+#else
+					datagram.size = sizes[i];
+#endif
+					datagram.source = cppcoro::net::detail::sockaddr_to_ip_endpoint(
+						*reinterpret_cast<const sockaddr*>(&addresses[i]));
+				}
+
+				total += static_cast<std::size_t>(result);
+				if (static_cast<std::size_t>(result) < batchCount)
+				{
+					break;
+				}
+			}
+
+			return static_cast<int>(total);
+		}
+	}
+}
+
+bool cppcoro::net::socket_recv_many_from_operation_impl::try_start(
+	cppcoro::detail::async_operation_base& operation) noexcept
+{
+	operation.m_fd = m_socket.native_handle();
+	if (m_datagramCount == 0)
+	{
+		operation.m_res = 0;
+		return false;
+	}
+
+#if CPPCORO_OS_LINUX
+	// Try the receive first in case datagrams are already queued.
+	if (operation.m_ioService->try_complete_inline())
+	{
+		const int result = local::recv_many(
+			m_socket.native_handle(), m_datagrams, m_datagramCount, MSG_DONTWAIT);
+		if (result >= 0)
+		{
+			operation.m_res = result;
+			return false;
+		}
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+		{
+			operation.m_res = -errno;
+			return false;
+		}
+	}
+#endif
+
+	operation.m_completeFunc = [&]() {
+		return local::recv_many(m_socket.native_handle(), m_datagrams, m_datagramCount, 0);
+	};
+	m_socket.watch(operation, cppcoro::detail::watch_type::readable);
+	return true;
+}
+
+std::size_t cppcoro::net::socket_recv_many_from_operation_impl::get_result(
+	cppcoro::detail::async_operation_base& operation)
+{
+	if (operation.m_res < 0)
+	{
+		throw std::system_error(
+			static_cast<int>(-operation.m_res),
+			std::system_category(),
+			"Error receiving messages on socket: recvmmsg");
+	}
+
+	return static_cast<std::size_t>(operation.m_res);
+}
+#endif
@@ -0,0 +1,309 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cppcoro/net/socket_send_file_operation.hpp>
+#include <cppcoro/net/socket.hpp>
+#include <cppcoro/io_service.hpp>
+
+#if CPPCORO_OS_WINNT
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <winsock2.h>
+# include <mswsock.h>
+# include <windows.h>
+
+bool cppcoro::net::socket_send_file_operation_impl::try_start(
+	cppcoro::detail::async_operation_base& operation) noexcept
+{
+	operation.m_handle = reinterpret_cast<HANDLE>(m_socket.native_handle());
+	if (m_byteCount == 0)
+	{
+		// TransmitFile() would send the whole file.
+		operation.m_errorCode = ERROR_SUCCESS;
+		operation.m_numberOfBytesTransferred = 0;
+		return false;
+	}
+
+	// TransmitFile() is limited to 2^31 - 2 bytes per call.
+	const DWORD numberOfBytesToWrite =
+		m_byteCount <= 0x7FFFFFFE ?
+		static_cast<DWORD>(m_byteCount) : DWORD(0x7FFFFFFE);
+
+	operation.get_overlapped()->Offset = static_cast<cppcoro::detail::win32::dword_t>(m_offset);
+	operation.get_overlapped()->OffsetHigh = static_cast<cppcoro::detail::win32::dword_t>(m_offset >> 32);
+	BOOL ok = ::TransmitFile(
+		m_socket.native_handle(),
+		m_fileHandle,
+		numberOfBytesToWrite,
+		0, // default bytes per send
+		operation.get_overlapped(),
+		nullptr, // no head/tail buffers
+		0); // flags
+	if (!ok)
+	{
+		int errorCode = ::WSAGetLastError();
+		if (errorCode != WSA_IO_PENDING && errorCode != ERROR_IO_PENDING)
+		{
+			// Failed synchronously.
+			operation.m_errorCode = static_cast<DWORD>(errorCode);
+			operation.m_numberOfBytesTransferred = 0;
+			return false;
+		}
+	}
+	operation.m_completeFunc = [&]() {
+		cppcoro::detail::win32::dword_t numberOfBytesTransferred = 0;
+		cppcoro::detail::win32::dword_t flags = 0;
+		cppcoro::detail::win32::bool_t ok = WSAGetOverlappedResult(
+			m_socket.native_handle(),
+			operation.get_overlapped(),
+			&numberOfBytesTransferred,
+			0,
+			&flags
+		);
+		if (ok) {
+			return std::make_tuple(static_cast<cppcoro::detail::win32::dword_t>(ERROR_SUCCESS), numberOfBytesTransferred);
+		} else {
+			return std::make_tuple(static_cast<cppcoro::detail::win32::dword_t>(WSAGetLastError()), numberOfBytesTransferred);
+		}
+	};
+
+	// Operation will complete asynchronously.
+	return true;
+}
+
+#elif CPPCORO_OS_LINUX || CPPCORO_OS_DARWIN
+# include <sys/types.h>
+# include <sys/socket.h>
+# include <sys/uio.h>
+# if CPPCORO_OS_LINUX
+#  include <poll.h>
+#  include <sys/sendfile.h>
+# endif
+# include <algorithm>
+# include <cerrno>
+
+namespace
+{
+	namespace local
+	{
+		// The most Linux's sendfile() will transfer in one call, which also
+		// keeps the result of an operation within an int.
+		constexpr std::size_t max_send_file_size = 0x7FFFF000;
+
+		// Send as much of the file range as the socket accepts without
+		// blocking.
+		//
+		// Returns the number of bytes sent, which is less than byteCount if
+		// the socket would block or the file ended, or -1 with errno set if
+		// nothing could be sent.
+		int send_file(
+			int socketFd,
+			int fileFd,
+			std::uint64_t offset,
+			std::size_t byteCount) noexcept
+		{
+			byteCount = std::min(byteCount, max_send_file_size);
+
+			std::size_t total = 0;
+			while (total < byteCount)
+			{
+#if CPPCORO_OS_LINUX
+				// Pass our own offset so the file's position is not used or
+				// changed.
+				::off_t fileOffset = static_cast<::off_t>(offset + total);
+				const auto result = ::sendfile(socketFd, fileFd, &fileOffset, byteCount - total);
+				if (result < 0)
+				{
+					// Report the progress made; the error will be reported
+					// again by the next call.
+					return total > 0 ? static_cast<int>(total) : -1;
+				}
+
+				if (result == 0)
+				{
+					// End of file.
+					break;
+				}
+
+				total += static_cast<std::size_t>(result);
+#else
+				// Darwin's sendfile() reports partial progress through
+				// length even when it fails with EAGAIN.
+				::off_t length = static_cast<::off_t>(byteCount - total);
+				const int result = ::sendfile(
+					fileFd, socketFd, static_cast<::off_t>(offset + total), &length, nullptr, 0);
+				total += static_cast<std::size_t>(length);
+				if (result < 0)
+				{
+					return total > 0 ? static_cast<int>(total) : -1;
+				}
+
+				if (length == 0)
+				{
+					// End of file.
+					break;
+				}
+#endif
+			}
+
+			return static_cast<int>(total);
+		}
+
+#if CPPCORO_OS_LINUX
+		// Complete the operation without waiting if there is nothing to
+		// send or the socket has room for some of it.
+		//
+		// Returns false, leaving the operation untouched, if it must wait for
+		// the socket.
+		bool try_send_file_now(
+			cppcoro::detail::async_operation_base& operation,
+			int fileFd,
+			std::uint64_t offset,
+			std::size_t byteCount) noexcept
+		{
+			if (byteCount == 0)
+			{
+				operation.m_res = 0;
+				return true;
+			}
+
+			if (!operation.m_ioService->try_complete_inline())
+			{
+				return false;
+			}
+
+			const int result = send_file(operation.m_fd, fileFd, offset, byteCount);
+			if (result >= 0)
+			{
+				operation.m_res = result;
+				return true;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				operation.m_res = -errno;
+				return true;
+			}
+
+			return false;
+		}
+#endif
+
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+		// Returns 0 if the socket has room to send, or -1 with errno set to
+		// EAGAIN if it does not. Does no I/O, so it is safe to run on the
+		// event loop thread.
+		//
+		// A registration may report the socket ready because an earlier
+		// operation succeeded without draining it, so check before handing
+		// the send to a blocking I/O thread.
+		int poll_writable(int socketFd) noexcept
+		{
+			::pollfd pollFd{ socketFd, POLLOUT, 0 };
+			const int result = ::poll(&pollFd, 1, 0);
+			if (result == 0)
+			{
+				errno = EAGAIN;
+				return -1;
+			}
+
+			return result < 0 ? -1 : 0;
+		}
+#endif
+	}
+}
+
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+bool cppcoro::net::socket_send_file_operation_impl::try_start(
+	cppcoro::detail::async_operation_base& operation,
+	callback_type* onSocketReady) noexcept
+{
+	operation.m_fd = m_socket.native_handle();
+	if (local::try_send_file_now(operation, m_fileHandle, m_offset, m_byteCount))
+	{
+		return false;
+	}
+
+	// Only wait for room on the event loop thread. The send itself happens
+	// in on_socket_ready() on a blocking I/O thread.
+	m_completionCallback = operation.m_callback;
+	operation.m_callback = onSocketReady;
+	operation.m_completeFunc = [&]() {
+		return local::poll_writable(m_socket.native_handle());
+	};
+	m_socket.watch(operation, cppcoro::detail::watch_type::writable);
+	return true;
+}
+
+void cppcoro::net::socket_send_file_operation_impl::on_socket_ready(
+	cppcoro::detail::async_operation_base& operation) noexcept
+{
+	m_offloaded.store(true, std::memory_order_release);
+	operation.m_callback = m_completionCallback;
+
+	// Collect the result of the wait, unless it was cancelled.
+	if (operation.m_res >= 0)
+	{
+		operation.on_operation_completed_base();
+	}
+
+	if (operation.m_res >= 0)
+	{
+		operation.m_completeFunc = [&]() {
+			return local::send_file(m_socket.native_handle(), m_fileHandle, m_offset, m_byteCount);
+		};
+		if (operation.m_ioService->get_io_context().submit_blocking(&operation))
+		{
+			return;
+		}
+
+		// Couldn't offload it, so do it here.
+		const int result = operation.m_completeFunc();
+		operation.m_res = result < 0 ? -errno : result;
+	}
+
+	// m_res now holds the final result.
+	operation.m_completeFunc = nullptr;
+	operation.m_callback(&operation);
+}
+
+void cppcoro::net::socket_send_file_operation_impl::cancel(
+	cppcoro::detail::async_operation_base& operation) noexcept
+{
+	if (m_offloaded.load(std::memory_order_acquire))
+	{
+		operation.m_ioService->get_io_context().cancel_blocking(&operation);
+	}
+	else
+	{
+		operation.cancel();
+	}
+}
+#else
+bool cppcoro::net::socket_send_file_operation_impl::try_start(
+	cppcoro::detail::async_operation_base& operation) noexcept
+{
+	operation.m_fd = m_socket.native_handle();
+#if CPPCORO_OS_LINUX
+	if (local::try_send_file_now(operation, m_fileHandle, m_offset, m_byteCount))
+	{
+		return false;
+	}
+#else
+	if (m_byteCount == 0)
+	{
+		operation.m_res = 0;
+		return false;
+	}
+#endif
+
+	operation.m_completeFunc = [&]() {
+		return local::send_file(m_socket.native_handle(), m_fileHandle, m_offset, m_byteCount);
+	};
+	m_socket.watch(operation, cppcoro::detail::watch_type::writable);
+	return true;
+}
+#endif
+#endif
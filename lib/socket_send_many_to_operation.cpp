@@ -0,0 +1,239 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+#include <system_error>
+
+#include <cppcoro/net/socket_send_many_to_operation.hpp>
+#include <cppcoro/net/socket.hpp>
+#include <cppcoro/io_service.hpp>
+
+#include "socket_helpers.hpp"
+
+#if CPPCORO_OS_WINNT
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <winsock2.h>
+# include <windows.h>
+
+// Winsock has no batched send, so each operation sends at most one datagram.
+bool cppcoro::net::socket_send_many_to_operation_impl::try_start(
+	cppcoro::detail::async_operation_base& operation) noexcept
+{
+	operation.m_handle = reinterpret_cast<HANDLE>(m_socket.native_handle());
+	if (m_datagramCount == 0)
+	{
+		operation.m_errorCode = ERROR_SUCCESS;
+		operation.m_numberOfBytesTransferred = 0;
+		return false;
+	}
+
+	SOCKADDR_STORAGE destinationAddress;
+	const int destinationLength = detail::ip_endpoint_to_sockaddr(
+		m_datagrams[0].destination, std::ref(destinationAddress));
+
+	DWORD numberOfBytesSent = 0;
+	int result = ::WSASendTo(
+		m_socket.native_handle(),
+		reinterpret_cast<WSABUF*>(const_cast<const_buffer*>(&m_datagrams[0].buffer)),
+		1, // buffer count
+		&numberOfBytesSent,
+		0, // flags
+		reinterpret_cast<const SOCKADDR*>(&destinationAddress),
+		destinationLength,
+		operation.get_overlapped(),
+		nullptr);
+	if (result == SOCKET_ERROR)
+	{
+		int errorCode = ::WSAGetLastError();
+		if (errorCode != WSA_IO_PENDING)
+		{
+			// Failed synchronously.
+			operation.m_errorCode = static_cast<DWORD>(errorCode);
+			operation.m_numberOfBytesTransferred = numberOfBytesSent;
+			return false;
+		}
+	}
+	operation.m_completeFunc = [&]() {
+		cppcoro::detail::win32::dword_t numberOfBytesTransferred = 0;
+		cppcoro::detail::win32::dword_t flags = 0;
+		cppcoro::detail::win32::bool_t ok = WSAGetOverlappedResult(
+			m_socket.native_handle(),
+			operation.get_overlapped(),
+			&numberOfBytesTransferred,
+			0,
+			&flags
+		);
+		if (ok) {
+			return std::make_tuple(static_cast<cppcoro::detail::win32::dword_t>(ERROR_SUCCESS), numberOfBytesTransferred);
+		} else {
+			return std::make_tuple(static_cast<cppcoro::detail::win32::dword_t>(WSAGetLastError()), numberOfBytesTransferred);
+		}
+	};
+
+	// Operation will complete asynchronously.
+	return true;
+}
+
+std::size_t cppcoro::net::socket_send_many_to_operation_impl::get_result(
+	cppcoro::detail::async_operation_base& operation)
+{
+	if (operation.m_errorCode != ERROR_SUCCESS)
+	{
+		throw std::system_error(
+			static_cast<int>(operation.m_errorCode),
+			std::system_category(),
+			"Error sending messages on socket: WSASendTo");
+	}
+
+	return m_datagramCount == 0 ? 0 : 1;
+}
+
+#elif CPPCORO_OS_LINUX || CPPCORO_OS_DARWIN
+# include <sys/socket.h>
+# include <sys/uio.h>
+# include <netinet/in.h>
+# include <algorithm>
+# include <climits>
+# include <cerrno>
+
+namespace
+{
+	namespace local
+	{
+		// The number of datagrams sent per sendmmsg() call. The message
+		// headers and addresses for a batch live on the stack.
+		constexpr std::size_t batch_size = 64;
+
+		// Send as many datagrams as possible without blocking.
+		//
+		// Returns the number of datagrams sent, or -1 with errno set if none
+		// could be.
+		int send_many(
+			int fd,
+			const cppcoro::net::outgoing_datagram* datagrams,
+			std::size_t datagramCount,
+			int flags) noexcept
+		{
+			datagramCount = std::min<std::size_t>(datagramCount, INT_MAX);
+
+			std::size_t total = 0;
+			while (total < datagramCount)
+			{
+				const std::size_t batchCount = std::min(datagramCount - total, batch_size);
+				::sockaddr_storage addresses[batch_size];
+#if CPPCORO_OS_LINUX
+				::mmsghdr messages[batch_size];
+				for (std::size_t i = 0; i < batchCount; ++i)
+				{
+					const auto& datagram = datagrams[total + i];
+					auto& header = messages[i].msg_hdr;
+					header = ::msghdr{};
+					header.msg_name = &addresses[i];
+					header.msg_namelen = cppcoro::net::detail::ip_endpoint_to_sockaddr(
+						datagram.destination, std::ref(addresses[i]));
+					// The buffer has the layout of an iovec.
+					header.msg_iov = reinterpret_cast<::iovec*>(
+						const_cast<cppcoro::net::const_buffer*>(&datagram.buffer));
+					header.msg_iovlen = 1;
+					messages[i].msg_len = 0;
+				}
+
+				const int result = ::sendmmsg(
+					fd, messages, static_cast<unsigned>(batchCount), flags);
+#else
+				// No sendmmsg(); send one datagram per call until the socket
+				// would block.
+				int result = 0;
+				while (static_cast<std::size_t>(result) < batchCount)
+				{
+					const auto& datagram = datagrams[total + result];
+					const socklen_t addressLength = cppcoro::net::detail::ip_endpoint_to_sockaddr(
+						datagram.destination, std::ref(addresses[0]));
+					if (::sendto(
+							fd,
+							datagram.buffer.data(),
+							datagram.buffer.size(),
+							flags | MSG_DONTWAIT,
+							reinterpret_cast<const sockaddr*>(&addresses[0]),
+							addressLength) < 0)
+					{
+						break;
+					}
+					++result;
+				}
+				if (result == 0)
+				{
+					result = -1;
+				}
+#endif
+				if (result < 0)
+				{
+					// Keep the datagrams already sent; the error will be
+					// reported again by the next call.
+					return total > 0 ? static_cast<int>(total) : -1;
+				}
+
+				total += static_cast<std::size_t>(result);
+				if (static_cast<std::size_t>(result) < batchCount)
+				{
+					break;
+				}
+			}
+
+			return static_cast<int>(total);
+		}
+	}
+}
+
+bool cppcoro::net::socket_send_many_to_operation_impl::try_start(
+	cppcoro::detail::async_operation_base& operation) noexcept
+{
+	operation.m_fd = m_socket.native_handle();
+	if (m_datagramCount == 0)
+	{
+		operation.m_res = 0;
+		return false;
+	}
+
+#if CPPCORO_OS_LINUX
+	// Try the send first; a UDP socket rarely has a full send buffer.
+	if (operation.m_ioService->try_complete_inline())
+	{
+		const int result = local::send_many(
+			m_socket.native_handle(), m_datagrams, m_datagramCount, MSG_DONTWAIT);
+		if (result >= 0)
+		{
+			operation.m_res = result;
+			return false;
+		}
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+		{
+			operation.m_res = -errno;
+			return false;
+		}
+	}
+#endif
+
+	operation.m_completeFunc = [&]() {
+		return local::send_many(m_socket.native_handle(), m_datagrams, m_datagramCount, 0);
+	};
+	m_socket.watch(operation, cppcoro::detail::watch_type::writable);
+	return true;
+}
+
+std::size_t cppcoro::net::socket_send_many_to_operation_impl::get_result(
+	cppcoro::detail::async_operation_base& operation)
+{
+	if (operation.m_res < 0)
+	{
+		throw std::system_error(
+			static_cast<int>(-operation.m_res),
+			std::system_category(),
+			"Error sending messages on socket: sendmmsg");
+	}
+
+	return static_cast<std::size_t>(operation.m_res);
+}
+#endif
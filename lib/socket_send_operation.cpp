@@ -18,11 +18,17 @@ bool cppcoro::net::socket_send_operation_impl::try_start(
 	cppcoro::detail::async_operation_base& operation) noexcept
 {
 	operation.m_handle = reinterpret_cast<HANDLE>(m_socket.native_handle());
+	// The buffers of a scatter/gather operation have the layout of a WSABUF
+	// array and are passed straight through.
+	WSABUF* buffers = m_buffers != nullptr ?
+		reinterpret_cast<WSABUF*>(const_cast<const_buffer*>(m_buffers)) :
+		reinterpret_cast<WSABUF*>(&m_buffer);
+	const DWORD bufferCount = m_buffers != nullptr ? static_cast<DWORD>(m_bufferCount) : DWORD(1);
 	DWORD numberOfBytesSent = 0;
 	int result = ::WSASend(
 		m_socket.native_handle(),
-		reinterpret_cast<WSABUF*>(&m_buffer),
-		1, // buffer count
+		buffers,
+		bufferCount,
 		&numberOfBytesSent,
 		0, // flags
 		operation.get_overlapped(),
@@ -64,15 +70,90 @@ bool cppcoro::net::socket_send_operation_impl::try_start(
 # include <netinet/in.h>
 # include <netinet/tcp.h>
 # include <netinet/udp.h>
+# if CPPCORO_USE_IO_URING
+#  include <linux/io_uring.h>
+# endif
+# include <sys/uio.h>
+
+static_assert(sizeof(cppcoro::net::const_buffer) == sizeof(::iovec));
+
+namespace
+{
+	namespace local
+	{
+		ssize_t send(
+			int fd,
+			const void* buffer,
+			std::size_t byteCount,
+			const cppcoro::net::const_buffer* buffers,
+			std::size_t bufferCount,
+			int flags) noexcept
+		{
+			if (buffers == nullptr)
+			{
+				return ::send(fd, buffer, byteCount, flags);
+			}
+
+			// The buffers have the layout of an iovec array.
+			::msghdr message{};
+			message.msg_iov = reinterpret_cast<::iovec*>(const_cast<cppcoro::net::const_buffer*>(buffers));
+			message.msg_iovlen = static_cast<decltype(message.msg_iovlen)>(bufferCount);
+			return ::sendmsg(fd, &message, flags);
+		}
+	}
+}
 
 bool cppcoro::net::socket_send_operation_impl::try_start(
 	cppcoro::detail::async_operation_base& operation) noexcept
 {
 	operation.m_fd = m_socket.native_handle();
+#if CPPCORO_OS_LINUX
+	// Try the send() first in case it can complete without waiting.
+	if (operation.m_ioService->try_complete_inline())
+	{
+		const auto result = local::send(
+			m_socket.native_handle(), m_buffer, m_byteCount, m_buffers, m_bufferCount, MSG_DONTWAIT);
+		if (result >= 0)
+		{
+			operation.m_res = static_cast<std::int32_t>(result);
+			return false;
+		}
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+		{
+			operation.m_res = -errno;
+			return false;
+		}
+	}
+#endif
+#if CPPCORO_USE_IO_URING
+	if (m_buffers != nullptr)
+	{
+		// The buffers have the layout of an iovec array. An offset of -1
+		// means the socket has no file position to use.
+		return operation.try_submit({
+			IORING_OP_WRITEV,
+			m_socket.native_handle(),
+			m_buffers,
+			m_bufferCount <= 0xFFFFFFFF ?
+				static_cast<std::uint32_t>(m_bufferCount) : std::uint32_t(0xFFFFFFFF),
+			~std::uint64_t(0),
+			0 });
+	}
+
+	return operation.try_submit({
+		IORING_OP_SEND,
+		m_socket.native_handle(),
+		m_buffer,
+		m_byteCount <= 0xFFFFFFFF ?
+			static_cast<std::uint32_t>(m_byteCount) : std::uint32_t(0xFFFFFFFF),
+		0,
+		0 });
+#else
 	operation.m_completeFunc = [&]() {
-		return send(m_socket.native_handle(), m_buffer, m_byteCount, 0);
+		return local::send(m_socket.native_handle(), m_buffer, m_byteCount, m_buffers, m_bufferCount, 0);
 	};
-	operation.m_ioService->get_io_context().watch_handle(m_socket.native_handle(), reinterpret_cast<void*>(&operation), detail::watch_type::writable);
+	m_socket.watch(operation, detail::watch_type::writable);
 	return true;
+#endif
 }
 #endif
@@ -87,7 +87,7 @@ bool cppcoro::net::socket_send_to_operation_impl::try_start(
 			destinationLength
 		);
 	};
-	operation.m_ioService->get_io_context().watch_handle(m_socket.native_handle(), reinterpret_cast<void*>(&operation), cppcoro::detail::watch_type::writable);
+	m_socket.watch(operation, cppcoro::detail::watch_type::writable);
 	return true;
 }
 #endif
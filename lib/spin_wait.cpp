@@ -11,6 +11,8 @@
 #if CPPCORO_OS_WINNT
 # define WIN32_LEAN_AND_MEAN
 # include <windows.h>
+#elif CPPCORO_CPU_X86 || CPPCORO_CPU_X64
+# include <immintrin.h>
 #endif
 
 namespace
@@ -40,9 +42,19 @@ namespace cppcoro
 		m_count = initialCount;
 	}
 
-	void spin_wait::spin_one() noexcept
+	void spin_wait::pause() noexcept
 	{
 #if CPPCORO_OS_WINNT
+		YieldProcessor();
+#elif CPPCORO_CPU_X86 || CPPCORO_CPU_X64
+		_mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+		__asm__ __volatile__("yield");
+#endif
+	}
+
+	void spin_wait::spin_one() noexcept
+	{
 		// Spin strategy taken from .NET System.SpinWait class.
 		// I assume the Microsoft developers knew what they're doing.
 		if (!next_spin_will_yield())
@@ -54,10 +66,11 @@ namespace cppcoro
 			const std::uint32_t loopCount = 2u << m_count;
 			for (std::uint32_t i = 0; i < loopCount; ++i)
 			{
-				YieldProcessor();
-				YieldProcessor();
+				pause();
+				pause();
 			}
 		}
+#if CPPCORO_OS_WINNT
 		else
 		{
 			// We've already spun a number of iterations.
@@ -83,7 +96,7 @@ namespace cppcoro
 			}
 		}
 #else
-		if (next_spin_will_yield())
+		else
 		{
 			std::this_thread::yield();
 		}
@@ -21,6 +21,11 @@ namespace cppcoro
 
 		void reset() noexcept;
 
+		/// Tell the CPU we are busy-waiting, eg. with the x86 'pause' or ARM
+		/// 'yield' instruction, letting sibling hyper-threads run and saving
+		/// power. Does not yield to the OS scheduler.
+		static void pause() noexcept;
+
 	private:
 
 		std::uint32_t m_count;
@@ -7,13 +7,18 @@
 #include <cppcoro/static_thread_pool.hpp>
 
 #include "auto_reset_event.hpp"
-#include "spin_mutex.hpp"
+#include "cpu_topology.hpp"
 #include "spin_wait.hpp"
 
+#include <cppcoro/recycling_frame_allocator.hpp>
+
+#include <algorithm>
 #include <cassert>
 #include <mutex>
 #include <chrono>
+#include <thread>
 #include <utility>
+#include <vector>
 
 namespace
 {
@@ -22,6 +27,86 @@ namespace
 		// Keep each thread's local queue under 1MB
 		constexpr std::size_t max_local_queue_size = 1024 * 1024 / sizeof(void*);
 		constexpr std::size_t initial_local_queue_size = 256;
+
+		// The most items a thief takes in one steal.
+		constexpr std::size_t max_steal_batch_size = 128;
+
+		// How many operations in a row a worker may run from its next-to-run
+		// slot before taking one from its queue instead.
+		constexpr std::uint32_t max_next_to_run_streak = 3;
+
+		// How long another thread leaves an operation in a worker's
+		// next-to-run slot before stealing it. Long enough for a worker that
+		// is about to suspend to get to it first, short enough that one that
+		// keeps running or blocks doesn't strand it.
+		constexpr std::chrono::microseconds next_to_run_steal_delay{ 3 };
+
+		std::vector<std::vector<std::uint32_t>> cpu_sets_for(
+			const cppcoro::static_thread_pool_options& options)
+		{
+			using affinity_policy = cppcoro::static_thread_pool_options::affinity_policy;
+
+			std::vector<std::vector<std::uint32_t>> cpuSets;
+			switch (options.affinity)
+			{
+			case affinity_policy::none:
+				break;
+
+			case affinity_policy::cpu_sets:
+				for (auto& cpuSet : options.cpu_sets)
+				{
+					if (!cpuSet.empty())
+					{
+						cpuSets.push_back(cpuSet);
+					}
+				}
+				break;
+
+			case affinity_policy::one_per_core:
+				for (auto cpu : cppcoro::cpu_topology::get().one_cpu_per_core())
+				{
+					cpuSets.push_back({ cpu });
+				}
+				break;
+
+			case affinity_policy::numa_node:
+			{
+				// Every worker may use any CPU on the node.
+				auto nodeCpus = cppcoro::cpu_topology::get().node_cpus(options.numa_node);
+				if (!nodeCpus.empty())
+				{
+					cpuSets.resize(nodeCpus.size(), nodeCpus);
+				}
+				break;
+			}
+			}
+
+			return cpuSets;
+		}
+
+		std::uint32_t thread_count_for(
+			const cppcoro::static_thread_pool_options& options,
+			const std::vector<std::vector<std::uint32_t>>& cpuSets)
+		{
+			if (options.thread_count > 0)
+			{
+				return options.thread_count;
+			}
+
+			if (!cpuSets.empty())
+			{
+				return static_cast<std::uint32_t>(cpuSets.size());
+			}
+
+			return std::max(std::thread::hardware_concurrency(), 1u);
+		}
+
+		cppcoro::static_thread_pool_options options_with_thread_count(std::uint32_t threadCount)
+		{
+			cppcoro::static_thread_pool_options options;
+			options.thread_count = std::max(threadCount, 1u);
+			return options;
+		}
 	}
 }
 
@@ -35,14 +120,101 @@ namespace cppcoro
 	public:
 
 		explicit thread_state()
-			: m_localQueue(
-				std::make_unique<std::atomic<schedule_operation*>[]>(
-					local::initial_local_queue_size))
-			, m_mask(local::initial_local_queue_size - 1)
-			, m_head(0)
-			, m_tail(0)
-			, m_isSleeping(false)
+			: m_isSleeping(false)
+			, m_nextToRun(nullptr)
+			, m_nextToRunFillCount(0)
+			, m_nextToRunStreak(0)
+			, m_passedOverCounts{}
+			, m_cpu(cpu_topology::unknown_cpu)
+			, m_randomState(0)
+			, m_spinBudget(0)
+			, m_spinCount(0)
+			, m_spinSuccessCount(0)
+			, m_parkCount(0)
+		{
+		}
+
+		void set_random_seed(std::uint32_t seed) noexcept
+		{
+			// xorshift needs a non-zero state.
+			m_randomState = seed != 0 ? seed : 1;
+		}
+
+		// A cheap pseudo-random number for picking steal victims.
+		// Only called by the owning thread.
+		std::uint32_t next_random() noexcept
+		{
+			auto x = m_randomState;
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			m_randomState = x;
+			return x;
+		}
+
+		// The CPU the owning thread last ran on, as seen by other threads.
+		std::uint32_t cpu() const noexcept
+		{
+			return m_cpu.load(std::memory_order_relaxed);
+		}
+
+		void set_cpu(std::uint32_t cpu) noexcept
+		{
+			m_cpu.store(cpu, std::memory_order_relaxed);
+		}
+
+		// How many times to check for work before going to sleep.
+		std::uint32_t spin_budget() const noexcept
+		{
+			return m_spinBudget;
+		}
+
+		void set_spin_budget(std::uint32_t spinBudget) noexcept
+		{
+			m_spinBudget = spinBudget;
+		}
+
+		// Spin for longer if work arrived before we had slept for as long as
+		// we spun, otherwise spin for less.
+		void adapt_spin_budget(
+			std::chrono::steady_clock::duration spinTime,
+			std::chrono::steady_clock::duration sleepTime,
+			std::uint32_t maxSpinBudget) noexcept
+		{
+			if (sleepTime <= spinTime)
+			{
+				m_spinBudget = std::min(std::max(m_spinBudget * 2, 1u), maxSpinBudget);
+			}
+			else
+			{
+				m_spinBudget = std::min(std::max(m_spinBudget / 2, 1u), maxSpinBudget);
+			}
+		}
+
+		// Record the end of an idle period. Only called by the owning thread.
+		void count_idle(std::uint32_t spins, bool spinSucceeded, bool parked) noexcept
 		{
+			add(m_spinCount, spins);
+			add(m_spinSuccessCount, spinSucceeded ? 1 : 0);
+			add(m_parkCount, parked ? 1 : 0);
+		}
+
+		void add_stats(static_thread_pool_stats& stats) const noexcept
+		{
+			stats.spins += m_spinCount.load(std::memory_order_relaxed);
+			stats.spin_successes += m_spinSuccessCount.load(std::memory_order_relaxed);
+			stats.parks += m_parkCount.load(std::memory_order_relaxed);
+
+			const auto frameStats = m_frameAllocator.stats();
+			stats.frame_cache_hits += frameStats.hits;
+			stats.frame_cache_misses += frameStats.misses;
+		}
+
+		// Recycles the frames of coroutines created on the owning thread
+		// when the pool was created with recycle_frames.
+		recycling_frame_allocator& frame_cache() noexcept
+		{
+			return m_frameAllocator;
 		}
 
 		bool try_wake_up()
@@ -87,240 +259,457 @@ namespace cppcoro
 			}
 		}
 
+		// Ignores the next-to-run slot, which the owner will usually get to
+		// before a spinning thief could.
 		bool approx_has_any_queued_work() const noexcept
 		{
-			return difference(
-				m_head.load(std::memory_order_relaxed),
-				m_tail.load(std::memory_order_relaxed)) > 0;
+			for (auto& queue : m_queues)
+			{
+				if (queue.approx_size() != 0)
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		bool approx_has_queued_work(std::size_t lane) const noexcept
+		{
+			return m_queues[lane].approx_size() != 0;
 		}
 
 		bool has_any_queued_work() noexcept
 		{
-			std::scoped_lock lock{ m_remoteMutex };
-			auto tail = m_tail.load(std::memory_order_relaxed);
-			auto head = m_head.load(std::memory_order_seq_cst);
-			return difference(head, tail) > 0;
+			for (auto& queue : m_queues)
+			{
+				if (queue.has_any_queued_work())
+				{
+					return true;
+				}
+			}
+
+			return has_next_to_run();
 		}
 
-		bool try_local_enqueue(schedule_operation*& operation) noexcept
+		// Run \p operation next on this thread, where the data it uses is
+		// likely to still be in cache.
+		//
+		// Returns the operation that was previously going to run next, if
+		// any, which the caller should queue instead.
+		schedule_operation* exchange_next_to_run(schedule_operation* operation) noexcept
 		{
-			// Head is only ever written-to by the current thread so we
-			// are safe to use relaxed memory order when reading it.
-			auto head = m_head.load(std::memory_order_relaxed);
+			// Only the owning thread writes this.
+			m_nextToRunFillCount.store(
+				m_nextToRunFillCount.load(std::memory_order_relaxed) + 1,
+				std::memory_order_relaxed);
+
+			// seq_cst so that a thread checking for work after signalling an
+			// intent to sleep either sees this or is woken by us.
+			return m_nextToRun.exchange(operation, std::memory_order_seq_cst);
+		}
 
-			// It is possible this method may be running concurrently with
-			// try_remote_steal() which may have just speculatively incremented m_tail
-			// trying to steal the last item in the queue but has not yet read the
-			// queue item. So we need to make sure we don't write to the last available
-			// space (at slot m_tail - 1) as this may still contain a pointer to an
-			// operation that has not yet been executed.
-			//
-			// Note that it's ok to read stale values from m_tail since new values
-			// won't ever decrease the number of available slots by more than 1.
-			// Reading a stale value can just mean that sometimes the queue appears
-			// empty when it may actually have slots free.
-			//
-			// Here m_mask is equal to buffersize - 1 so we can only write to a slot
-			// if the number of items consumed in the queue (head - tail) is less than
-			// the mask.
-			auto tail = m_tail.load(std::memory_order_relaxed);
-			if (difference(head, tail) < static_cast<offset_t>(m_mask))
-			{
-				// There is space left in the local buffer.
-				m_localQueue[head & m_mask].store(operation, std::memory_order_relaxed);
-				m_head.store(head + 1, std::memory_order_seq_cst);
-				return true;
+		// Take the operation another thread was going to run next. Only done
+		// as a last resort, as the owner is likely to run it sooner.
+		//
+		// A freshly filled slot is left alone for next_to_run_steal_delay. If
+		// the owner refills it in that time then it is still running its
+		// coroutines and nullptr is returned.
+		schedule_operation* try_steal_next_to_run() noexcept
+		{
+			if (m_nextToRun.load(std::memory_order_relaxed) == nullptr)
+			{
+				return nullptr;
 			}
 
-			if (m_mask == local::max_local_queue_size)
+			const auto fillCount = m_nextToRunFillCount.load(std::memory_order_relaxed);
+			const auto deadline =
+				std::chrono::steady_clock::now() + local::next_to_run_steal_delay;
+			do
 			{
-				// No space in the buffer and we don't want to grow
-				// it any further.
-				return false;
-			}
+				if (m_nextToRun.load(std::memory_order_relaxed) == nullptr ||
+					m_nextToRunFillCount.load(std::memory_order_relaxed) != fillCount)
+				{
+					return nullptr;
+				}
 
-			// Allocate the new buffer before taking out the lock so that
-			// we ensure we hold the lock for as short a time as possible.
-			const size_t newSize = (m_mask + 1) * 2;
+				spin_wait::pause();
+			} while (std::chrono::steady_clock::now() < deadline);
 
-			std::unique_ptr<std::atomic<schedule_operation*>[]> newLocalQueue{
-				new (std::nothrow) std::atomic<schedule_operation*>[newSize]
-			};
-			if (!newLocalQueue)
+			return m_nextToRun.exchange(nullptr, std::memory_order_acquire);
+		}
+
+		bool has_next_to_run() const noexcept
+		{
+			return m_nextToRun.load(std::memory_order_seq_cst) != nullptr;
+		}
+
+		// Take the operation to run next on the owning thread.
+		//
+		// If several have already run this way in a row then the operation
+		// goes to the back of its queue instead and nullptr is returned, so
+		// that a pair of coroutines scheduling each other can't starve older
+		// work.
+		schedule_operation* try_take_next_to_run() noexcept
+		{
+			if (m_nextToRun.load(std::memory_order_relaxed) == nullptr)
 			{
-				// Unable to allocate more memory.
-				return false;
+				return nullptr;
 			}
 
-			if (!m_remoteMutex.try_lock())
+			auto* operation = m_nextToRun.exchange(nullptr, std::memory_order_acquire);
+			if (operation == nullptr || m_nextToRunStreak < local::max_next_to_run_streak)
 			{
-				// Don't wait to acquire the lock if we can't get it immediately.
-				// Fail and let it be enqueued to the global queue.
-				// TODO: Should we have a per-thread overflow queue instead?
-				return false;
+				++m_nextToRunStreak;
+				return operation;
 			}
 
-			std::scoped_lock lock{ std::adopt_lock, m_remoteMutex };
+			m_nextToRunStreak = 0;
+			return try_local_enqueue(operation) ? nullptr : operation;
+		}
 
-			// We can now re-read tail, guaranteed that we are not seeing a stale version.
-			tail = m_tail.load(std::memory_order_relaxed);
+		void reset_next_to_run_streak() noexcept
+		{
+			m_nextToRunStreak = 0;
+		}
 
-			// Copy the existing operations.
-			const size_t newMask = newSize - 1;
-			for (size_t i = tail; i != head; ++i)
+		// A lower priority lane that has been passed over at least
+		// \p quota times while it had work, or priority_count if none has.
+		std::size_t starved_lane(std::uint32_t quota) const noexcept
+		{
+			if (quota != 0)
 			{
-				newLocalQueue[i & newMask].store(
-					m_localQueue[i & m_mask].load(std::memory_order_relaxed),
-					std::memory_order_relaxed);
+				for (std::size_t lane = priority_count - 1; lane > 0; --lane)
+				{
+					if (m_passedOverCounts[lane] >= quota)
+					{
+						return lane;
+					}
+				}
 			}
 
-			// Finally, write the new operation to the queue.
-			newLocalQueue[head & newMask].store(operation, std::memory_order_relaxed);
+			return priority_count;
+		}
 
-			m_head.store(head + 1, std::memory_order_relaxed);
-			m_localQueue = std::move(newLocalQueue);
-			m_mask = newMask;
-			return true;
+		void reset_passed_over(std::size_t lane) noexcept
+		{
+			m_passedOverCounts[lane] = 0;
 		}
 
-		schedule_operation* try_local_pop() noexcept
+		void pass_over(std::size_t lane) noexcept
 		{
-			// Cheap, approximate, no memory-barrier check for emptiness
-			auto head = m_head.load(std::memory_order_relaxed);
-			auto tail = m_tail.load(std::memory_order_relaxed);
-			if (difference(head, tail) <= 0)
-			{
-				// Empty
-				return nullptr;
-			}
+			++m_passedOverCounts[lane];
+		}
 
-			// 3 classes of interleaving of try_local_pop() and try_remote_steal()
-			// - local pop completes before remote steal (easy)
-			// - remote steal completes before local pop (easy)
-			// - both are executed concurrently, both see each other's writes (harder)
+		bool try_local_enqueue(schedule_operation* operation) noexcept
+		{
+			return m_queues[lane_of(operation)].try_enqueue(operation);
+		}
 
-			// Speculatively try to acquire the head item of the work queue by
-			// decrementing the head cursor. This may race with a concurrent call
-			// to try_remote_steal() that is also trying to speculatively increment
-			// the tail cursor to steal from the other end of the queue. In the case
-			// that they both try to dequeue the last/only item in the queue then we
-			// need to fall back to locking to decide who wins
+		schedule_operation* try_local_pop(std::size_t lane) noexcept
+		{
+			return m_queues[lane].try_pop();
+		}
 
-			auto newHead = head - 1;
-			m_head.store(newHead, std::memory_order_seq_cst);
+		std::size_t try_steal(
+			std::size_t lane,
+			schedule_operation** operations,
+			std::size_t maxCount,
+			bool* lostRace = nullptr) noexcept
+		{
+			return m_queues[lane].try_steal(operations, maxCount, lostRace);
+		}
 
-			tail = m_tail.load(std::memory_order_seq_cst);
+	private:
 
-			if (difference(newHead, tail) < 0)
+		// A first-in first-out ring buffer of operations. The owning thread
+		// pushes at the head, and both it and thieves take items from the
+		// tail by advancing m_tail with a compare-exchange.
+		class local_queue
+		{
+		public:
+
+			// The buffer is allocated by the owning thread on its first
+			// enqueue, after it has been moved to its CPUs, so that it is
+			// placed on that thread's NUMA node.
+			local_queue() noexcept
+				: m_localQueue(nullptr)
+				, m_head(0)
+				, m_tail(0)
+			{}
+
+			// The number of items queued, which may be out of date as soon
+			// as it is read.
+			std::size_t approx_size() const noexcept
 			{
-				// There was a race to get the last item.
-				// We don't know whether the remote steal saw our write
-				// and decided to back off or not, so we acquire the mutex
-				// so that we wait until the remote steal has completed so
-				// we can see what decision it made.
-				std::lock_guard lock{ m_remoteMutex };
+				const auto size = difference(
+					m_head.load(std::memory_order_relaxed),
+					m_tail.load(std::memory_order_relaxed));
+				return size > 0 ? static_cast<std::size_t>(size) : 0;
+			}
 
-				// Use relaxed since the lock guarantees visibility of the writes
-				// that the remote steal thread performed.
-				tail = m_tail.load(std::memory_order_relaxed);
+			bool has_any_queued_work() noexcept
+			{
+				// Use seq_cst so that a thread checking for work after
+				// signalling an intent to sleep either sees an enqueue or has
+				// its signal seen by the enqueuer's wake_one_thread().
+				auto tail = m_tail.load(std::memory_order_seq_cst);
+				auto head = m_head.load(std::memory_order_seq_cst);
+				return difference(head, tail) > 0;
+			}
 
-				if (difference(newHead, tail) < 0)
+			bool try_enqueue(schedule_operation* operation) noexcept
+			{
+				// Head is only ever written-to by the current thread so we
+				// are safe to use relaxed memory order when reading it.
+				auto head = m_head.load(std::memory_order_relaxed);
+
+				// Reading a stale value of tail can only make the queue appear
+				// fuller than it is, since it is only ever incremented.
+				auto tail = m_tail.load(std::memory_order_acquire);
+				queue_buffer* queue = m_ownedQueue.get();
+				if (queue == nullptr ||
+					difference(head, tail) >= static_cast<offset_t>(queue->capacity()))
 				{
-					// The other thread didn't see our write and stole the last item.
-					// We need to restore the head back to it's old value.
-					// We hold the mutex so can just use relaxed memory order for this.
-					m_head.store(head, std::memory_order_relaxed);
-					return nullptr;
+					queue = try_grow(head, tail);
+					if (queue == nullptr)
+					{
+						// Let it be enqueued to the global queue instead.
+						return false;
+					}
 				}
-			}
 
-			// We successfully acquired an item from the queue.
-			return m_localQueue[newHead & m_mask].load(std::memory_order_relaxed);
-		}
+				queue->store(head, operation);
 
-		schedule_operation* try_steal(bool* lockUnavailable = nullptr) noexcept
-		{
-			if (lockUnavailable == nullptr)
-			{
-				m_remoteMutex.lock();
+				// seq_cst also releases the write of the item to thieves.
+				m_head.store(head + 1, std::memory_order_seq_cst);
+				return true;
 			}
-			else if (!m_remoteMutex.try_lock())
+
+			// Only called by the owning thread.
+			schedule_operation* try_pop() noexcept
 			{
-				*lockUnavailable = true;
+				schedule_operation* operation = nullptr;
+				while (approx_size() != 0)
+				{
+					if (try_steal(&operation, 1) != 0)
+					{
+						return operation;
+					}
+				}
+
 				return nullptr;
 			}
 
-			std::scoped_lock lock{ std::adopt_lock, m_remoteMutex };
-
-			auto tail = m_tail.load(std::memory_order_relaxed);
-			auto head = m_head.load(std::memory_order_seq_cst);
-			if (difference(head, tail) <= 0)
+			// Take up to half of the queued operations, and at most
+			// \p maxCount, from the tail of the queue.
+			//
+			// Returns the number of operations written to \p operations,
+			// which is zero if the queue was empty or, when \p lostRace is
+			// non-null, if another thread took the items first, in which case
+			// \p lostRace is set to true.
+			std::size_t try_steal(
+				schedule_operation** operations,
+				std::size_t maxCount,
+				bool* lostRace = nullptr) noexcept
 			{
-				return nullptr;
+				while (true)
+				{
+					auto tail = m_tail.load(std::memory_order_acquire);
+					auto head = m_head.load(std::memory_order_acquire);
+					const auto size = difference(head, tail);
+					if (size <= 0)
+					{
+						return 0;
+					}
+
+					const std::size_t count = std::min(
+						static_cast<std::size_t>(size + 1) / 2, maxCount);
+
+					// The owner may swap in a larger buffer at any time, but
+					// it copies the items still queued and keeps the old
+					// buffer alive, so the items after tail are valid in
+					// whichever we see. The owner never overwrites an item
+					// before tail has moved past it, so if the
+					// compare-exchange succeeds then none of the items we
+					// read have been taken or replaced.
+					auto* queue = m_localQueue.load(std::memory_order_acquire);
+					for (std::size_t i = 0; i < count; ++i)
+					{
+						operations[i] = queue->load(tail + i);
+					}
+
+					if (m_tail.compare_exchange_strong(
+						tail, tail + count, std::memory_order_seq_cst, std::memory_order_relaxed))
+					{
+						return count;
+					}
+
+					// Another thread took some of the items first.
+					if (lostRace != nullptr)
+					{
+						*lostRace = true;
+						return 0;
+					}
+				}
 			}
 
-			// It looks like there are items in the queue.
-			// We'll speculatively try to steal one by incrementing
-			// the tail cursor. As this may be running concurrently
-			// with try_local_pop() which is also speculatively trying
-			// to remove an item from the other end of the queue we
-			// need to re-read  the 'head' cursor afterwards to see
-			// if there was a potential race to dequeue the last item.
-			// Use seq_cst memory order both here and in try_local_pop()
-			// to ensure that either we will see their write to head or
-			// they will see our write to tail or we will both see each
-			// other's writes.
-			m_tail.store(tail + 1, std::memory_order_seq_cst);
-			head = m_head.load(std::memory_order_seq_cst);
+		private:
+
+			using offset_t = std::make_signed_t<std::size_t>;
 
-			if (difference(head, tail) > 0)
+			static constexpr offset_t difference(size_t a, size_t b)
 			{
-				// There was still an item in the queue after incrementing tail.
-				// We managed to steal an item from the bottom of the stack.
-				return m_localQueue[tail & m_mask].load(std::memory_order_relaxed);
+				return static_cast<offset_t>(a - b);
 			}
-			else
+
+			// A power-of-two sized circular buffer of operations, indexed by the
+			// unbounded head/tail positions.
+			class queue_buffer
 			{
-				// Otherwise we failed to steal the last item.
-				// Restore the old tail position.
-				m_tail.store(tail, std::memory_order_seq_cst);
-				return nullptr;
+			public:
+
+				explicit queue_buffer(std::size_t capacity)
+					: m_items(std::make_unique<std::atomic<schedule_operation*>[]>(capacity))
+					, m_mask(capacity - 1)
+				{}
+
+				std::size_t capacity() const noexcept { return m_mask + 1; }
+
+				schedule_operation* load(std::size_t index) const noexcept
+				{
+					return m_items[index & m_mask].load(std::memory_order_relaxed);
+				}
+
+				void store(std::size_t index, schedule_operation* operation) noexcept
+				{
+					m_items[index & m_mask].store(operation, std::memory_order_relaxed);
+				}
+
+				// The buffer this one replaced. Thieves may still be reading from
+				// it so it is kept until the thread_state is destroyed.
+				std::unique_ptr<queue_buffer> m_previous;
+
+			private:
+
+				std::unique_ptr<std::atomic<schedule_operation*>[]> m_items;
+				std::size_t m_mask;
+
+			};
+
+			// Replace the full local queue with one twice the size, or allocate
+			// the first one.
+			//
+			// Returns the new buffer, or nullptr if the queue is already at its
+			// maximum size or memory could not be allocated.
+			queue_buffer* try_grow(std::size_t head, std::size_t tail) noexcept
+			{
+				const std::size_t newSize = m_ownedQueue ?
+					m_ownedQueue->capacity() * 2 : local::initial_local_queue_size;
+				if (newSize > local::max_local_queue_size)
+				{
+					return nullptr;
+				}
+
+				std::unique_ptr<queue_buffer> newQueue;
+				try
+				{
+					newQueue = std::make_unique<queue_buffer>(newSize);
+				}
+				catch (...)
+				{
+					// Unable to allocate more memory.
+					return nullptr;
+				}
+
+				// Copy the items that may not have been stolen yet. Copying some
+				// that thieves take meanwhile is harmless; they are only ever
+				// read at positions after tail.
+				for (std::size_t i = tail; i != head; ++i)
+				{
+					newQueue->store(i, m_ownedQueue->load(i));
+				}
+
+				newQueue->m_previous = std::move(m_ownedQueue);
+				m_ownedQueue = std::move(newQueue);
+				m_localQueue.store(m_ownedQueue.get(), std::memory_order_release);
+				return m_ownedQueue.get();
 			}
-		}
 
-	private:
+			// Owned by this thread; m_localQueue publishes it to thieves.
+			std::unique_ptr<queue_buffer> m_ownedQueue;
+			std::atomic<queue_buffer*> m_localQueue;
+
+#if CPPCORO_COMPILER_MSVC
+# pragma warning(push)
+# pragma warning(disable : 4324)
+#endif
 
-		using offset_t = std::make_signed_t<std::size_t>;
+			//alignas(std::hardware_destructive_interference_size)
+			std::atomic<std::size_t> m_head;
 
-		static constexpr offset_t difference(size_t a, size_t b)
+			//alignas(std::hardware_destructive_interference_size)
+			std::atomic<std::size_t> m_tail;
+
+#if CPPCORO_COMPILER_MSVC
+# pragma warning(pop)
+#endif
+
+		};
+
+		static std::size_t lane_of(const schedule_operation* operation) noexcept
+		{
+			return static_cast<std::size_t>(operation->m_priority);
+		}
+
+		// Counters only have one writer so don't need a locked increment.
+		static void add(std::atomic<std::uint64_t>& counter, std::uint64_t amount) noexcept
 		{
-			return static_cast<offset_t>(a - b);
+			if (amount != 0)
+			{
+				counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+			}
 		}
 
-		std::unique_ptr<std::atomic<schedule_operation*>[]> m_localQueue;
-		std::size_t m_mask;
+		local_queue m_queues[priority_count];
 
 #if CPPCORO_COMPILER_MSVC
 # pragma warning(push)
 # pragma warning(disable : 4324)
 #endif
 
-		//alignas(std::hardware_destructive_interference_size)
-		std::atomic<std::size_t> m_head;
-
-		//alignas(std::hardware_destructive_interference_size)
-		std::atomic<std::size_t> m_tail;
-
 		//alignas(std::hardware_destructive_interference_size)
 		std::atomic<bool> m_isSleeping;
-		spin_mutex m_remoteMutex;
 
 #if CPPCORO_COMPILER_MSVC
 # pragma warning(pop)
 #endif
 
+		std::atomic<schedule_operation*> m_nextToRun;
+
+		// The number of times m_nextToRun has been filled, so that a thief
+		// can tell whether the owner is still running its coroutines.
+		std::atomic<std::uint32_t> m_nextToRunFillCount;
+
+		// The number of operations in a row taken from m_nextToRun.
+		std::uint32_t m_nextToRunStreak;
+
+		// How many operations have been taken from higher priority lanes
+		// while each lane had work waiting.
+		std::uint32_t m_passedOverCounts[priority_count];
+
+		std::atomic<std::uint32_t> m_cpu;
+		std::uint32_t m_randomState;
+		std::uint32_t m_spinBudget;
+
+		std::atomic<std::uint64_t> m_spinCount;
+		std::atomic<std::uint64_t> m_spinSuccessCount;
+		std::atomic<std::uint64_t> m_parkCount;
+
 		auto_reset_event m_wakeUpEvent;
 
+		recycling_frame_allocator m_frameAllocator;
+
 	};
 
 	void static_thread_pool::schedule_operation::await_suspend(
@@ -336,14 +725,23 @@ namespace cppcoro
 	}
 
 	static_thread_pool::static_thread_pool(std::uint32_t threadCount)
-		: m_threadCount(threadCount > 0 ? threadCount : 1)
+		: static_thread_pool(local::options_with_thread_count(threadCount))
+	{
+	}
+
+	static_thread_pool::static_thread_pool(const static_thread_pool_options& options)
+		: m_cpuSets(local::cpu_sets_for(options))
+		, m_threadCount(local::thread_count_for(options, m_cpuSets))
 		, m_threadStates(std::make_unique<thread_state[]>(m_threadCount))
+		, m_spinCount(options.spin_count)
+		, m_spinStrategy(options.spin)
+		, m_adaptiveSpin(options.adaptive_spin)
+		, m_priorityQuota(options.priority_quota)
+		, m_recycleFrames(options.recycle_frames)
 		, m_stopRequested(false)
-		, m_globalQueueHead(nullptr)
-		, m_globalQueueTail(nullptr)
 		, m_sleepingThreadCount(0)
 	{
-		m_threads.reserve(threadCount);
+		m_threads.reserve(m_threadCount);
 		try
 		{
 			for (std::uint32_t i = 0; i < m_threadCount; ++i)
@@ -377,39 +775,35 @@ namespace cppcoro
 		s_currentState = &localState;
 		s_currentThreadPool = this;
 
-		auto tryGetRemote = [&]()
-		{
-			// Try to get some new work first from the global queue
-			// then if that queue is empty then try to steal from
-			// the local queues of other worker threads.
-			// We try to get new work from the global queue first
-			// before stealing as stealing from other threads has
-			// the side-effect of those threads running out of work
-			// sooner and then having to steal work which increases
-			// contention.
-			auto* op = try_global_dequeue();
-			if (op == nullptr)
-			{
-				op = try_steal_from_other_thread(threadIndex);
-			}
-			return op;
-		};
+		if (!m_cpuSets.empty())
+		{
+			// Best effort; an unpinned worker still works.
+			cpu_topology::set_current_thread_affinity(m_cpuSets[threadIndex % m_cpuSets.size()]);
+		}
+
+		// Give each thread a different steal order.
+		localState.set_random_seed(
+			static_cast<std::uint32_t>(threadIndex + 1) * 0x9E3779B9u);
+		localState.set_cpu(cpu_topology::current_cpu());
+		localState.set_spin_budget(m_spinCount);
+
+		if (m_recycleFrames)
+		{
+			set_default_frame_allocator(&localState.frame_cache());
+		}
 
 		while (true)
 		{
-			// Process operations from the local queue.
+			// Process operations from the local queues, global queues and
+			// other threads' queues.
 			schedule_operation* op;
 
 			while (true)
 			{
-				op = localState.try_local_pop();
+				op = try_dequeue(threadIndex);
 				if (op == nullptr)
 				{
-					op = tryGetRemote();
-					if (op == nullptr)
-					{
-						break;
-					}
+					break;
 				}
 
 				op->m_awaitingCoroutine.resume();
@@ -425,20 +819,27 @@ namespace cppcoro
 			cppcoro::spin_wait spinWait;
 			while (true)
 			{
-				for (int i = 0; i < 30; ++i)
+				const auto spinStartTime = m_adaptiveSpin ?
+					std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+
+				const std::uint32_t spinBudget = localState.spin_budget();
+				for (std::uint32_t i = 0; i < spinBudget; ++i)
 				{
 					if (is_shutdown_requested())
 					{
+						localState.count_idle(i, false, false);
 						return;
 					}
 
-					spinWait.spin_one();
+					spin(spinWait);
 
 					if (approx_has_any_queued_work_for(threadIndex))
 					{
-						op = tryGetRemote();
+						op = try_dequeue(threadIndex);
 						if (op != nullptr)
 						{
+							localState.count_idle(i + 1, true, false);
+
 							// Now that we've executed some work we can
 							// return to normal processing since this work
 							// might have queued some more work to the local
@@ -462,9 +863,11 @@ namespace cppcoro
 
 				if (has_any_queued_work_for(threadIndex))
 				{
-					op = tryGetRemote();
+					op = try_dequeue(threadIndex);
 					if (op != nullptr)
 					{
+						localState.count_idle(spinBudget, false, false);
+
 						// Try to clear the intent to sleep so that some other thread
 						// that subsequently enqueues some work won't mistakenly try
 						// to wake this threadup when we are already running as there
@@ -487,7 +890,21 @@ namespace cppcoro
 					return;
 				}
 
+				localState.count_idle(spinBudget, false, true);
+
+				const auto sleepStartTime = m_adaptiveSpin ?
+					std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+
 				localState.sleep_until_woken();
+				localState.set_cpu(cpu_topology::current_cpu());
+
+				if (m_adaptiveSpin)
+				{
+					localState.adapt_spin_budget(
+						sleepStartTime - spinStartTime,
+						std::chrono::steady_clock::now() - sleepStartTime,
+						m_spinCount);
+				}
 			}
 
 		normal_processing:
@@ -496,6 +913,32 @@ namespace cppcoro
 		}
 	}
 
+	static_thread_pool_stats static_thread_pool::stats() const noexcept
+	{
+		static_thread_pool_stats stats;
+		for (std::uint32_t i = 0; i < m_threadCount; ++i)
+		{
+			m_threadStates[i].add_stats(stats);
+		}
+		return stats;
+	}
+
+	void static_thread_pool::spin(spin_wait& spinWait) const noexcept
+	{
+		switch (m_spinStrategy)
+		{
+		case static_thread_pool_options::spin_strategy::backoff:
+			spinWait.spin_one();
+			break;
+		case static_thread_pool_options::spin_strategy::pause:
+			spin_wait::pause();
+			break;
+		case static_thread_pool_options::spin_strategy::yield:
+			std::this_thread::yield();
+			break;
+		}
+	}
+
 	void static_thread_pool::shutdown()
 	{
 		m_stopRequested.store(true, std::memory_order_relaxed);
@@ -520,22 +963,33 @@ namespace cppcoro
 
 	void static_thread_pool::schedule_impl(schedule_operation* operation) noexcept
 	{
-		if (s_currentThreadPool != this ||
-			!s_currentState->try_local_enqueue(operation))
+		if (s_currentThreadPool == this)
+		{
+			// Whatever was going to run next is queued behind older work.
+			operation = s_currentState->exchange_next_to_run(operation);
+		}
+
+		if (operation != nullptr &&
+			(s_currentThreadPool != this ||
+			 !s_currentState->try_local_enqueue(operation)))
 		{
 			remote_enqueue(operation);
 		}
 
+		// Wake a thread even if the operation is in our next-to-run slot, as
+		// the current coroutine may keep this thread busy or block it before
+		// it suspends.
 		wake_one_thread();
 	}
 
 	void static_thread_pool::remote_enqueue(schedule_operation* operation) noexcept
 	{
-		auto* tail = m_globalQueueTail.load(std::memory_order_relaxed);
+		auto& globalQueue = m_globalQueues[static_cast<std::size_t>(operation->m_priority)];
+		auto* tail = globalQueue.m_tail.load(std::memory_order_relaxed);
 		do
 		{
 			operation->m_next = tail;
-		} while (!m_globalQueueTail.compare_exchange_weak(
+		} while (!globalQueue.m_tail.compare_exchange_weak(
 			tail,
 			operation,
 			std::memory_order_seq_cst,
@@ -544,14 +998,17 @@ namespace cppcoro
 
 	bool static_thread_pool::has_any_queued_work_for(std::uint32_t threadIndex) noexcept
 	{
-		if (m_globalQueueTail.load(std::memory_order_seq_cst) != nullptr)
+		for (auto& globalQueue : m_globalQueues)
 		{
-			return true;
-		}
+			if (globalQueue.m_tail.load(std::memory_order_seq_cst) != nullptr)
+			{
+				return true;
+			}
 
-		if (m_globalQueueHead.load(std::memory_order_seq_cst) != nullptr)
-		{
-			return true;
+			if (globalQueue.m_head.load(std::memory_order_seq_cst) != nullptr)
+			{
+				return true;
+			}
 		}
 
 		for (std::uint32_t i = 0; i < m_threadCount; ++i)
@@ -573,14 +1030,17 @@ namespace cppcoro
 		// don't bounce cache-lines around between threads/cores unnecessarily when
 		// multiple threads are all spinning waiting for work.
 
-		if (m_globalQueueTail.load(std::memory_order_relaxed) != nullptr)
+		for (auto& globalQueue : m_globalQueues)
 		{
-			return true;
-		}
+			if (globalQueue.m_tail.load(std::memory_order_relaxed) != nullptr)
+			{
+				return true;
+			}
 
-		if (m_globalQueueHead.load(std::memory_order_relaxed) != nullptr)
-		{
-			return true;
+			if (globalQueue.m_head.load(std::memory_order_relaxed) != nullptr)
+			{
+				return true;
+			}
 		}
 
 		for (std::uint32_t i = 0; i < m_threadCount; ++i)
@@ -648,24 +1108,34 @@ namespace cppcoro
 	}
 
 	static_thread_pool::schedule_operation*
-	static_thread_pool::try_global_dequeue() noexcept
+	static_thread_pool::try_global_dequeue(std::size_t lane) noexcept
 	{
-		std::scoped_lock lock{ m_globalQueueMutex };
+		auto& globalQueue = m_globalQueues[lane];
 
-		auto* head = m_globalQueueHead.load(std::memory_order_relaxed);
+		// Avoid taking the lock when the queue looks empty, as workers check
+		// every lane's queue each time they look for work.
+		if (globalQueue.m_head.load(std::memory_order_relaxed) == nullptr &&
+			globalQueue.m_tail.load(std::memory_order_relaxed) == nullptr)
+		{
+			return nullptr;
+		}
+
+		std::scoped_lock lock{ globalQueue.m_mutex };
+
+		auto* head = globalQueue.m_head.load(std::memory_order_relaxed);
 		if (head == nullptr)
 		{
 			// Use seq-cst memory order so that when we check for an item in the
 			// global queue after signalling an intent to sleep that either we
 			// will see their enqueue or they will see our signal to sleep and
 			// wake us up.
-			if (m_globalQueueTail.load(std::memory_order_seq_cst) == nullptr)
+			if (globalQueue.m_tail.load(std::memory_order_seq_cst) == nullptr)
 			{
 				return nullptr;
 			}
 
 			// Acquire the entire set of queued operations in a single operation.
-			auto* tail = m_globalQueueTail.exchange(nullptr, std::memory_order_acquire);
+			auto* tail = globalQueue.m_tail.exchange(nullptr, std::memory_order_acquire);
 			if (tail == nullptr)
 			{
 				return nullptr;
@@ -679,37 +1149,155 @@ namespace cppcoro
 			} while (tail != nullptr);
 		}
 
-		m_globalQueueHead = head->m_next;
+		globalQueue.m_head = head->m_next;
 
 		return head;
 	}
 
 	static_thread_pool::schedule_operation*
-	static_thread_pool::try_steal_from_other_thread(std::uint32_t thisThreadIndex) noexcept
+	static_thread_pool::try_dequeue(std::uint32_t threadIndex) noexcept
 	{
-		// Try first with non-blocking steal attempts.
+		auto& localState = m_threadStates[threadIndex];
 
-		bool anyLocksUnavailable = false;
-		for (std::uint32_t otherThreadIndex = 0; otherThreadIndex < m_threadCount; ++otherThreadIndex)
+		// A lower priority lane that has waited too long goes first.
+		const std::size_t starvedLane = localState.starved_lane(m_priorityQuota);
+		if (starvedLane != priority_count)
 		{
-			if (otherThreadIndex == thisThreadIndex) continue;
-			auto& otherThreadState = m_threadStates[otherThreadIndex];
-			auto* op = otherThreadState.try_steal(&anyLocksUnavailable);
+			auto* op = localState.try_local_pop(starvedLane);
+			if (op == nullptr)
+			{
+				op = try_global_dequeue(starvedLane);
+			}
+			if (op == nullptr)
+			{
+				op = try_steal_from_other_thread(threadIndex, starvedLane);
+			}
 			if (op != nullptr)
 			{
-				return op;
+				localState.reset_next_to_run_streak();
+				return note_dequeued(localState, op);
+			}
+		}
+
+		auto* op = localState.try_take_next_to_run();
+		if (op != nullptr)
+		{
+			const auto lane = static_cast<std::size_t>(op->m_priority);
+			if (!approx_has_higher_priority_work(localState, lane))
+			{
+				return note_dequeued(localState, op);
+			}
+
+			// Let the more important work run first.
+			if (!localState.try_local_enqueue(op))
+			{
+				remote_enqueue(op);
 			}
 		}
 
-		if (anyLocksUnavailable)
+		localState.reset_next_to_run_streak();
+
+		// Look at our own queue first and then the global queue for each
+		// lane, before stealing from other threads as stealing has the
+		// side-effect of those threads running out of work sooner and then
+		// having to steal work which increases contention.
+		for (std::size_t lane = 0; lane < priority_count; ++lane)
 		{
-			// We didn't check all of the other threads for work to steal yet.
-			// Try again, this time waiting to acquire the locks.
-			for (std::uint32_t otherThreadIndex = 0; otherThreadIndex < m_threadCount; ++otherThreadIndex)
+			op = localState.try_local_pop(lane);
+			if (op == nullptr)
+			{
+				op = try_global_dequeue(lane);
+			}
+			if (op != nullptr)
 			{
+				return note_dequeued(localState, op);
+			}
+		}
+
+		for (std::size_t lane = 0; lane < priority_count; ++lane)
+		{
+			op = try_steal_from_other_thread(threadIndex, lane);
+			if (op != nullptr)
+			{
+				return note_dequeued(localState, op);
+			}
+		}
+
+		op = try_steal_next_to_run_from_other_thread(threadIndex);
+		if (op != nullptr)
+		{
+			return note_dequeued(localState, op);
+		}
+
+		return nullptr;
+	}
+
+	bool static_thread_pool::approx_has_higher_priority_work(
+		const thread_state& state, std::size_t lane) const noexcept
+	{
+		for (std::size_t higherLane = 0; higherLane < lane; ++higherLane)
+		{
+			if (state.approx_has_queued_work(higherLane) ||
+				m_globalQueues[higherLane].m_head.load(std::memory_order_relaxed) != nullptr ||
+				m_globalQueues[higherLane].m_tail.load(std::memory_order_relaxed) != nullptr)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	static_thread_pool::schedule_operation*
+	static_thread_pool::note_dequeued(thread_state& state, schedule_operation* operation) noexcept
+	{
+		const auto lane = static_cast<std::size_t>(operation->m_priority);
+		state.reset_passed_over(lane);
+
+		if (m_priorityQuota != 0)
+		{
+			for (std::size_t lowerLane = lane + 1; lowerLane < priority_count; ++lowerLane)
+			{
+				if (state.approx_has_queued_work(lowerLane) ||
+					m_globalQueues[lowerLane].m_head.load(std::memory_order_relaxed) != nullptr ||
+					m_globalQueues[lowerLane].m_tail.load(std::memory_order_relaxed) != nullptr)
+				{
+					state.pass_over(lowerLane);
+				}
+			}
+		}
+
+		return operation;
+	}
+
+	template<typename FUNC>
+	static_thread_pool::schedule_operation*
+	static_thread_pool::for_each_other_thread_nearest_first(
+		std::uint32_t thisThreadIndex, FUNC func) noexcept
+	{
+		auto& localState = m_threadStates[thisThreadIndex];
+		const auto& topology = cpu_topology::get();
+
+		// Our CPU may have changed since we last looked.
+		const std::uint32_t thisCpu = cpu_topology::current_cpu();
+		localState.set_cpu(thisCpu);
+
+		// Start scanning at a random thread so that idle threads don't all
+		// converge on the same victim, and try threads sharing our cache
+		// before those further away.
+		const std::uint32_t startIndex = localState.next_random() % m_threadCount;
+		for (std::uint32_t distance = 0; distance <= cpu_topology::max_distance; ++distance)
+		{
+			for (std::uint32_t i = 0; i < m_threadCount; ++i)
+			{
+				std::uint32_t otherThreadIndex = startIndex + i;
+				if (otherThreadIndex >= m_threadCount) otherThreadIndex -= m_threadCount;
 				if (otherThreadIndex == thisThreadIndex) continue;
+
 				auto& otherThreadState = m_threadStates[otherThreadIndex];
-				auto* op = otherThreadState.try_steal();
+				if (topology.distance(thisCpu, otherThreadState.cpu()) != distance) continue;
+
+				auto* op = func(otherThreadState);
 				if (op != nullptr)
 				{
 					return op;
@@ -720,6 +1308,70 @@ namespace cppcoro
 		return nullptr;
 	}
 
+	static_thread_pool::schedule_operation*
+	static_thread_pool::try_steal_from_other_thread(
+		std::uint32_t thisThreadIndex, std::size_t lane) noexcept
+	{
+		auto& localState = m_threadStates[thisThreadIndex];
+
+		schedule_operation* stolen[local::max_steal_batch_size];
+		auto trySteal = [&](bool* anyRacesLost)
+		{
+			return for_each_other_thread_nearest_first(
+				thisThreadIndex,
+				[&](thread_state& otherThreadState) -> schedule_operation*
+				{
+					// Take up to half of the other thread's queue so that a
+					// burst of work queued on one thread spreads across the
+					// pool in a logarithmic number of steals. We run the
+					// oldest and queue the rest for ourselves or others to
+					// run later.
+					const std::size_t count = otherThreadState.try_steal(
+						lane, stolen, local::max_steal_batch_size, anyRacesLost);
+					if (count == 0)
+					{
+						return nullptr;
+					}
+
+					for (std::size_t j = 1; j < count; ++j)
+					{
+						if (!localState.try_local_enqueue(stolen[j]))
+						{
+							remote_enqueue(stolen[j]);
+						}
+					}
+
+					return stolen[0];
+				});
+		};
+
+		// Try first with a single steal attempt per thread.
+		bool anyRacesLost = false;
+		auto* op = trySteal(&anyRacesLost);
+		if (op == nullptr && anyRacesLost)
+		{
+			// Some queues were not empty but we lost the race for their
+			// items. Try again, this time retrying until each queue is empty.
+			op = trySteal(nullptr);
+		}
+
+		return op;
+	}
+
+	static_thread_pool::schedule_operation*
+	static_thread_pool::try_steal_next_to_run_from_other_thread(
+		std::uint32_t thisThreadIndex) noexcept
+	{
+		// Only done once every queue is empty, in case the other thread is
+		// busy for a while.
+		return for_each_other_thread_nearest_first(
+			thisThreadIndex,
+			[](thread_state& otherThreadState)
+			{
+				return otherThreadState.try_steal_next_to_run();
+			});
+	}
+
 	void static_thread_pool::wake_one_thread() noexcept
 	{
 		// First try to claim responsibility for waking up one thread.
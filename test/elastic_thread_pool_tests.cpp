@@ -0,0 +1,153 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cppcoro/elastic_thread_pool.hpp>
+#include <cppcoro/task.hpp>
+#include <cppcoro/sync_wait.hpp>
+#include <cppcoro/when_all.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "doctest/cppcoro_doctest.h"
+
+TEST_SUITE_BEGIN("elastic_thread_pool");
+
+TEST_CASE("construct/destruct")
+{
+	cppcoro::elastic_thread_pool threadPool;
+	const auto hardwareThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	CHECK(threadPool.thread_count() == hardwareThreadCount);
+	CHECK(threadPool.min_thread_count() == hardwareThreadCount);
+	CHECK(threadPool.max_thread_count() == hardwareThreadCount * 4);
+}
+
+TEST_CASE("run one task")
+{
+	cppcoro::elastic_thread_pool threadPool{ 2, 4 };
+
+	auto initiatingThreadId = std::this_thread::get_id();
+
+	cppcoro::sync_wait([&]() -> cppcoro::task<void>
+	{
+		co_await threadPool.schedule();
+		if (std::this_thread::get_id() == initiatingThreadId)
+		{
+			FAIL("schedule() did not switch threads");
+		}
+	}());
+}
+
+TEST_CASE("blocked thread is replaced and the replacement retires when idle")
+{
+	using namespace std::chrono_literals;
+
+	cppcoro::elastic_thread_pool threadPool{ 1, 2, 50ms };
+
+	std::promise<void> unblock;
+
+	auto blockingTask = [&]() -> cppcoro::task<std::uint32_t>
+	{
+		co_await threadPool.schedule();
+		cppcoro::elastic_thread_pool::blocking_section blocking{ threadPool };
+
+		// Only runs to completion if another thread runs unblockingTask.
+		unblock.get_future().wait();
+		co_return threadPool.thread_count();
+	};
+
+	auto unblockingTask = [&]() -> cppcoro::task<>
+	{
+		co_await threadPool.schedule();
+		unblock.set_value();
+	};
+
+	auto [threadCount, _] = cppcoro::sync_wait(
+		cppcoro::when_all(blockingTask(), unblockingTask()));
+	CHECK(threadCount == 2);
+
+	const auto deadline = std::chrono::steady_clock::now() + 5s;
+	while (threadPool.thread_count() > 1 && std::chrono::steady_clock::now() < deadline)
+	{
+		std::this_thread::sleep_for(10ms);
+	}
+	CHECK(threadPool.thread_count() == 1);
+}
+
+TEST_CASE("blocking sections don't grow the pool beyond its maximum")
+{
+	cppcoro::elastic_thread_pool threadPool{ 1, 1 };
+
+	auto threadCount = cppcoro::sync_wait([&]() -> cppcoro::task<std::uint32_t>
+	{
+		co_await threadPool.schedule();
+		cppcoro::elastic_thread_pool::blocking_section blocking{ threadPool };
+		co_return threadPool.thread_count();
+	}());
+	CHECK(threadCount == 1);
+}
+
+TEST_CASE("nested blocking sections replace a blocked thread once")
+{
+	cppcoro::elastic_thread_pool threadPool{ 1, 4 };
+
+	auto [outerCount, innerCount] = cppcoro::sync_wait(
+		[&]() -> cppcoro::task<std::pair<std::uint32_t, std::uint32_t>>
+	{
+		co_await threadPool.schedule();
+		cppcoro::elastic_thread_pool::blocking_section outer{ threadPool };
+		const auto outerCount = threadPool.thread_count();
+
+		cppcoro::elastic_thread_pool::blocking_section inner{ threadPool };
+		co_return std::make_pair(outerCount, threadPool.thread_count());
+	}());
+	CHECK(outerCount == 2);
+	CHECK(innerCount == 2);
+}
+
+TEST_CASE("blocking section outside the pool has no effect")
+{
+	cppcoro::elastic_thread_pool threadPool{ 1, 4 };
+	cppcoro::elastic_thread_pool::blocking_section blocking{ threadPool };
+	CHECK(threadPool.thread_count() == 1);
+}
+
+TEST_CASE("run many tasks while some block")
+{
+	using namespace std::chrono_literals;
+
+	cppcoro::elastic_thread_pool threadPool{ 2, 8, 10ms };
+
+	std::atomic<int> completedCount = 0;
+
+	auto run = [&](int i) -> cppcoro::task<>
+	{
+		co_await threadPool.schedule();
+		if (i % 100 == 0)
+		{
+			cppcoro::elastic_thread_pool::blocking_section blocking{ threadPool };
+			std::this_thread::sleep_for(1ms);
+		}
+		completedCount.fetch_add(1, std::memory_order_relaxed);
+	};
+
+	std::vector<cppcoro::task<>> tasks;
+	for (int i = 0; i < 10'000; ++i)
+	{
+		tasks.push_back(run(i));
+	}
+
+	cppcoro::sync_wait(cppcoro::when_all(std::move(tasks)));
+
+	CHECK(completedCount.load() == 10'000);
+	CHECK(threadPool.thread_count() <= 8);
+}
+
+TEST_SUITE_END();
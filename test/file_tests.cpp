@@ -10,6 +10,7 @@
 #include <cppcoro/task.hpp>
 #include <cppcoro/sync_wait.hpp>
 #include <cppcoro/when_all.hpp>
+#include <cppcoro/when_all_ready.hpp>
 #include <cppcoro/cancellation_source.hpp>
 #include <cppcoro/on_scope_exit.hpp>
 
@@ -18,6 +19,7 @@
 #include <cassert>
 #include <string>
 #include <cstring>
+#include <vector>
 
 #include "io_service_fixture.hpp"
 
@@ -169,6 +171,87 @@ TEST_CASE_FIXTURE(temp_dir_with_io_service_fixture, "read write file")
 	cppcoro::sync_wait(run());
 }
 
+TEST_CASE_FIXTURE(temp_dir_with_io_service_fixture, "concurrent reads at different offsets")
+{
+	auto run = [&]() -> cppcoro::task<>
+	{
+		cppcoro::io_work_scope ioScope{ io_service() };
+		auto f = cppcoro::read_write_file::open(io_service(), temp_dir() / "foo.txt");
+
+		char data[4096];
+		for (std::size_t i = 0; i < sizeof(data); ++i)
+		{
+			data[i] = static_cast<char>('a' + (i / 512));
+		}
+		co_await f.write(0, data, sizeof(data));
+
+		auto readChunk = [&](std::uint64_t offset) -> cppcoro::task<bool>
+		{
+			char buffer[512];
+			const auto bytesRead = co_await f.read(offset, buffer, sizeof(buffer));
+			co_return bytesRead == sizeof(buffer) &&
+				std::memcmp(buffer, data + offset, sizeof(buffer)) == 0;
+		};
+
+		auto [a, b, c, d] = co_await cppcoro::when_all(
+			readChunk(3072), readChunk(0), readChunk(1536), readChunk(512));
+		CHECK(a);
+		CHECK(b);
+		CHECK(c);
+		CHECK(d);
+	};
+
+	cppcoro::sync_wait(run());
+}
+
+TEST_CASE_FIXTURE(temp_dir_fixture, "many reads complete before the event loop runs")
+{
+	cppcoro::io_service ioService;
+
+	auto f = cppcoro::read_write_file::open(ioService, temp_dir() / "foo.txt");
+	f.set_size(4096);
+
+	// Start every read before anything processes events, so that all of
+	// their completions are queued at once.
+	constexpr std::uint32_t readCount = 10'000;
+
+	std::uint32_t completedCount = 0;
+
+	auto readByte = [&](std::uint64_t offset) -> cppcoro::task<>
+	{
+		char buffer[1];
+		if (co_await f.read(offset, buffer, 1) == 1)
+		{
+			++completedCount;
+		}
+	};
+
+	cppcoro::sync_wait(cppcoro::when_all_ready(
+		[&]() -> cppcoro::task<>
+		{
+			auto stopIoOnExit = cppcoro::on_scope_exit([&] { ioService.stop(); });
+
+			std::vector<cppcoro::task<>> reads;
+			reads.reserve(readCount);
+			for (std::uint32_t i = 0; i < readCount; ++i)
+			{
+				reads.emplace_back(readByte(i % 4096));
+			}
+
+			co_await cppcoro::when_all(std::move(reads));
+		}(),
+		[&]() -> cppcoro::task<>
+		{
+			// Give the reads time to finish so that their completions are
+			// all waiting to be dispatched.
+			std::this_thread::sleep_for(std::chrono::milliseconds(200));
+			ioService.process_events();
+			co_return;
+		}()));
+
+	CHECK(completedCount == readCount);
+}
+
 TEST_CASE_FIXTURE(temp_dir_with_io_service_fixture, "cancel read")
 {
 	cppcoro::sync_wait([&]() -> cppcoro::task<>
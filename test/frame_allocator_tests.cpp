@@ -0,0 +1,350 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cppcoro/frame_allocator.hpp>
+#include <cppcoro/recycling_frame_allocator.hpp>
+#include <cppcoro/task.hpp>
+#include <cppcoro/shared_task.hpp>
+#include <cppcoro/async_generator.hpp>
+#include <cppcoro/async_scope.hpp>
+#include <cppcoro/sync_wait.hpp>
+#include <cppcoro/when_all.hpp>
+
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+#if __has_include(<span>)
+# include <span>
+#endif
+
+#include "doctest/cppcoro_doctest.h"
+
+namespace
+{
+	// The number of global operator new calls made by the current thread.
+	thread_local std::size_t globalAllocationCount = 0;
+}
+
+void* operator new(std::size_t size)
+{
+	++globalAllocationCount;
+	if (void* p = std::malloc(size == 0 ? 1 : size))
+	{
+		return p;
+	}
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace
+{
+	class counting_frame_allocator final : public cppcoro::frame_allocator
+	{
+	public:
+
+		void* allocate(std::size_t size) override
+		{
+			++m_allocationCount;
+			return ::operator new(size);
+		}
+
+		void deallocate(void* pointer, std::size_t size) noexcept override
+		{
+			++m_deallocationCount;
+			::operator delete(pointer, size);
+		}
+
+		int m_allocationCount = 0;
+		int m_deallocationCount = 0;
+	};
+
+	struct allocation_counts
+	{
+		int m_allocationCount = 0;
+		int m_deallocationCount = 0;
+	};
+
+	template<typename T>
+	struct counting_std_allocator
+	{
+		using value_type = T;
+
+		explicit counting_std_allocator(allocation_counts& counts) noexcept : m_counts(&counts) {}
+
+		template<typename U>
+		counting_std_allocator(const counting_std_allocator<U>& other) noexcept : m_counts(other.m_counts) {}
+
+		T* allocate(std::size_t n)
+		{
+			++m_counts->m_allocationCount;
+			return std::allocator<T>{}.allocate(n);
+		}
+
+		void deallocate(T* p, std::size_t n) noexcept
+		{
+			++m_counts->m_deallocationCount;
+			std::allocator<T>{}.deallocate(p, n);
+		}
+
+		allocation_counts* m_counts;
+	};
+
+	cppcoro::task<int> add_one(std::allocator_arg_t, counting_frame_allocator&, int x)
+	{
+		co_return x + 1;
+	}
+
+	cppcoro::task<int> add_two(
+		std::allocator_arg_t, counting_std_allocator<char>, int x)
+	{
+		co_return x + 2;
+	}
+
+	cppcoro::shared_task<int> shared_add_one(std::allocator_arg_t, counting_frame_allocator&, int x)
+	{
+		co_return x + 1;
+	}
+
+	cppcoro::task<int> leaf(int x)
+	{
+		co_return x;
+	}
+
+	cppcoro::task<int> nested(int depth)
+	{
+		if (depth == 0)
+		{
+			co_return co_await leaf(1);
+		}
+
+		co_return co_await nested(depth - 1) + co_await leaf(1);
+	}
+}
+
+TEST_SUITE_BEGIN("frame_allocator");
+
+TEST_CASE("task frame comes from the frame allocator passed as an argument")
+{
+	counting_frame_allocator allocator;
+	{
+		auto t = add_one(std::allocator_arg, allocator, 1);
+		CHECK(allocator.m_allocationCount == 1);
+		CHECK(cppcoro::sync_wait(t) == 2);
+		CHECK(allocator.m_deallocationCount == 0);
+	}
+	CHECK(allocator.m_deallocationCount == 1);
+}
+
+TEST_CASE("task frame comes from the std allocator passed as an argument")
+{
+	allocation_counts counts;
+	CHECK(cppcoro::sync_wait(add_two(std::allocator_arg, counting_std_allocator<char>{ counts }, 1)) == 3);
+	CHECK(counts.m_allocationCount == 1);
+	CHECK(counts.m_deallocationCount == 1);
+}
+
+TEST_CASE("shared_task frame comes from the frame allocator passed as an argument")
+{
+	counting_frame_allocator allocator;
+	{
+		auto t = shared_add_one(std::allocator_arg, allocator, 1);
+		auto copy = t;
+		CHECK(cppcoro::sync_wait(copy) == 2);
+		CHECK(allocator.m_allocationCount == 1);
+	}
+	CHECK(allocator.m_deallocationCount == 1);
+}
+
+TEST_CASE("frames come from the thread's default frame allocator")
+{
+	counting_frame_allocator allocator;
+
+	cppcoro::task<int> t;
+	{
+		cppcoro::frame_allocator_scope scope{ allocator };
+		CHECK(cppcoro::default_frame_allocator() == &allocator);
+		t = leaf(5);
+		CHECK(allocator.m_allocationCount == 1);
+	}
+	CHECK(cppcoro::default_frame_allocator() == nullptr);
+
+	auto other = leaf(6);
+	CHECK(allocator.m_allocationCount == 1);
+
+	// Frames go back to the allocator they came from, whatever the
+	// thread's current default.
+	CHECK(cppcoro::sync_wait(t) == 5);
+	t = {};
+	CHECK(allocator.m_deallocationCount == 1);
+}
+
+TEST_CASE("async_generator and async_scope frames come from the default frame allocator")
+{
+	counting_frame_allocator allocator;
+	cppcoro::frame_allocator_scope scope{ allocator };
+
+	auto numbers = []() -> cppcoro::async_generator<int>
+	{
+		co_yield 1;
+		co_yield 2;
+	};
+
+	int sum = 0;
+	auto consume = [&](cppcoro::async_generator<int> gen) -> cppcoro::task<>
+	{
+		for (auto it = co_await gen.begin(); it != gen.end(); co_await ++it)
+		{
+			sum += *it;
+		}
+	};
+
+	cppcoro::async_scope asyncScope;
+	{
+		auto gen = numbers();
+		CHECK(allocator.m_allocationCount == 1);
+		asyncScope.spawn(consume(std::move(gen)));
+	}
+	cppcoro::sync_wait(asyncScope.join());
+
+	CHECK(sum == 3);
+
+	// The generator, the spawned task and async_scope's own coroutine.
+	CHECK(allocator.m_allocationCount == 3);
+	CHECK(allocator.m_deallocationCount == allocator.m_allocationCount);
+}
+
+TEST_CASE("recycling_frame_allocator reuses freed frames")
+{
+	cppcoro::recycling_frame_allocator allocator;
+
+	void* p = allocator.allocate(100);
+	allocator.deallocate(p, 100);
+
+	// Sizes in the same size class share frames.
+	void* q = allocator.allocate(120);
+	CHECK(q == p);
+
+	void* r = allocator.allocate(120);
+	CHECK(r != q);
+
+	allocator.deallocate(q, 120);
+	allocator.deallocate(r, 120);
+}
+
+TEST_CASE("recycling_frame_allocator reuses frames freed on other threads")
+{
+	cppcoro::recycling_frame_allocator allocator;
+
+	void* p = allocator.allocate(100);
+	std::thread{ [&] { allocator.deallocate(p, 100); } }.join();
+
+	CHECK(allocator.allocate(100) == p);
+	allocator.deallocate(p, 100);
+}
+
+TEST_CASE("creating tasks from a recycling_frame_allocator doesn't allocate once warm")
+{
+	cppcoro::recycling_frame_allocator allocator;
+	cppcoro::frame_allocator_scope scope{ allocator };
+
+	std::size_t allocationCount = ~std::size_t(0);
+	int sum = 0;
+	cppcoro::sync_wait([&]() -> cppcoro::task<>
+	{
+		sum += co_await nested(20);
+
+		const auto countBefore = globalAllocationCount;
+		for (int i = 0; i < 100; ++i)
+		{
+			sum += co_await nested(20);
+		}
+		allocationCount = globalAllocationCount - countBefore;
+	}());
+
+	CHECK(sum == 101 * 21);
+	CHECK(allocationCount == 0);
+}
+
+TEST_CASE("sync_wait() keeps its coroutine frame on the stack")
+{
+	struct resume_inline
+	{
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(cppcoro::coroutine_handle<> coroutine) { coroutine.resume(); }
+		int await_resume() const noexcept { return 3; }
+	};
+
+	const auto countBefore = globalAllocationCount;
+	const int result = cppcoro::sync_wait(resume_inline{});
+	CHECK(globalAllocationCount == countBefore);
+	CHECK(result == 3);
+}
+
+#if __cpp_lib_span
+TEST_CASE("when_all() over a span doesn't allocate once its buffer is warm")
+{
+	cppcoro::when_all_buffer buffer;
+
+	std::size_t allocationCount = ~std::size_t(0);
+	for (int round = 0; round < 2; ++round)
+	{
+		std::vector<cppcoro::task<int>> tasks;
+		tasks.reserve(100);
+		for (int i = 0; i < 100; ++i)
+		{
+			tasks.push_back(leaf(i));
+		}
+
+		const auto countBefore = globalAllocationCount;
+		{
+			auto allTasks = cppcoro::when_all_ready(std::span{ tasks }, buffer);
+			cppcoro::sync_wait(allTasks);
+		}
+		allocationCount = globalAllocationCount - countBefore;
+	}
+
+	// The first round sizes the buffer; the second reuses it.
+	CHECK(allocationCount == 0);
+}
+
+TEST_CASE("when_all() over a span into a span of results doesn't allocate once its buffer is warm")
+{
+	cppcoro::when_all_buffer buffer;
+	std::vector<int> results(100);
+
+	std::size_t allocationCount = ~std::size_t(0);
+	for (int round = 0; round < 2; ++round)
+	{
+		std::vector<cppcoro::task<int>> tasks;
+		tasks.reserve(100);
+		for (int i = 0; i < 100; ++i)
+		{
+			tasks.push_back(leaf(i + round));
+		}
+
+		const auto countBefore = globalAllocationCount;
+		cppcoro::sync_wait(cppcoro::when_all(std::span{ tasks }, std::span{ results }, buffer));
+		allocationCount = globalAllocationCount - countBefore;
+	}
+
+	CHECK(allocationCount == 0);
+	CHECK(results.front() == 1);
+	CHECK(results.back() == 100);
+}
+#endif
+
+TEST_SUITE_END();
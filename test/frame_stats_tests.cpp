@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cppcoro/frame_stats.hpp>
+#include <cppcoro/task.hpp>
+#include <cppcoro/shared_task.hpp>
+#include <cppcoro/generator.hpp>
+#include <cppcoro/recursive_generator.hpp>
+#include <cppcoro/async_generator.hpp>
+#include <cppcoro/sync_wait.hpp>
+
+#include "doctest/cppcoro_doctest.h"
+
+namespace
+{
+	// The number of frames of \p kind allocated since \p before.
+	std::uint64_t allocations_since(
+		const cppcoro::frame_stats_snapshot& before, cppcoro::frame_kind kind)
+	{
+		return cppcoro::snapshot_frame_stats()[kind].allocations - before[kind].allocations;
+	}
+
+	// The number of frames of \p kind that were allocated since \p before
+	// and are still live.
+	std::uint64_t live_since(
+		const cppcoro::frame_stats_snapshot& before, cppcoro::frame_kind kind)
+	{
+		const auto now = cppcoro::snapshot_frame_stats()[kind];
+		return (now.allocations - before[kind].allocations) -
+			(now.deallocations - before[kind].deallocations);
+	}
+
+	// Frames of one kind counted when stats are enabled, or zero.
+	constexpr std::uint64_t expected(std::uint64_t count)
+	{
+		return cppcoro::frame_stats_enabled ? count : 0;
+	}
+}
+
+TEST_SUITE_BEGIN("frame_stats");
+
+TEST_CASE("histogram buckets double in size")
+{
+	using stats = cppcoro::frame_kind_stats;
+	CHECK(stats::bucket_index(1) == 0);
+	CHECK(stats::bucket_index(64) == 0);
+	CHECK(stats::bucket_index(65) == 1);
+	CHECK(stats::bucket_index(128) == 1);
+	CHECK(stats::bucket_index(4096) == 6);
+	CHECK(stats::bucket_index(4097) == stats::bucket_count - 1);
+	CHECK(stats::bucket_index(1'000'000) == stats::bucket_count - 1);
+}
+
+TEST_CASE("task frames are counted while live")
+{
+	using cppcoro::frame_kind;
+
+	const auto before = cppcoro::snapshot_frame_stats();
+	{
+		auto t = []() -> cppcoro::task<int> { co_return 1; }();
+		CHECK(allocations_since(before, frame_kind::task) == expected(1));
+		CHECK(live_since(before, frame_kind::task) == expected(1));
+		CHECK(cppcoro::sync_wait(t) == 1);
+	}
+	CHECK(live_since(before, frame_kind::task) == 0);
+
+	// Only task frames were created.
+	CHECK(allocations_since(before, frame_kind::shared_task) == 0);
+	CHECK(allocations_since(before, frame_kind::generator) == 0);
+}
+
+TEST_CASE("each coroutine type is counted separately")
+{
+	using cppcoro::frame_kind;
+
+	const auto before = cppcoro::snapshot_frame_stats();
+
+	auto shared = []() -> cppcoro::shared_task<int> { co_return 2; }();
+	auto gen = []() -> cppcoro::generator<int> { co_yield 3; }();
+	auto recursive = []() -> cppcoro::recursive_generator<int> { co_yield 4; }();
+	auto asyncGen = []() -> cppcoro::async_generator<int> { co_yield 5; }();
+
+	CHECK(allocations_since(before, frame_kind::task) == 0);
+	CHECK(allocations_since(before, frame_kind::shared_task) == expected(1));
+	CHECK(allocations_since(before, frame_kind::generator) == expected(1));
+	CHECK(allocations_since(before, frame_kind::recursive_generator) == expected(1));
+	CHECK(allocations_since(before, frame_kind::async_generator) == expected(1));
+}
+
+TEST_CASE("frame sizes are recorded in the histogram")
+{
+	using cppcoro::frame_kind;
+
+	const auto before = cppcoro::snapshot_frame_stats()[frame_kind::generator];
+
+	// A frame that holds a large local across a suspend point.
+	auto gen = []() -> cppcoro::generator<int>
+	{
+		volatile char buffer[8192] = {};
+		co_yield buffer[0];
+	}();
+
+	const auto after = cppcoro::snapshot_frame_stats()[frame_kind::generator];
+	const auto last = cppcoro::frame_kind_stats::bucket_count - 1;
+	CHECK(after.size_histogram[last] - before.size_histogram[last] == expected(1));
+	CHECK(after.allocated_bytes - before.allocated_bytes >= expected(8192));
+	if (cppcoro::frame_stats_enabled)
+	{
+		CHECK(after.largest_frame_size > 8192);
+	}
+	else
+	{
+		CHECK(after.largest_frame_size == 0);
+	}
+
+	for (int value : gen)
+	{
+		CHECK(value == 0);
+	}
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Lewis Baker
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cppcoro/io_service_pool.hpp>
+#include <cppcoro/net/socket.hpp>
+#include <cppcoro/task.hpp>
+#include <cppcoro/when_all.hpp>
+#include <cppcoro/sync_wait.hpp>
+
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "doctest/cppcoro_doctest.h"
+
+using namespace cppcoro;
+using namespace cppcoro::net;
+
+TEST_SUITE_BEGIN("io_service_pool");
+
+TEST_CASE("construct/destruct")
+{
+	io_service_pool pool{ 3 };
+	CHECK(pool.size() == 3);
+	CHECK(pool.current() == nullptr);
+
+	// next() cycles through the loops.
+	std::set<io_service*> services;
+	for (std::uint32_t i = 0; i < pool.size(); ++i)
+	{
+		services.insert(&pool.next());
+	}
+	CHECK(services.size() == 3);
+	CHECK(&pool.next() == &pool.service(0));
+}
+
+TEST_CASE("each loop runs on its own thread")
+{
+	io_service_pool pool{ 3 };
+
+	std::vector<std::thread::id> threadIds;
+	for (std::uint32_t i = 0; i < pool.size(); ++i)
+	{
+		auto& service = pool.service(i);
+		io_service* current = nullptr;
+		sync_wait([&]() -> task<>
+		{
+			co_await service.schedule();
+			current = pool.current();
+			threadIds.push_back(std::this_thread::get_id());
+		}());
+		CHECK(current == &service);
+	}
+
+	CHECK(std::set<std::thread::id>(threadIds.begin(), threadIds.end()).size() == 3);
+	CHECK(threadIds[0] != std::this_thread::get_id());
+}
+
+TEST_CASE("loops recycle coroutine frames")
+{
+	io_service_pool_options options;
+	options.thread_count = 1;
+	options.recycle_frames = true;
+
+	io_service_pool pool{ options };
+
+	auto leaf = [](int x) -> task<int> { co_return x; };
+
+	int sum = sync_wait([&]() -> task<int>
+	{
+		co_await pool.service(0).schedule();
+
+		int total = 0;
+		for (int i = 0; i < 1000; ++i)
+		{
+			total += co_await leaf(1);
+		}
+		co_return total;
+	}());
+	CHECK(sum == 1000);
+
+	auto stats = pool.frame_stats();
+	CHECK(stats.hits >= 999);
+	CHECK(stats.misses <= 1);
+}
+
+#if CPPCORO_OS_LINUX || CPPCORO_OS_DARWIN
+TEST_CASE("accepted connection can move to the loop chosen for it")
+{
+	io_service_pool pool{ 2 };
+
+	auto listeningSocket = socket::create_tcpv4(pool.service(0));
+	listeningSocket.bind(ipv4_endpoint{ ipv4_address::loopback(), 0 });
+	listeningSocket.listen(1);
+
+	auto serverSocket = socket::create_tcpv4(pool.next());
+	auto clientSocket = socket::create_tcpv4(pool.service(1));
+
+	(void)sync_wait(when_all(
+		[&]() -> task<int>
+		{
+			co_await listeningSocket.accept(serverSocket);
+			co_return 0;
+		}(),
+		[&]() -> task<int>
+		{
+			co_await clientSocket.connect(listeningSocket.local_endpoint());
+			co_return 0;
+		}()));
+
+	auto& target = pool.service_for(serverSocket);
+	serverSocket.rebind(target);
+
+	const std::uint8_t message[] = { 'a', 'b', 'c', 'd' };
+	std::uint8_t buffer[16];
+	io_service* receivedOn = nullptr;
+
+	auto [sent, received] = sync_wait(when_all(
+		[&]() -> task<std::size_t>
+		{
+			co_return co_await clientSocket.send(message, sizeof(message));
+		}(),
+		[&]() -> task<std::size_t>
+		{
+			co_await target.schedule();
+			auto bytesReceived = co_await serverSocket.recv(buffer, sizeof(buffer));
+			receivedOn = pool.current();
+			co_return bytesReceived;
+		}()));
+
+	CHECK(sent == sizeof(message));
+	CHECK(received == sizeof(message));
+	CHECK(buffer[3] == 'd');
+	CHECK(receivedOn == &target);
+}
+#endif
+
+TEST_SUITE_END();
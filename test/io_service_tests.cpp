@@ -69,6 +69,30 @@ TEST_CASE("schedule coroutine")
 		}()));
 }
 
+TEST_CASE("scheduled coroutines are resumed in order")
+{
+	cppcoro::io_service service;
+
+	std::vector<int> order;
+	auto startTask = [&](int id) -> cppcoro::task<>
+	{
+		co_await service.schedule();
+		order.push_back(id);
+	};
+
+	cppcoro::sync_wait(cppcoro::when_all_ready(
+		startTask(0),
+		startTask(1),
+		startTask(2),
+		[&]() -> cppcoro::task<>
+		{
+			CHECK(service.process_pending_events() == 3);
+			co_return;
+		}()));
+
+	CHECK(order == std::vector<int>{ 0, 1, 2 });
+}
+
 TEST_CASE_FIXTURE(io_service_fixture_with_threads<2>, "multiple I/O threads servicing events")
 {
 	std::atomic<int> completedCount = 0;
@@ -140,6 +164,38 @@ TEST_CASE("Multiple concurrent timers")
 		}()));
 }
 
+TEST_CASE("Timers expire in order of due time")
+{
+	using namespace std::chrono_literals;
+
+	cppcoro::io_service ioService;
+
+	std::vector<int> order;
+	auto startTimer = [&](int id, std::chrono::milliseconds duration) -> cppcoro::task<>
+	{
+		co_await ioService.schedule_after(duration);
+		order.push_back(id);
+	};
+
+	cppcoro::sync_wait(cppcoro::when_all_ready(
+		[&]() -> cppcoro::task<>
+		{
+			auto stopIoOnExit = cppcoro::on_scope_exit([&] { ioService.stop(); });
+			co_await cppcoro::when_all_ready(
+				startTimer(3, 150ms),
+				startTimer(0, 10ms),
+				startTimer(2, 90ms),
+				startTimer(1, 40ms));
+		}(),
+		[&]() -> cppcoro::task<>
+		{
+			ioService.process_events();
+			co_return;
+		}()));
+
+	CHECK(order == std::vector<int>{ 0, 1, 2, 3 });
+}
+
 TEST_CASE("Timer cancellation"
 	* doctest::timeout{ 5.0 })
 {
@@ -191,6 +247,58 @@ TEST_CASE("Timer cancellation"
 		}()));
 }
 
+TEST_CASE("Cancelling many timers at once")
+{
+	cppcoro::io_service ioService;
+	cppcoro::cancellation_source canceller;
+
+	// Cancel every timer before anything processes events, so that all of
+	// their completions are queued at once.
+	constexpr std::uint32_t taskCount = 10'000;
+
+	std::uint32_t cancelledCount = 0;
+
+	auto startTimer = [&]() -> cppcoro::task<>
+	{
+		try
+		{
+			co_await ioService.schedule_after(std::chrono::hours(1), canceller.token());
+		}
+		catch (const cppcoro::operation_cancelled&)
+		{
+			++cancelledCount;
+		}
+	};
+
+	cppcoro::sync_wait(cppcoro::when_all_ready(
+		[&]() -> cppcoro::task<>
+		{
+			auto stopIoOnExit = cppcoro::on_scope_exit([&] { ioService.stop(); });
+
+			std::vector<cppcoro::task<>> tasks;
+			tasks.reserve(taskCount);
+			for (std::uint32_t i = 0; i < taskCount; ++i)
+			{
+				tasks.emplace_back(startTimer());
+			}
+
+			co_await cppcoro::when_all_ready(
+				cppcoro::when_all(std::move(tasks)),
+				[&]() -> cppcoro::task<>
+				{
+					canceller.request_cancellation();
+					co_return;
+				}());
+		}(),
+		[&]() -> cppcoro::task<>
+		{
+			ioService.process_events();
+			co_return;
+		}()));
+
+	CHECK(cancelledCount == taskCount);
+}
+
 TEST_CASE_FIXTURE(io_service_fixture_with_threads<1>, "Many concurrent timers")
 {
 	auto startTimer = [&]() -> cppcoro::task<>
@@ -6,6 +6,7 @@
 #include <cppcoro/schedule_on.hpp>
 #include <cppcoro/resume_on.hpp>
 #include <cppcoro/io_service.hpp>
+#include <cppcoro/async_scope.hpp>
 #include <cppcoro/sync_wait.hpp>
 #include <cppcoro/when_all_ready.hpp>
 #include <cppcoro/on_scope_exit.hpp>
@@ -13,9 +14,72 @@
 
 #include "io_service_fixture.hpp"
 
+#include <atomic>
 #include <ostream>
+#include <thread>
 #include "doctest/cppcoro_doctest.h"
 
+namespace
+{
+	/// Keeps the single thread of an io_service_fixture busy until release()
+	/// runs, so that nothing scheduled onto the io_service after construction
+	/// runs before then.
+	///
+	/// A task that completes on another thread before its awaiter has
+	/// attached its continuation resumes that continuation on the awaiting
+	/// thread instead (cppcoro issue #79). Awaiting release() after such a
+	/// task has suspended makes sure that can't happen.
+	class io_thread_hold
+	{
+	public:
+
+		explicit io_thread_hold(cppcoro::io_service& ioService)
+			: m_released(false)
+		{
+			m_scope.spawn(hold(ioService, m_released));
+		}
+
+		~io_thread_hold()
+		{
+			m_released = true;
+			cppcoro::sync_wait(m_scope.join());
+		}
+
+		cppcoro::task<> release()
+		{
+			m_released = true;
+			co_return;
+		}
+
+	private:
+
+		static cppcoro::task<> hold(cppcoro::io_service& ioService, std::atomic<bool>& released)
+		{
+			co_await ioService.schedule();
+			while (!released)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		std::atomic<bool> m_released;
+		cppcoro::async_scope m_scope;
+
+	};
+
+	/// Wait for \p awaitable with the io_service's thread held until
+	/// \p awaitable has suspended, and return its result.
+	template<typename AWAITABLE>
+	auto sync_wait_holding_io_thread(
+		cppcoro::io_service& ioService, AWAITABLE&& awaitable)
+	{
+		io_thread_hold hold{ ioService };
+		auto [result, released] = cppcoro::sync_wait(cppcoro::when_all_ready(
+			std::forward<AWAITABLE>(awaitable), hold.release()));
+		return std::move(result).result();
+	}
+}
+
 TEST_SUITE_BEGIN("schedule/resume_on");
 
 TEST_CASE_FIXTURE(io_service_fixture, "schedule_on task<> function")
@@ -118,14 +182,12 @@ TEST_CASE_FIXTURE(io_service_fixture, "resume_on task<> function")
 		co_return;
 	};
 
-	cppcoro::sync_wait([&]() -> cppcoro::task<>
+	sync_wait_holding_io_thread(io_service(), [&]() -> cppcoro::task<>
 	{
 		CHECK(std::this_thread::get_id() == mainThreadId);
 
 		co_await resume_on(io_service(), start());
 
-		// NOTE: This check could potentially spuriously fail with the current
-		// implementation of task<T>. See cppcoro issue #79.
 		CHECK(std::this_thread::get_id() != mainThreadId);
 	}());
 }
@@ -225,8 +287,10 @@ TEST_CASE_FIXTURE(io_service_fixture, "schedule_on task<> pipe syntax")
 
 	// Shouldn't matter where in sequence schedule_on() appears since it applies
 	// at the start of the pipeline (ie. before first task starts).
-	CHECK(cppcoro::sync_wait(makeTask() | schedule_on(io_service()) | cppcoro::fmap(triple)) == 369);
-	CHECK(cppcoro::sync_wait(makeTask() | cppcoro::fmap(triple) | schedule_on(io_service())) == 369);
+	CHECK(sync_wait_holding_io_thread(
+		io_service(), makeTask() | schedule_on(io_service()) | cppcoro::fmap(triple)) == 369);
+	CHECK(sync_wait_holding_io_thread(
+		io_service(), makeTask() | cppcoro::fmap(triple) | schedule_on(io_service())) == 369);
 }
 
 TEST_CASE_FIXTURE(io_service_fixture, "resume_on task<> pipe syntax")
@@ -239,7 +303,7 @@ TEST_CASE_FIXTURE(io_service_fixture, "resume_on task<> pipe syntax")
 		co_return 123;
 	};
 
-	cppcoro::sync_wait([&]() -> cppcoro::task<>
+	sync_wait_holding_io_thread(io_service(), [&]() -> cppcoro::task<>
 	{
 		cppcoro::task<int> t = makeTask() | cppcoro::resume_on(io_service());
 		CHECK(co_await t == 123);
@@ -265,6 +329,10 @@ TEST_CASE_FIXTURE(io_service_fixture, "resume_on task<> pipe syntax multiple use
 
 	cppcoro::io_service otherIoService;
 
+	// Released once the first task has suspended, before this thread starts
+	// processing otherIoService's events.
+	io_thread_hold hold{ io_service() };
+
 	cppcoro::sync_wait(cppcoro::when_all_ready(
 		[&]() -> cppcoro::task<>
 	{
@@ -282,6 +350,7 @@ TEST_CASE_FIXTURE(io_service_fixture, "resume_on task<> pipe syntax multiple use
 
 		CHECK(std::this_thread::get_id() == mainThreadId);
 	}(),
+		hold.release(),
 		[&]() -> cppcoro::task<>
 	{
 		otherIoService.process_events();
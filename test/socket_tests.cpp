@@ -12,6 +12,16 @@
 #include <cppcoro/cancellation_source.hpp>
 #include <cppcoro/cancellation_token.hpp>
 #include <cppcoro/async_scope.hpp>
+#include <cppcoro/read_only_file.hpp>
+#include <cppcoro/filesystem.hpp>
+
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "doctest/cppcoro_doctest.h"
 
@@ -93,6 +103,119 @@ TEST_CASE("TCP/IPv4 connect/disconnect")
 		}()));
 }
 
+#if CPPCORO_OS_LINUX
+TEST_CASE("send/recv complete without the event loop when the socket is ready")
+{
+	io_service ioSvc;
+
+	auto listeningSocket = socket::create_tcpv4(ioSvc);
+	listeningSocket.bind(ipv4_endpoint{ ipv4_address::loopback(), 0 });
+	listeningSocket.listen(1);
+
+	auto serverSocket = socket::create_tcpv4(ioSvc);
+	auto clientSocket = socket::create_tcpv4(ioSvc);
+
+	(void)sync_wait(when_all(
+		[&]() -> task<int>
+		{
+			auto stopOnExit = on_scope_exit([&] { ioSvc.stop(); });
+			(void)co_await when_all(
+				[&]() -> task<int>
+				{
+					co_await listeningSocket.accept(serverSocket);
+					co_return 0;
+				}(),
+				[&]() -> task<int>
+				{
+					co_await clientSocket.connect(listeningSocket.local_endpoint());
+					co_return 0;
+				}());
+			co_return 0;
+		}(),
+		[&]() -> task<int>
+		{
+			ioSvc.process_events();
+			co_return 0;
+		}()));
+
+	// Nothing is processing events any more, so these only complete if
+	// they complete inline.
+	const std::uint8_t message[] = { 'a', 'b', 'c', 'd' };
+	CHECK(sync_wait(clientSocket.send(message, sizeof(message))) == sizeof(message));
+
+	std::uint8_t buffer[16];
+	CHECK(sync_wait(serverSocket.recv(buffer, sizeof(buffer))) == sizeof(message));
+	CHECK(buffer[3] == 'd');
+}
+
+TEST_CASE("send completes inline at most maxInlineCompletions times in a row")
+{
+	io_service ioSvc{ 0, 2 };
+
+	auto listeningSocket = socket::create_tcpv4(ioSvc);
+	listeningSocket.bind(ipv4_endpoint{ ipv4_address::loopback(), 0 });
+	listeningSocket.listen(1);
+
+	auto serverSocket = socket::create_tcpv4(ioSvc);
+	auto clientSocket = socket::create_tcpv4(ioSvc);
+
+	auto runUntil = [&](task<> work)
+	{
+		sync_wait(when_all(
+			[&]() -> task<int>
+			{
+				auto stopOnExit = on_scope_exit([&] { ioSvc.stop(); });
+				co_await work;
+				co_return 0;
+			}(),
+			[&]() -> task<int>
+			{
+				ioSvc.process_events();
+				co_return 0;
+			}()));
+		ioSvc.reset();
+	};
+
+	runUntil([&]() -> task<>
+	{
+		(void)co_await when_all(
+			[&]() -> task<int>
+			{
+				co_await listeningSocket.accept(serverSocket);
+				co_return 0;
+			}(),
+			[&]() -> task<int>
+			{
+				co_await clientSocket.connect(listeningSocket.local_endpoint());
+				co_return 0;
+			}());
+	}());
+
+	int sentCount = 0;
+	auto sendThree = [&]() -> task<>
+	{
+		const std::uint8_t message[1] = { 0 };
+		for (int i = 0; i < 3; ++i)
+		{
+			co_await clientSocket.send(message, 1);
+			++sentCount;
+		}
+	};
+
+	// Nothing is processing events, so only the sends that complete inline
+	// have finished when spawn() returns.
+	async_scope scope;
+	scope.spawn(sendThree());
+	CHECK(sentCount == 2);
+
+	runUntil([&]() -> task<>
+	{
+		co_await scope.join();
+	}());
+	CHECK(sentCount == 3);
+}
+#endif
+
 TEST_CASE("send/recv TCP/IPv4")
 {
 	io_service ioSvc;
@@ -206,6 +329,95 @@ TEST_CASE("send/recv TCP/IPv4")
 		}()));
 }
 
+TEST_CASE("scatter/gather send/recv TCP/IPv4")
+{
+	io_service ioSvc;
+
+	auto listeningSocket = socket::create_tcpv4(ioSvc);
+	listeningSocket.bind(ipv4_endpoint{ ipv4_address::loopback(), 0 });
+	listeningSocket.listen(1);
+
+	auto serverSocket = socket::create_tcpv4(ioSvc);
+	auto clientSocket = socket::create_tcpv4(ioSvc);
+
+	auto server = [&]() -> task<int>
+	{
+		co_await listeningSocket.accept(serverSocket);
+
+		// Receive the 3-byte header and 6-byte payload into separate buffers.
+		char header[3];
+		char payload[16] = {};
+		mutable_buffer buffers[] = {
+			{ header, sizeof(header) },
+			{ payload, sizeof(payload) },
+		};
+
+		// Reads may be short, even within the header, so receive into
+		// whatever is left of the buffers each time.
+		mutable_buffer* remaining = buffers;
+		std::size_t remainingCount = std::size(buffers);
+		std::size_t totalBytesReceived = 0;
+		std::size_t bytesReceived;
+		do
+		{
+			bytesReceived = co_await serverSocket.recv(remaining, remainingCount);
+			totalBytesReceived += bytesReceived;
+
+			std::size_t consumed = bytesReceived;
+			while (remainingCount > 0 && consumed >= remaining->size())
+			{
+				consumed -= remaining->size();
+				++remaining;
+				--remainingCount;
+			}
+			if (remainingCount > 0)
+			{
+				*remaining = mutable_buffer{
+					static_cast<char*>(remaining->data()) + consumed,
+					remaining->size() - consumed };
+			}
+		} while (bytesReceived > 0 && remainingCount > 0);
+
+		CHECK(totalBytesReceived == 9);
+		CHECK(std::string(header, sizeof(header)) == "HDR");
+		CHECK(std::string(payload) == "abcdef");
+
+		co_return 0;
+	};
+
+	auto client = [&]() -> task<int>
+	{
+		co_await clientSocket.connect(listeningSocket.local_endpoint());
+
+		const char header[] = "HDR";
+		const char payload[] = "abc";
+		const char trailer[] = "def";
+		const const_buffer buffers[] = {
+			{ header, 3 },
+			{ payload, 3 },
+			{ trailer, 3 },
+		};
+		CHECK(co_await clientSocket.send(buffers, 3) == 9);
+
+		clientSocket.close_send();
+
+		co_return 0;
+	};
+
+	(void)sync_wait(when_all(
+		[&]() -> task<int>
+		{
+			auto stopOnExit = on_scope_exit([&] { ioSvc.stop(); });
+			(void)co_await when_all(client(), server());
+			co_return 0;
+		}(),
+		[&]() -> task<int>
+		{
+			ioSvc.process_events();
+			co_return 0;
+		}()));
+}
+
 #if !CPPCORO_COMPILER_MSVC || CPPCORO_COMPILER_MSVC >= 192000000 || !CPPCORO_CPU_X86
 // HACK: Don't compile this function under MSVC x86.
 // It results in an ICE under VS 2017.15 and earlier.
@@ -363,6 +575,176 @@ TEST_CASE("send/recv TCP/IPv4 many connections")
 
 #endif
 
+TEST_CASE("send_file TCP/IPv4")
+{
+	// Large enough that the socket buffers fill and the file is sent in
+	// several parts.
+	constexpr std::size_t fileSize = 4 * 1024 * 1024;
+	constexpr std::uint64_t startOffset = 1000;
+
+	const auto filePath = cppcoro::filesystem::temp_directory_path() /
+		("cppcoro_send_file_" + std::to_string(std::random_device{}()));
+	auto removeOnExit = on_scope_exit([&] { cppcoro::filesystem::remove(filePath); });
+	{
+		std::vector<char> contents(fileSize);
+		for (std::size_t i = 0; i < fileSize; ++i)
+		{
+			contents[i] = char('a' + i % 26);
+		}
+		std::ofstream{ filePath, std::ios::binary }.write(contents.data(), fileSize);
+	}
+
+	io_service ioSvc;
+
+	auto listeningSocket = socket::create_tcpv4(ioSvc);
+	listeningSocket.bind(ipv4_endpoint{ ipv4_address::loopback(), 0 });
+	listeningSocket.listen(1);
+
+	auto serverSocket = socket::create_tcpv4(ioSvc);
+	auto clientSocket = socket::create_tcpv4(ioSvc);
+
+	auto server = [&]() -> task<int>
+	{
+		co_await listeningSocket.accept(serverSocket);
+
+		auto file = read_only_file::open(ioSvc, filePath);
+
+		// Ask for more than is left so that the end of the file is reached.
+		std::uint64_t offset = startOffset;
+		std::size_t bytesSent;
+		do
+		{
+			bytesSent = co_await serverSocket.send_file(file, offset, fileSize);
+			offset += bytesSent;
+		} while (bytesSent > 0);
+
+		CHECK(offset == fileSize);
+
+		serverSocket.close_send();
+
+		co_return 0;
+	};
+
+	auto client = [&]() -> task<int>
+	{
+		co_await clientSocket.connect(listeningSocket.local_endpoint());
+
+		std::uint8_t buffer[4096];
+		std::uint64_t totalBytesReceived = 0;
+		bool contentsMatch = true;
+		std::size_t bytesReceived;
+		do
+		{
+			bytesReceived = co_await clientSocket.recv(buffer, sizeof(buffer));
+			for (std::size_t i = 0; i < bytesReceived; ++i)
+			{
+				const std::uint64_t fileOffset = startOffset + totalBytesReceived + i;
+				contentsMatch &= buffer[i] == std::uint8_t('a' + fileOffset % 26);
+			}
+
+			totalBytesReceived += bytesReceived;
+		} while (bytesReceived > 0);
+
+		CHECK(contentsMatch);
+		CHECK(totalBytesReceived == fileSize - startOffset);
+
+		co_return 0;
+	};
+
+	(void)sync_wait(when_all(
+		[&]() -> task<int>
+		{
+			auto stopOnExit = on_scope_exit([&] { ioSvc.stop(); });
+			(void)co_await when_all(server(), client());
+			co_return 0;
+		}(),
+		[&]() -> task<int>
+		{
+			ioSvc.process_events();
+			co_return 0;
+		}()));
+}
+
+TEST_CASE("send_file TCP/IPv4 cancelled while waiting for room")
+{
+	// More than the socket buffers hold, so that once the client stops
+	// reading the sender has to wait for room.
+	constexpr std::size_t fileSize = 32 * 1024 * 1024;
+
+	const auto filePath = cppcoro::filesystem::temp_directory_path() /
+		("cppcoro_send_file_" + std::to_string(std::random_device{}()));
+	auto removeOnExit = on_scope_exit([&] { cppcoro::filesystem::remove(filePath); });
+	{
+		std::vector<char> contents(fileSize);
+		std::ofstream{ filePath, std::ios::binary }.write(contents.data(), fileSize);
+	}
+
+	io_service ioSvc;
+
+	auto listeningSocket = socket::create_tcpv4(ioSvc);
+	listeningSocket.bind(ipv4_endpoint{ ipv4_address::loopback(), 0 });
+	listeningSocket.listen(1);
+
+	auto serverSocket = socket::create_tcpv4(ioSvc);
+	auto clientSocket = socket::create_tcpv4(ioSvc);
+
+	cancellation_source canceller;
+	bool cancelled = false;
+
+	auto server = [&]() -> task<int>
+	{
+		co_await listeningSocket.accept(serverSocket);
+
+		auto file = read_only_file::open(ioSvc, filePath);
+
+		std::uint64_t offset = 0;
+		try
+		{
+			std::size_t bytesSent;
+			do
+			{
+				bytesSent = co_await serverSocket.send_file(
+					file, offset, fileSize, canceller.token());
+				offset += bytesSent;
+			} while (bytesSent > 0);
+		}
+		catch (const cppcoro::operation_cancelled&)
+		{
+			cancelled = true;
+		}
+
+		CHECK(offset < fileSize);
+
+		co_return 0;
+	};
+
+	auto client = [&]() -> task<int>
+	{
+		co_await clientSocket.connect(listeningSocket.local_endpoint());
+
+		// Don't read anything, and give the server time to fill the socket.
+		co_await ioSvc.schedule_after(std::chrono::milliseconds(100));
+		canceller.request_cancellation();
+
+		co_return 0;
+	};
+
+	(void)sync_wait(when_all(
+		[&]() -> task<int>
+		{
+			auto stopOnExit = on_scope_exit([&] { ioSvc.stop(); });
+			(void)co_await when_all(server(), client());
+			co_return 0;
+		}(),
+		[&]() -> task<int>
+		{
+			ioSvc.process_events();
+			co_return 0;
+		}()));
+
+	CHECK(cancelled);
+}
+
 TEST_CASE("udp send_to/recv_from")
 {
 	io_service ioSvc;
@@ -470,4 +852,289 @@ TEST_CASE("udp send_to/recv_from")
 		}()));
 }
 
+TEST_CASE("recv_from on more sockets than fit in one batch of events")
+{
+	// More readable sockets than the io_service harvests per poll, so that
+	// completions are spread over several batches. Every thread must keep
+	// dispatching until they have all been delivered, and stop() must still
+	// bring every thread out of the event loop afterwards.
+	constexpr std::size_t socketCount = 300;
+	constexpr std::uint32_t threadCount = 3;
+
+	io_service ioSvc{ 0, 16, 64 };
+
+	std::vector<socket> serverSockets;
+	std::vector<ip_endpoint> serverAddresses;
+	serverSockets.reserve(socketCount);
+	for (std::size_t i = 0; i < socketCount; ++i)
+	{
+		serverSockets.push_back(socket::create_udpv4(ioSvc));
+		serverSockets.back().bind(ipv4_endpoint{ ipv4_address::loopback(), 0 });
+		serverAddresses.push_back(serverSockets.back().local_endpoint());
+	}
+
+	std::atomic<std::size_t> receivedCount = 0;
+
+	auto receive = [&](socket& serverSocket) -> task<>
+	{
+		std::uint8_t buffer[1];
+		auto[bytesReceived, remoteEndPoint] = co_await serverSocket.recv_from(buffer, 1);
+		CHECK(bytesReceived == 1);
+		++receivedCount;
+	};
+
+	// Start every receive before any thread is processing events so that
+	// all of the sockets are ready by the time the first one polls.
+	async_scope scope;
+	for (auto& serverSocket : serverSockets)
+	{
+		scope.spawn(receive(serverSocket));
+	}
+
+	{
+		io_service clientIoSvc;
+		auto clientSocket = socket::create_udpv4(clientIoSvc);
+
+		sync_wait(when_all(
+			[&]() -> task<int>
+			{
+				auto stopOnExit = on_scope_exit([&] { clientIoSvc.stop(); });
+				const std::uint8_t message[1] = { 0 };
+				for (auto& serverAddress : serverAddresses)
+				{
+					co_await clientSocket.send_to(serverAddress, message, 1);
+				}
+				co_return 0;
+			}(),
+			[&]() -> task<int>
+			{
+				clientIoSvc.process_events();
+				co_return 0;
+			}()));
+	}
+
+	std::vector<std::thread> ioThreads;
+	for (std::uint32_t i = 0; i < threadCount; ++i)
+	{
+		ioThreads.emplace_back([&] { ioSvc.process_events(); });
+	}
+
+	sync_wait(scope.join());
+	CHECK(receivedCount == socketCount);
+
+	ioSvc.stop();
+	for (auto& thread : ioThreads)
+	{
+		thread.join();
+	}
+}
+
+TEST_CASE("recv_from on more sockets than fit in one submission batch")
+{
+	// More pending receives than the io_uring backend's submission queue
+	// holds, all started before any thread runs the event loop. Once the
+	// queue fills, queueing the next receive has to submit what is already
+	// there rather than fail.
+	constexpr std::size_t socketCount = 1100;
+
+	io_service ioSvc;
+
+	std::vector<socket> serverSockets;
+	std::vector<ip_endpoint> serverAddresses;
+	serverSockets.reserve(socketCount);
+	for (std::size_t i = 0; i < socketCount; ++i)
+	{
+		serverSockets.push_back(socket::create_udpv4(ioSvc));
+		serverSockets.back().bind(ipv4_endpoint{ ipv4_address::loopback(), 0 });
+		serverAddresses.push_back(serverSockets.back().local_endpoint());
+	}
+
+	std::size_t receivedCount = 0;
+
+	auto receive = [&](socket& serverSocket) -> task<>
+	{
+		std::uint8_t buffer[1];
+		auto[bytesReceived, remoteEndPoint] = co_await serverSocket.recv_from(buffer, 1);
+		CHECK(bytesReceived == 1);
+		++receivedCount;
+	};
+
+	async_scope scope;
+	for (auto& serverSocket : serverSockets)
+	{
+		scope.spawn(receive(serverSocket));
+	}
+
+	sync_wait(when_all(
+		[&]() -> task<int>
+		{
+			auto stopOnExit = on_scope_exit([&] { ioSvc.stop(); });
+			auto clientSocket = socket::create_udpv4(ioSvc);
+			const std::uint8_t message[1] = { 0 };
+			for (auto& serverAddress : serverAddresses)
+			{
+				co_await clientSocket.send_to(serverAddress, message, 1);
+			}
+			co_await scope.join();
+			co_return 0;
+		}(),
+		[&]() -> task<int>
+		{
+			ioSvc.process_events();
+			co_return 0;
+		}()));
+
+	CHECK(receivedCount == socketCount);
+}
+
+#if CPPCORO_OS_LINUX && !CPPCORO_USE_IO_URING
+TEST_CASE("io_service harvests at most eventBatchSize events per poll")
+{
+	constexpr std::size_t socketCount = 20;
+
+	// Make socketCount sockets readable before polling, then dispatch
+	// their receives on this thread.
+	auto receiveAll = [&](io_service& ioSvc)
+	{
+		std::vector<socket> serverSockets;
+		std::vector<ip_endpoint> serverAddresses;
+		serverSockets.reserve(socketCount);
+		for (std::size_t i = 0; i < socketCount; ++i)
+		{
+			serverSockets.push_back(socket::create_udpv4(ioSvc));
+			serverSockets.back().bind(ipv4_endpoint{ ipv4_address::loopback(), 0 });
+			serverAddresses.push_back(serverSockets.back().local_endpoint());
+		}
+
+		std::size_t receivedCount = 0;
+		auto receive = [&](socket& serverSocket) -> task<>
+		{
+			std::uint8_t buffer[1];
+			auto[bytesReceived, remoteEndPoint] = co_await serverSocket.recv_from(buffer, 1);
+			CHECK(bytesReceived == 1);
+			++receivedCount;
+		};
+
+		async_scope scope;
+		for (auto& serverSocket : serverSockets)
+		{
+			scope.spawn(receive(serverSocket));
+		}
+
+		{
+			io_service clientIoSvc;
+			auto clientSocket = socket::create_udpv4(clientIoSvc);
+
+			sync_wait(when_all(
+				[&]() -> task<int>
+				{
+					auto stopOnExit = on_scope_exit([&] { clientIoSvc.stop(); });
+					const std::uint8_t message[1] = { 0 };
+					for (auto& serverAddress : serverAddresses)
+					{
+						co_await clientSocket.send_to(serverAddress, message, 1);
+					}
+					co_return 0;
+				}(),
+				[&]() -> task<int>
+				{
+					clientIoSvc.process_events();
+					co_return 0;
+				}()));
+		}
+
+		while (receivedCount < socketCount)
+		{
+			ioSvc.process_pending_events();
+		}
+		sync_wait(scope.join());
+	};
+
+	io_service smallBatchIoSvc{ 0, 16, 4 };
+	receiveAll(smallBatchIoSvc);
+	const auto smallBatches = smallBatchIoSvc.batch_stats();
+	CHECK(smallBatches.largest_batch == 4);
+	CHECK(smallBatches.event_count >= socketCount);
+	CHECK(smallBatches.batch_count >= socketCount / 4);
+
+	io_service defaultIoSvc;
+	receiveAll(defaultIoSvc);
+	const auto defaultBatches = defaultIoSvc.batch_stats();
+	CHECK(defaultBatches.largest_batch >= socketCount);
+	CHECK(defaultBatches.batch_count < smallBatches.batch_count);
+}
+#endif
+
+TEST_CASE("udp send_many_to/recv_many_from")
+{
+	io_service ioSvc;
+
+	auto serverSocket = socket::create_udpv4(ioSvc);
+	serverSocket.bind(ipv4_endpoint{ ipv4_address::loopback(), 0 });
+
+	auto clientSocket = socket::create_udpv4(ioSvc);
+	clientSocket.bind(ipv4_endpoint{ ipv4_address::loopback(), 0 });
+
+	constexpr std::size_t datagramCount = 5;
+
+	auto server = [&]() -> task<int>
+	{
+		char buffers[datagramCount][8];
+		incoming_datagram datagrams[datagramCount];
+		for (std::size_t i = 0; i < datagramCount; ++i)
+		{
+			datagrams[i].buffer = mutable_buffer{ buffers[i], sizeof(buffers[i]) };
+		}
+
+		// Fewer slots than datagrams may be filled by each receive.
+		std::size_t received = 0;
+		while (received < datagramCount)
+		{
+			received += co_await serverSocket.recv_many_from(
+				datagrams + received, datagramCount - received);
+		}
+
+		for (std::size_t i = 0; i < datagramCount; ++i)
+		{
+			CHECK(datagrams[i].size == i + 1);
+			CHECK(buffers[i][i] == char('a' + i));
+			CHECK(datagrams[i].source == clientSocket.local_endpoint());
+		}
+
+		co_return 0;
+	};
+
+	auto client = [&]() -> task<int>
+	{
+		const char message[] = "abcde";
+		outgoing_datagram datagrams[datagramCount];
+		for (std::size_t i = 0; i < datagramCount; ++i)
+		{
+			datagrams[i].buffer = const_buffer{ message, i + 1 };
+			datagrams[i].destination = serverSocket.local_endpoint();
+		}
+
+		std::size_t sent = 0;
+		while (sent < datagramCount)
+		{
+			sent += co_await clientSocket.send_many_to(datagrams + sent, datagramCount - sent);
+		}
+
+		co_return 0;
+	};
+
+	(void)sync_wait(when_all(
+		[&]() -> task<int>
+		{
+			auto stopOnExit = on_scope_exit([&] { ioSvc.stop(); });
+			(void)co_await when_all(server(), client());
+			co_return 0;
+		}(),
+		[&]() -> task<int>
+		{
+			ioSvc.process_events();
+			co_return 0;
+		}()));
+}
+
 TEST_SUITE_END();
@@ -4,10 +4,13 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include <cppcoro/static_thread_pool.hpp>
+#include <cppcoro/async_scope.hpp>
 #include <cppcoro/task.hpp>
 #include <cppcoro/sync_wait.hpp>
 #include <cppcoro/when_all.hpp>
 
+#include <atomic>
+#include <string>
 #include <vector>
 #include <thread>
 #include <cassert>
@@ -15,6 +18,10 @@
 #include <iostream>
 #include <numeric>
 
+#if CPPCORO_OS_LINUX
+# include <sched.h>
+#endif
+
 #include "doctest/cppcoro_doctest.h"
 
 TEST_SUITE_BEGIN("static_thread_pool");
@@ -48,6 +55,329 @@ TEST_CASE("run one task")
 	}());
 }
 
+TEST_CASE("construct with affinity policies")
+{
+	using affinity_policy = cppcoro::static_thread_pool_options::affinity_policy;
+
+	for (auto affinity : { affinity_policy::none, affinity_policy::one_per_core, affinity_policy::numa_node })
+	{
+		cppcoro::static_thread_pool_options options;
+		options.affinity = affinity;
+
+		cppcoro::static_thread_pool tp{ options };
+		CHECK(tp.thread_count() >= 1);
+
+		auto result = cppcoro::sync_wait([&]() -> cppcoro::task<int>
+		{
+			co_await tp.schedule();
+			co_return 123;
+		}());
+		CHECK(result == 123);
+	}
+}
+
+TEST_CASE("pin threads to cpu sets")
+{
+	// Pick a CPU we're allowed to run on.
+	int expectedCpu = 0;
+#if CPPCORO_OS_LINUX
+	cpu_set_t allowedCpus;
+	CPU_ZERO(&allowedCpus);
+	REQUIRE(::sched_getaffinity(0, sizeof(allowedCpus), &allowedCpus) == 0);
+	while (!CPU_ISSET(expectedCpu, &allowedCpus))
+	{
+		++expectedCpu;
+	}
+#endif
+
+	cppcoro::static_thread_pool_options options;
+	options.affinity = cppcoro::static_thread_pool_options::affinity_policy::cpu_sets;
+	options.cpu_sets = { { static_cast<std::uint32_t>(expectedCpu) } };
+
+	cppcoro::static_thread_pool tp{ options };
+	CHECK(tp.thread_count() == 1);
+
+	auto cpu = cppcoro::sync_wait([&]() -> cppcoro::task<int>
+	{
+		co_await tp.schedule();
+#if CPPCORO_OS_LINUX
+		co_return ::sched_getcpu();
+#else
+		co_return 0;
+#endif
+	}());
+	CHECK(cpu == expectedCpu);
+}
+
+TEST_CASE("idle workers without spinning go straight to sleep")
+{
+	using namespace std::chrono_literals;
+
+	cppcoro::static_thread_pool_options options;
+	options.thread_count = 2;
+	options.spin_count = 0;
+
+	cppcoro::static_thread_pool tp{ options };
+
+	cppcoro::sync_wait([&]() -> cppcoro::task<>
+	{
+		co_await tp.schedule();
+	}());
+
+	// Wait for both threads to run out of work and go to sleep.
+	const auto deadline = std::chrono::steady_clock::now() + 5s;
+	while (tp.stats().parks < 2 && std::chrono::steady_clock::now() < deadline)
+	{
+		std::this_thread::sleep_for(1ms);
+	}
+
+	auto stats = tp.stats();
+	CHECK(stats.spins == 0);
+	CHECK(stats.spin_successes == 0);
+	CHECK(stats.parks >= 2);
+}
+
+TEST_CASE("workers recycle coroutine frames")
+{
+	cppcoro::static_thread_pool_options options;
+	options.thread_count = 2;
+	options.recycle_frames = true;
+
+	cppcoro::static_thread_pool tp{ options };
+
+	auto leaf = [](int x) -> cppcoro::task<int> { co_return x; };
+
+	int sum = cppcoro::sync_wait([&]() -> cppcoro::task<int>
+	{
+		co_await tp.schedule();
+
+		int total = 0;
+		for (int i = 0; i < 1000; ++i)
+		{
+			total += co_await leaf(1);
+		}
+		co_return total;
+	}());
+	CHECK(sum == 1000);
+
+	// Each frame after the first reuses the previous one.
+	auto stats = tp.stats();
+	CHECK(stats.frame_cache_hits >= 999);
+	CHECK(stats.frame_cache_misses <= 1);
+}
+
+TEST_CASE("idle spin strategies")
+{
+	using spin_strategy = cppcoro::static_thread_pool_options::spin_strategy;
+
+	for (auto spin : { spin_strategy::backoff, spin_strategy::pause, spin_strategy::yield })
+	{
+		cppcoro::static_thread_pool_options options;
+		options.thread_count = 2;
+		options.spin_count = 8;
+		options.spin = spin;
+		options.adaptive_spin = true;
+
+		cppcoro::static_thread_pool tp{ options };
+
+		auto makeTask = [&]() -> cppcoro::task<int>
+		{
+			co_await tp.schedule();
+			co_return 1;
+		};
+
+		constexpr int taskCount = 100;
+
+		int sum = 0;
+		for (int i = 0; i < taskCount; ++i)
+		{
+			sum += cppcoro::sync_wait(makeTask());
+		}
+		CHECK(sum == taskCount);
+
+		// Each idle period ends by running a task, going to sleep, or
+		// shutting down, and spins at most spin_count times.
+		const auto stats = tp.stats();
+		CHECK(stats.spins <= options.spin_count * (taskCount + stats.parks + options.thread_count));
+	}
+}
+
+TEST_CASE("adaptive spinning never spins when spin_count is zero")
+{
+	cppcoro::static_thread_pool_options options;
+	options.thread_count = 2;
+	options.spin_count = 0;
+	options.adaptive_spin = true;
+
+	cppcoro::static_thread_pool tp{ options };
+
+	auto makeTask = [&]() -> cppcoro::task<>
+	{
+		co_await tp.schedule();
+	};
+
+	for (int i = 0; i < 100; ++i)
+	{
+		cppcoro::sync_wait(makeTask());
+	}
+
+	const auto stats = tp.stats();
+	CHECK(stats.spins == 0);
+	CHECK(stats.spin_successes == 0);
+	CHECK(stats.parks > 0);
+}
+
+TEST_CASE("coroutine rescheduling itself does not starve queued work")
+{
+	cppcoro::static_thread_pool tp{ 1 };
+
+	bool done = false;
+	std::uint32_t rescheduleCount = 0;
+
+	auto setDone = [&]() -> cppcoro::task<>
+	{
+		co_await tp.schedule();
+		done = true;
+	};
+
+	auto spinUntilDone = [&]() -> cppcoro::task<>
+	{
+		co_await tp.schedule();
+		while (!done)
+		{
+			++rescheduleCount;
+			co_await tp.schedule();
+		}
+	};
+
+	cppcoro::sync_wait([&]() -> cppcoro::task<>
+	{
+		co_await tp.schedule();
+
+		// setDone() is queued first, then spinUntilDone() keeps taking the
+		// thread's next-to-run slot.
+		co_await cppcoro::when_all(setDone(), spinUntilDone());
+	}());
+
+	CHECK(done);
+	CHECK(rescheduleCount < 100);
+}
+
+namespace
+{
+	cppcoro::task<> set_after_schedule(
+		cppcoro::static_thread_pool& tp, std::atomic<bool>& flag)
+	{
+		co_await tp.schedule();
+		flag = true;
+	}
+}
+
+TEST_CASE("operation in next-to-run slot runs while its worker is blocked")
+{
+	cppcoro::static_thread_pool_options options;
+	options.thread_count = 2;
+	options.spin_count = 0;
+
+	cppcoro::static_thread_pool tp{ options };
+
+	// Wait for both workers to go to sleep, so that only a wake-up could
+	// bring the other one in to run the spawned coroutine.
+	while (tp.stats().parks < options.thread_count)
+	{
+		std::this_thread::yield();
+	}
+
+	std::atomic<bool> childRan = false;
+
+	cppcoro::sync_wait([&]() -> cppcoro::task<>
+	{
+		co_await tp.schedule();
+
+		cppcoro::async_scope scope;
+		scope.spawn(set_after_schedule(tp, childRan));
+
+		// Block this worker without suspending. The child is in its
+		// next-to-run slot so another worker has to take it from there.
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (!childRan && std::chrono::steady_clock::now() < deadline)
+		{
+			std::this_thread::yield();
+		}
+
+		const bool ranWhileBlocked = childRan;
+
+		co_await scope.join();
+
+		CHECK(ranWhileBlocked);
+	}());
+}
+
+namespace
+{
+	cppcoro::task<> run_in_lane(
+		cppcoro::static_thread_pool& tp,
+		cppcoro::static_thread_pool::priority priority,
+		std::string& order,
+		char name)
+	{
+		co_await tp.schedule(priority);
+		order += name;
+	}
+
+	std::string run_high_and_low_priority_work(
+		cppcoro::static_thread_pool& tp, int highCount, int lowCount)
+	{
+		using priority = cppcoro::static_thread_pool::priority;
+
+		std::string order;
+		cppcoro::sync_wait([&]() -> cppcoro::task<>
+		{
+			co_await tp.schedule();
+
+			// Queue the low priority work first.
+			std::vector<cppcoro::task<>> tasks;
+			for (int i = 0; i < lowCount; ++i)
+			{
+				tasks.push_back(run_in_lane(tp, priority::low, order, 'L'));
+			}
+			for (int i = 0; i < highCount; ++i)
+			{
+				tasks.push_back(run_in_lane(tp, priority::high, order, 'H'));
+			}
+
+			co_await cppcoro::when_all(std::move(tasks));
+		}());
+
+		return order;
+	}
+}
+
+TEST_CASE("higher priority work runs first")
+{
+	cppcoro::static_thread_pool_options options;
+	options.thread_count = 1;
+	options.priority_quota = 0;
+
+	cppcoro::static_thread_pool tp{ options };
+
+	CHECK(run_high_and_low_priority_work(tp, 3, 3) == "HHHLLL");
+}
+
+TEST_CASE("lower priority work is not starved")
+{
+	cppcoro::static_thread_pool_options options;
+	options.thread_count = 1;
+	options.priority_quota = 2;
+
+	cppcoro::static_thread_pool tp{ options };
+
+	const auto order = run_high_and_low_priority_work(tp, 20, 3);
+	CHECK(order.size() == 23);
+	CHECK(order.find('L') <= 2);
+	CHECK(order.rfind('L') < 20);
+}
+
 TEST_CASE("launch many tasks remotely")
 {
 	cppcoro::static_thread_pool threadPool;
@@ -287,6 +617,38 @@ TEST_CASE("for_each_async")
 	}
 
 }
+
+TEST_CASE("fan out many tasks from a worker thread")
+{
+	cppcoro::static_thread_pool tp{ 4 };
+
+	constexpr std::size_t taskCount = 10'000;
+	std::atomic<std::size_t> completedCount = 0;
+
+	cppcoro::sync_wait([&]() -> cppcoro::task<>
+	{
+		co_await tp.schedule();
+
+		// Every task is queued on this worker's local queue first, so the
+		// other workers can only get at them by stealing.
+		auto makeTask = [&]() -> cppcoro::task<>
+		{
+			co_await tp.schedule();
+			completedCount.fetch_add(1, std::memory_order_relaxed);
+		};
+
+		std::vector<cppcoro::task<>> tasks;
+		tasks.reserve(taskCount);
+		for (std::size_t i = 0; i < taskCount; ++i)
+		{
+			tasks.push_back(makeTask());
+		}
+
+		co_await cppcoro::when_all(std::move(tasks));
+	}());
+
+	CHECK(completedCount == taskCount);
+}
 #endif
 
 TEST_SUITE_END();
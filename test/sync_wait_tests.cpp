@@ -11,6 +11,7 @@
 #include <cppcoro/on_scope_exit.hpp>
 #include <cppcoro/static_thread_pool.hpp>
 
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 
@@ -51,6 +52,60 @@ TEST_CASE("sync_wait(shared_task<T>)")
 	CHECK(cppcoro::sync_wait(makeTask()) == "foo");
 }
 
+namespace
+{
+	// An awaiter that is either ready or resumes the awaiting coroutine
+	// from inside await_suspend().
+	struct inline_awaiter
+	{
+		bool m_ready;
+		int m_value;
+		int m_readyCount = 0;
+
+		bool await_ready() noexcept
+		{
+			++m_readyCount;
+			return m_ready;
+		}
+
+		void await_suspend(cppcoro::coroutine_handle<> coroutine)
+		{
+			coroutine.resume();
+		}
+
+		int& await_resume()
+		{
+			if (m_value < 0)
+			{
+				throw std::runtime_error{ "negative" };
+			}
+
+			return m_value;
+		}
+	};
+}
+
+TEST_CASE("sync_wait() of a ready awaiter")
+{
+	inline_awaiter awaiter{ true, 5 };
+	int& result = cppcoro::sync_wait(awaiter);
+	CHECK(&result == &awaiter.m_value);
+	CHECK(awaiter.m_readyCount == 1);
+}
+
+TEST_CASE("sync_wait() of an awaiter that suspends")
+{
+	inline_awaiter awaiter{ false, 7 };
+	int& result = cppcoro::sync_wait(awaiter);
+	CHECK(&result == &awaiter.m_value);
+
+	// await_ready() is only asked once.
+	CHECK(awaiter.m_readyCount == 1);
+
+	awaiter.m_value = -1;
+	CHECK_THROWS_AS(cppcoro::sync_wait(awaiter), const std::runtime_error&);
+}
+
 #if !CPPCORO_OS_WINNT || CPPCORO_OS_WINNT >= 0x0600
 TEST_CASE("multiple threads")
 {
@@ -13,9 +13,14 @@
 #include "counted.hpp"
 
 #include <functional>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#if __has_include(<span>)
+# include <span>
+#endif
+
 #include <ostream>
 #include "doctest/cppcoro_doctest.h"
 
@@ -262,4 +267,51 @@ TEST_CASE("when_all_ready() doesn't rethrow exceptions")
 	}());
 }
 
+#if __cpp_lib_span
+TEST_CASE("when_all_ready() with span<task<T>>")
+{
+	cppcoro::async_manual_reset_event event;
+
+	std::uint32_t startedCount = 0;
+
+	auto makeTask = [&](int value) -> cppcoro::task<int>
+	{
+		++startedCount;
+		co_await event;
+		if (value < 0)
+		{
+			throw std::runtime_error{ "negative" };
+		}
+		co_return value;
+	};
+
+	std::vector<cppcoro::task<int>> tasks;
+	tasks.emplace_back(makeTask(1));
+	tasks.emplace_back(makeTask(-1));
+	tasks.emplace_back(makeTask(3));
+
+	cppcoro::when_all_buffer buffer;
+	auto allTask = cppcoro::when_all_ready(std::span{ tasks }, buffer);
+
+	// Shouldn't have started any tasks yet.
+	CHECK(startedCount == 0u);
+
+	cppcoro::sync_wait(cppcoro::when_all_ready(
+		[&]() -> cppcoro::task<>
+	{
+		auto resultTasks = co_await allTask;
+		REQUIRE(resultTasks.size() == 3u);
+		CHECK(resultTasks[0].result() == 1);
+		CHECK_THROWS_AS(resultTasks[1].result(), const std::runtime_error&);
+		CHECK(resultTasks[2].result() == 3);
+	}(),
+		[&]() -> cppcoro::task<>
+	{
+		CHECK(startedCount == 3u);
+		event.set();
+		co_return;
+	}()));
+}
+#endif
+
 TEST_SUITE_END();
@@ -16,9 +16,14 @@
 #include "counted.hpp"
 
 #include <functional>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#if __has_include(<span>)
+# include <span>
+#endif
+
 #include <ostream>
 #include "doctest/cppcoro_doctest.h"
 
@@ -424,4 +429,126 @@ TEST_CASE("when_all() with vector<shared_task<T&>>"
 	check_when_all_vector_of_task_reference<cppcoro::shared_task>();
 }
 
+#if __cpp_lib_span
+TEST_CASE("when_all() with span<task<T>>")
+{
+	cppcoro::async_manual_reset_event event;
+
+	auto makeTask = [&](int value) -> cppcoro::task<int>
+	{
+		co_await event;
+		co_return value;
+	};
+
+	cppcoro::when_all_buffer buffer;
+
+	auto run = [&]() -> cppcoro::task<>
+	{
+		std::vector<cppcoro::task<int>> tasks;
+		for (int i = 0; i < 5; ++i)
+		{
+			tasks.push_back(makeTask(i));
+		}
+
+		std::vector<int> results = co_await cppcoro::when_all(std::span{ tasks }, buffer);
+		CHECK(results == std::vector<int>{ 0, 1, 2, 3, 4 });
+	};
+
+	cppcoro::sync_wait(cppcoro::when_all_ready(
+		run(),
+		[&]() -> cppcoro::task<>
+	{
+		event.set();
+		co_return;
+	}()));
+
+	// The buffer is reused by later operations of the same size.
+	const auto capacity = buffer.capacity();
+	CHECK(capacity > 0);
+
+	std::vector<cppcoro::task<int>> tasks;
+	for (int i = 0; i < 5; ++i)
+	{
+		tasks.push_back(makeTask(i + 10));
+	}
+	auto results = cppcoro::sync_wait(cppcoro::when_all(std::span{ tasks }, buffer));
+	CHECK(results == std::vector<int>{ 10, 11, 12, 13, 14 });
+	CHECK(buffer.capacity() == capacity);
+}
+
+TEST_CASE("when_all() with span<task<>>")
+{
+	int runCount = 0;
+	auto makeTask = [&](bool fail) -> cppcoro::task<>
+	{
+		++runCount;
+		if (fail)
+		{
+			throw std::runtime_error{ "failed" };
+		}
+		co_return;
+	};
+
+	std::vector<cppcoro::task<>> tasks;
+	tasks.push_back(makeTask(false));
+	tasks.push_back(makeTask(false));
+	cppcoro::sync_wait(cppcoro::when_all(std::span{ tasks }));
+	CHECK(runCount == 2);
+
+	tasks.clear();
+	tasks.push_back(makeTask(false));
+	tasks.push_back(makeTask(true));
+	tasks.push_back(makeTask(false));
+	CHECK_THROWS_AS(
+		cppcoro::sync_wait(cppcoro::when_all(std::span{ tasks })),
+		const std::runtime_error&);
+
+	// All of them run, even after one has failed.
+	CHECK(runCount == 5);
+}
+
+TEST_CASE("when_all() with span<task<T>> into a span of results")
+{
+	auto makeTask = [](int value) -> cppcoro::task<std::string>
+	{
+		if (value < 0)
+		{
+			throw std::runtime_error{ "failed" };
+		}
+		co_return std::to_string(value);
+	};
+
+	cppcoro::when_all_buffer buffer;
+	std::vector<std::string> results(3);
+
+	std::vector<cppcoro::task<std::string>> tasks;
+	for (int i = 0; i < 3; ++i)
+	{
+		tasks.push_back(makeTask(i));
+	}
+	cppcoro::sync_wait(cppcoro::when_all(std::span{ tasks }, std::span{ results }, buffer));
+	CHECK(results[0] == "0");
+	CHECK(results[1] == "1");
+	CHECK(results[2] == "2");
+
+	tasks.clear();
+	tasks.push_back(makeTask(10));
+	tasks.push_back(makeTask(-1));
+	tasks.push_back(makeTask(12));
+	CHECK_THROWS_AS(
+		cppcoro::sync_wait(cppcoro::when_all(std::span{ tasks }, std::span{ results }, buffer)),
+		const std::runtime_error&);
+
+	// Results before the failed awaitable have been assigned.
+	CHECK(results[0] == "10");
+	CHECK(results[2] == "2");
+}
+
+TEST_CASE("when_all() with empty span")
+{
+	std::vector<cppcoro::task<int>> tasks;
+	CHECK(cppcoro::sync_wait(cppcoro::when_all(std::span{ tasks })).empty());
+}
+#endif
+
 TEST_SUITE_END();